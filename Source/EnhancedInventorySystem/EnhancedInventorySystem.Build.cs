@@ -27,12 +27,16 @@ public class EnhancedInventorySystem : ModuleRules
 		
 		PublicIncludePaths.Add(Path.Combine(ModuleDirectory, "Public"));
 		PublicIncludePaths.Add(Path.Combine(ModuleDirectory, "Public/Framework"));
+		PublicIncludePaths.Add(Path.Combine(ModuleDirectory, "Public/Framework/Crafting"));
 		PublicIncludePaths.Add(Path.Combine(ModuleDirectory, "Public/Framework/Inventory"));
 		PublicIncludePaths.Add(Path.Combine(ModuleDirectory, "Public/Framework/Item"));
+		PublicIncludePaths.Add(Path.Combine(ModuleDirectory, "Public/Framework/Loot"));
 		
 		PrivateIncludePaths.Add(Path.Combine(ModuleDirectory, "Private"));
 		PrivateIncludePaths.Add(Path.Combine(ModuleDirectory, "Private/Framework"));
+		PrivateIncludePaths.Add(Path.Combine(ModuleDirectory, "Private/Framework/Crafting"));
 		PrivateIncludePaths.Add(Path.Combine(ModuleDirectory, "Private/Framework/Inventory"));
 		PrivateIncludePaths.Add(Path.Combine(ModuleDirectory, "Private/Framework/Item"));
+		PrivateIncludePaths.Add(Path.Combine(ModuleDirectory, "Private/Framework/Loot"));
 	}
 }
@@ -0,0 +1,235 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EISCraftingSubsystem.h"
+#include "EISCraftingRecipe.h"
+#include "EISInventoryFunctionLibrary.h"
+#include "EISItemContainer.h"
+#include "EISItemInstance.h"
+#include "EnhancedInventorySystem.h"
+
+void UEISCraftingSubsystem::Deinitialize()
+{
+	for (const TPair<TObjectKey<UEISItemContainer>, TBitArray<>>& Pair : CraftableRecipes)
+	{
+		if (UEISItemContainer* Container = Pair.Key.ResolveObjectPtr())
+		{
+			Container->OnItemCountChangeDelegate.RemoveAll(this);
+		}
+	}
+	CraftableRecipes.Reset();
+	
+	Super::Deinitialize();
+}
+
+void UEISCraftingSubsystem::RegisterRecipe(UEISCraftingRecipe* Recipe)
+{
+	if (!Recipe || RecipeIndices.Contains(Recipe))
+	{
+		return;
+	}
+
+	const int32 RecipeIndex = Recipes.Add(Recipe);
+	RecipeIndices.Add(Recipe, RecipeIndex);
+
+	TArray<FRecipeRequirement>& Requirements = RecipeRequirements.AddDefaulted_GetRef();
+	for (const FEISRecipeIngredient& Ingredient : Recipe->Ingredients)
+	{
+		if (!Ingredient.Definition || Ingredient.Amount <= 0)
+		{
+			continue;
+		}
+
+		if (FRecipeRequirement* Requirement = Requirements.FindByPredicate([&Ingredient](const FRecipeRequirement& Other)
+		{
+			return Other.Definition == Ingredient.Definition;
+		}))
+		{
+			Requirement->Amount += Ingredient.Amount;
+			continue;
+		}
+
+		Requirements.Add({Ingredient.Definition, Ingredient.Amount});
+		IngredientRecipes.FindOrAdd(Ingredient.Definition).Add(RecipeIndex);
+	}
+
+	for (TPair<TObjectKey<UEISItemContainer>, TBitArray<>>& Pair : CraftableRecipes)
+	{
+		Pair.Value.Add(false);
+		
+		UEISItemContainer* Container = Pair.Key.ResolveObjectPtr();
+		if (Container && EvaluateRecipe(Container, Pair.Value, RecipeIndex))
+		{
+			OnCraftableRecipesChangeDelegate.Broadcast(Container);
+		}
+	}
+}
+
+void UEISCraftingSubsystem::TrackContainer(UEISItemContainer* Container)
+{
+	if (!Container || CraftableRecipes.Contains(Container))
+	{
+		return;
+	}
+
+	TBitArray<>& Craftable = CraftableRecipes.Add(Container, TBitArray<>(false, Recipes.Num()));
+	for (int32 RecipeIndex = 0; RecipeIndex < Recipes.Num(); RecipeIndex++)
+	{
+		EvaluateRecipe(Container, Craftable, RecipeIndex);
+	}
+
+	Container->OnItemCountChangeDelegate.AddUObject(this, &ThisClass::OnItemCountChange, Container);
+	OnCraftableRecipesChangeDelegate.Broadcast(Container);
+}
+
+void UEISCraftingSubsystem::UntrackContainer(UEISItemContainer* Container)
+{
+	if (Container && CraftableRecipes.Remove(Container) > 0)
+	{
+		Container->OnItemCountChangeDelegate.RemoveAll(this);
+	}
+}
+
+bool UEISCraftingSubsystem::CanCraftRecipe(const UEISItemContainer* Container, const UEISCraftingRecipe* Recipe,
+                                           int Times) const
+{
+	const int32* RecipeIndex = RecipeIndices.Find(Recipe);
+	if (!Container || !RecipeIndex || Times <= 0)
+	{
+		return false;
+	}
+	return IsRecipeSatisfied(Container, *RecipeIndex, Times);
+}
+
+bool UEISCraftingSubsystem::IsRecipeCraftable(const UEISItemContainer* Container,
+                                              const UEISCraftingRecipe* Recipe) const
+{
+	const TBitArray<>* Craftable = CraftableRecipes.Find(Container);
+	const int32* RecipeIndex = RecipeIndices.Find(Recipe);
+	
+	if (Craftable && RecipeIndex)
+	{
+		return (*Craftable)[*RecipeIndex];
+	}
+	return CanCraftRecipe(Container, Recipe);
+}
+
+TArray<UEISCraftingRecipe*> UEISCraftingSubsystem::GetCraftableRecipes(const UEISItemContainer* Container) const
+{
+	TArray<UEISCraftingRecipe*> Result;
+	if (const TBitArray<>* Craftable = CraftableRecipes.Find(Container))
+	{
+		for (TConstSetBitIterator<> It(*Craftable); It; ++It)
+		{
+			Result.Add(Recipes[It.GetIndex()]);
+		}
+	}
+	return Result;
+}
+
+bool UEISCraftingSubsystem::CanStoreRecipeOutputs(const UEISItemContainer* Container, const UEISCraftingRecipe* Recipe,
+                                                  int Times) const
+{
+	if (!Container || !Recipe || Times <= 0)
+	{
+		return false;
+	}
+
+	// Outputs repeating a class share the room left for it.
+	TMap<const UEISItemInstance*, int64, TInlineSetAllocator<4>> OutputAmounts;
+	for (const FEISRecipeOutput& Output : Recipe->Outputs)
+	{
+		if (!Output.ItemClass)
+		{
+			return false;
+		}
+		OutputAmounts.FindOrAdd(Output.ItemClass.GetDefaultObject()) += static_cast<int64>(Output.Amount) * Times;
+	}
+
+	TArray<TPair<const UEISItemInstance*, int>, TInlineAllocator<4>> ItemAmounts;
+	for (const TPair<const UEISItemInstance*, int64>& OutputAmount : OutputAmounts)
+	{
+		if (OutputAmount.Value > MAX_int32)
+		{
+			return false;
+		}
+		ItemAmounts.Emplace(OutputAmount.Key, static_cast<int>(OutputAmount.Value));
+	}
+
+	// All outputs go in together, so they are checked against the shared budgets at once.
+	return Container->CanAddItemAmounts(ItemAmounts);
+}
+
+bool UEISCraftingSubsystem::CraftRecipe(UEISItemContainer* Container, UEISCraftingRecipe* Recipe, int Times)
+{
+	if (!CanCraftRecipe(Container, Recipe, Times) || !CanStoreRecipeOutputs(Container, Recipe, Times))
+	{
+		return false;
+	}
+
+	FEISItemContainerChangeBatch ChangeBatch(Container);
+	
+	for (const FRecipeRequirement& Requirement : RecipeRequirements[RecipeIndices.FindChecked(Recipe)])
+	{
+		UEISInventoryFunctionLibrary::Container_ConsumeItemAmount(Container, Requirement.Definition,
+		                                                          Requirement.Amount * Times);
+	}
+
+	for (const FEISRecipeOutput& Output : Recipe->Outputs)
+	{
+		// CanStoreRecipeOutputs checked the room for all outputs together, so nothing should be left over.
+		const int RemainingAmount = UEISInventoryFunctionLibrary::Container_InsertItemAmount(
+			Container, Output.ItemClass, Output.Amount * Times);
+		UE_CLOG(RemainingAmount > 0, LogEnhancedInventorySystem, Warning,
+		        TEXT("Recipe %s left %d of %s without room in %s."), *Recipe->GetName(), RemainingAmount,
+		        *Output.ItemClass->GetName(), *Container->GetName());
+	}
+	return true;
+}
+
+bool UEISCraftingSubsystem::IsRecipeSatisfied(const UEISItemContainer* Container, int32 RecipeIndex,
+                                              int32 Times) const
+{
+	for (const FRecipeRequirement& Requirement : RecipeRequirements[RecipeIndex])
+	{
+		if (Container->GetItemCount(Requirement.Definition) < Requirement.Amount * Times)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool UEISCraftingSubsystem::EvaluateRecipe(const UEISItemContainer* Container, TBitArray<>& Craftable,
+                                           int32 RecipeIndex) const
+{
+	const bool bCraftable = IsRecipeSatisfied(Container, RecipeIndex, 1);
+	if (Craftable[RecipeIndex] != bCraftable)
+	{
+		Craftable[RecipeIndex] = bCraftable;
+		return true;
+	}
+	return false;
+}
+
+void UEISCraftingSubsystem::OnItemCountChange(const UEISItemDefinition* Definition, int32 Delta,
+                                              UEISItemContainer* Container)
+{
+	const TArray<int32>* AffectedRecipes = IngredientRecipes.Find(Definition);
+	TBitArray<>* Craftable = CraftableRecipes.Find(Container);
+	
+	if (!AffectedRecipes || !Craftable)
+	{
+		return;
+	}
+
+	bool bChanged = false;
+	for (const int32 RecipeIndex : *AffectedRecipes)
+	{
+		bChanged |= EvaluateRecipe(Container, *Craftable, RecipeIndex);
+	}
+
+	if (bChanged)
+	{
+		OnCraftableRecipesChangeDelegate.Broadcast(Container);
+	}
+}
@@ -1,29 +1,92 @@
 ﻿// Fill out your copyright notice in the Description page of Project Settings.
 
 #include "EISInventoryFunctionLibrary.h"
+#include "EISEquipmentComponent.h"
 #include "EISEquipmentSlot.h"
+#include "EISGridItemContainer.h"
 #include "EISItemInstance.h"
 #include "EISItemContainer.h"
+#include "EISItemRegistrySubsystem.h"
 #include "EISItemRepositoryInterface.h"
 
-int UEISInventoryFunctionLibrary::LastItemId {0};
+std::atomic<int> UEISInventoryFunctionLibrary::LastItemId {0};
+
+static FName MakeItemObjectName(const UEISItemInstance* SourceItem, int ItemId)
+{
+	// Numbered names reuse the script name entry instead of building a new string per item.
+	return FName(SourceItem->GetScriptName(), NAME_EXTERNAL_TO_INTERNAL(ItemId));
+}
+
+static void RegisterGeneratedItem(UWorld* World, UEISItemInstance* Item)
+{
+	if (UEISItemRegistrySubsystem* Registry = UWorld::GetSubsystem<UEISItemRegistrySubsystem>(World))
+	{
+		Registry->RegisterItem(Item);
+	}
+}
 
 UEISItemInstance* UEISInventoryFunctionLibrary::GenerateItem(UWorld* World, const UEISItemInstance* SourceItem)
 {
 	if (SourceItem)
 	{
+		const int ItemId = GenerateItemId();
 		if (UEISItemInstance* NewItem = NewObject<UEISItemInstance>(World, SourceItem->GetClass(),
-		                                            FName(SourceItem->GetScriptName().ToString() + FString::Printf(
-			                                            TEXT("_object%d"), LastItemId + 1))))
+		                                                            MakeItemObjectName(SourceItem, ItemId)))
+		{
+			NewItem->Initialize(ItemId, SourceItem);
+			RegisterGeneratedItem(World, NewItem);
+			return NewItem;
+		}
+	}
+	return nullptr;
+}
+
+UEISItemInstance* UEISInventoryFunctionLibrary::GenerateItemWithData(UWorld* World, const UEISItemInstance* SourceItem,
+                                                                     const FEISItemInstanceData& ItemData)
+{
+	if (SourceItem)
+	{
+		// Loaded items bring their own ids, which the items they replace may still be named after.
+		FName ItemName = MakeItemObjectName(SourceItem, ItemData.ItemId);
+		if (StaticFindObjectFast(nullptr, World, ItemName))
 		{
-			LastItemId++;
-			NewItem->Initialize(LastItemId, SourceItem);
+			ItemName = MakeUniqueObjectName(World, SourceItem->GetClass(), ItemName);
+		}
+		
+		if (UEISItemInstance* NewItem = NewObject<UEISItemInstance>(World, SourceItem->GetClass(), ItemName))
+		{
+			NewItem->ApplyItemInstanceData(ItemData);
+			NewItem->Initialize(ItemData.ItemId, SourceItem);
+			RegisterGeneratedItem(World, NewItem);
 			return NewItem;
 		}
 	}
 	return nullptr;
 }
 
+int UEISInventoryFunctionLibrary::GenerateItemId()
+{
+	return ++LastItemId;
+}
+
+void UEISInventoryFunctionLibrary::ReserveItemIds(int ItemId)
+{
+	int CurrentId = LastItemId.load();
+	while (CurrentId < ItemId && !LastItemId.compare_exchange_weak(CurrentId, ItemId))
+	{
+	}
+}
+
+void UEISInventoryFunctionLibrary::Container_EnsureStartingData(UEISItemContainer* Container)
+{
+	if (!Container)
+	{
+		return;
+	}
+
+	Container->EnsureStartingData();
+}
+
 bool UEISInventoryFunctionLibrary::Container_FindAvailablePlace(UEISItemContainer* Container, UEISItemInstance* Item)
 {
 	if (!Container || !Item)
@@ -34,14 +97,14 @@ bool UEISInventoryFunctionLibrary::Container_FindAvailablePlace(UEISItemContaine
 	return Container->FindAvailablePlace(Item);
 }
 
-void UEISInventoryFunctionLibrary::Container_AddItem(UEISItemContainer* Container, UEISItemInstance* Item)
+bool UEISInventoryFunctionLibrary::Container_AddItem(UEISItemContainer* Container, UEISItemInstance* Item)
 {
 	if (!Container || !Item)
 	{
-		return;
+		return false;
 	}
 
-	Container->AddItem(Item);
+	return Container->AddItem(Item);
 }
 
 void UEISInventoryFunctionLibrary::Container_RemoveItem(UEISItemContainer* Container, UEISItemInstance* Item)
@@ -75,6 +138,72 @@ void UEISInventoryFunctionLibrary::Container_SplitItem(UEISItemContainer* Contai
 	Container->SplitItem(Item, Amount);
 }
 
+void UEISInventoryFunctionLibrary::Container_ConsolidateStacks(UEISItemContainer* Container)
+{
+	if (!Container)
+	{
+		return;
+	}
+
+	Container->ConsolidateStacks();
+}
+
+void UEISInventoryFunctionLibrary::Container_SortItems(UEISItemContainer* Container, EEISItemSortKey SortKey,
+                                                       bool bDescending)
+{
+	if (!Container)
+	{
+		return;
+	}
+
+	Container->SortItems(SortKey, bDescending);
+}
+
+int UEISInventoryFunctionLibrary::Container_InsertItemAmount(UEISItemContainer* Container,
+                                                             TSubclassOf<UEISItemInstance> ItemClass, int Amount)
+{
+	if (!Container || !ItemClass)
+	{
+		return Amount;
+	}
+
+	return Container->InsertItemAmount(ItemClass, Amount);
+}
+
+int UEISInventoryFunctionLibrary::Container_ConsumeItemAmount(UEISItemContainer* Container,
+                                                              const UEISItemDefinition* Definition, int Amount)
+{
+	if (!Container || !Definition)
+	{
+		return 0;
+	}
+
+	return Container->ConsumeItemAmount(Definition, Amount);
+}
+
+UEISItemInstance* UEISInventoryFunctionLibrary::Container_MaterializeCommodity(UEISItemContainer* Container,
+                                                                               TSubclassOf<UEISItemInstance> ItemClass,
+                                                                               int Amount)
+{
+	if (!Container || !ItemClass)
+	{
+		return nullptr;
+	}
+
+	return Container->MaterializeCommodity(ItemClass, Amount);
+}
+
+bool UEISInventoryFunctionLibrary::Container_MoveGridItem(UEISGridItemContainer* Container, UEISItemInstance* Item,
+                                                         FIntPoint Position, bool bRotated)
+{
+	if (!Container || !Item)
+	{
+		return false;
+	}
+
+	return Container->MoveItemTo(Item, Position, bRotated);
+}
+
 void UEISInventoryFunctionLibrary::Slot_EquipItem(UEISEquipmentSlot* EquipmentSlot, UEISItemInstance* Item)
 {
 	if (!EquipmentSlot || !Item)
@@ -101,6 +230,17 @@ void UEISInventoryFunctionLibrary::Slot_UnequipItem(UEISEquipmentSlot* Equipment
 	}
 }
 
+bool UEISInventoryFunctionLibrary::Equipment_ApplyLoadout(UEISEquipmentComponent* EquipmentComponent, FName LoadoutName,
+                                                          UEISItemContainer* Container)
+{
+	if (!EquipmentComponent)
+	{
+		return false;
+	}
+
+	return EquipmentComponent->ApplyLoadoutInternal(LoadoutName, Container);
+}
+
 void UEISInventoryFunctionLibrary::MoveItemFromContainerToContainer(UEISItemContainer* SourceContainer,
 																	UEISItemContainer* TargetContainer,
 																	UEISItemInstance* Item, bool bFullStack)
@@ -112,17 +252,11 @@ void UEISInventoryFunctionLibrary::MoveItemFromContainerToContainer(UEISItemCont
 
 	if (!bFullStack && Item->GetAmount() > Item->GetStackAmount())
 	{
-		if (UEISItemInstance* StackableItem = TargetContainer->FindFirstStackForItem(Item))
-		{
-			StackableItem->AddAmount(Item->GetStackAmount());
-		}
-		else if (UEISItemInstance* NewItem = GenerateItem(TargetContainer->GetWorld(), Item))
+		const int MovedAmount = Item->GetStackAmount() - TargetContainer->InsertItemAmountFrom(Item, Item->GetStackAmount());
+		if (MovedAmount > 0)
 		{
-			NewItem->SetAmount(NewItem->GetStackAmount());
-			Container_AddItem(TargetContainer, NewItem);
+			Item->RemoveAmount(MovedAmount);
 		}
-
-		Item->RemoveAmount(Item->GetStackAmount());
 	}
 	else
 	{
@@ -133,6 +267,20 @@ void UEISInventoryFunctionLibrary::MoveItemFromContainerToContainer(UEISItemCont
 	}
 }
 
+bool UEISInventoryFunctionLibrary::MoveAllItemsFromContainerToContainer(UEISItemContainer* SourceContainer,
+                                                                        UEISItemContainer* TargetContainer,
+                                                                        const FGameplayTagContainer& Filter,
+                                                                        TArray<UEISItemInstance*>& OutRemainingItems)
+{
+	if (!SourceContainer || !TargetContainer)
+	{
+		OutRemainingItems.Reset();
+		return false;
+	}
+
+	return TargetContainer->MoveAllItemsFrom(SourceContainer, Filter, OutRemainingItems);
+}
+
 void UEISInventoryFunctionLibrary::MoveItemFromContainerToSlot(UEISItemContainer* SourceContainer,
                                                                UEISEquipmentSlot* TargetSlot, UEISItemInstance* Item)
 {
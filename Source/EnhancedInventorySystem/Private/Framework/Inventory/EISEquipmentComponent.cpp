@@ -3,6 +3,8 @@
 #include "EISEquipmentComponent.h"
 #include "EISEquipmentSlot.h"
 #include "EISInventoryFunctionLibrary.h"
+#include "EISItemContainer.h"
+#include "EISItemInstance.h"
 
 UEISEquipmentComponent::UEISEquipmentComponent(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
@@ -11,7 +13,15 @@ UEISEquipmentComponent::UEISEquipmentComponent(const FObjectInitializer& ObjectI
 
 void UEISEquipmentComponent::AddEquipmentSlot(UEISEquipmentSlot* NewEquipmentSlot)
 {
-	EquipmentSlots.AddUnique(NewEquipmentSlot);
+	if (NewEquipmentSlot && !EquipmentSlots.Contains(NewEquipmentSlot))
+	{
+		EquipmentSlots.Add(NewEquipmentSlot);
+
+		if (HasBegunPlay())
+		{
+			BindEquipmentSlot(NewEquipmentSlot);
+		}
+	}
 }
 
 void UEISEquipmentComponent::EquipSlot(const FString& SlotName, UEISItemInstance* ItemInstance)
@@ -59,7 +69,304 @@ bool UEISEquipmentComponent::CanEquipItemAtSlot(const FString& SlotName, const U
 	return false;
 }
 
+void UEISEquipmentComponent::SaveLoadout(FName LoadoutName)
+{
+	FEISEquipmentLoadout* Loadout = Loadouts.FindByPredicate([LoadoutName](const FEISEquipmentLoadout& Other)
+	{
+		return Other.LoadoutName == LoadoutName;
+	});
+
+	if (!Loadout)
+	{
+		Loadout = &Loadouts.AddDefaulted_GetRef();
+		Loadout->LoadoutName = LoadoutName;
+	}
+
+	Loadout->Entries.Reset(EquipmentSlots.Num());
+	for (const UEISEquipmentSlot* Slot : EquipmentSlots)
+	{
+		if (Slot)
+		{
+			FEISEquipmentLoadoutEntry& Entry = Loadout->Entries.AddDefaulted_GetRef();
+			Entry.SlotName = Slot->GetSlotName();
+			Entry.ItemId = Slot->GetItemInstance() ? Slot->GetItemInstance()->GetItemId() : 0;
+		}
+	}
+}
+
+void UEISEquipmentComponent::RemoveLoadout(FName LoadoutName)
+{
+	Loadouts.RemoveAll([LoadoutName](const FEISEquipmentLoadout& Loadout)
+	{
+		return Loadout.LoadoutName == LoadoutName;
+	});
+}
+
+const FEISEquipmentLoadout* UEISEquipmentComponent::FindLoadout(FName LoadoutName) const
+{
+	return Loadouts.FindByPredicate([LoadoutName](const FEISEquipmentLoadout& Loadout)
+	{
+		return Loadout.LoadoutName == LoadoutName;
+	});
+}
+
+bool UEISEquipmentComponent::ApplyLoadout(FName LoadoutName, UEISItemContainer* Container)
+{
+	if (HasAuthority())
+	{
+		return ApplyLoadoutInternal(LoadoutName, Container);
+	}
+	return false;
+}
+
+bool UEISEquipmentComponent::ApplyLoadoutInternal(FName LoadoutName, UEISItemContainer* Container)
+{
+	const FEISEquipmentLoadout* Loadout = FindLoadout(LoadoutName);
+	if (!Loadout)
+	{
+		return false;
+	}
+
+	struct FSlotChange
+	{
+		UEISEquipmentSlot* Slot;
+		UEISItemInstance* NewItem;
+		bool bFromContainer;
+	};
+
+	TMap<int, UEISEquipmentSlot*> EquippedSlots;
+	for (UEISEquipmentSlot* Slot : EquipmentSlots)
+	{
+		if (Slot && Slot->GetItemInstance())
+		{
+			EquippedSlots.Add(Slot->GetItemInstance()->GetItemId(), Slot);
+		}
+	}
+
+	TArray<FSlotChange> Changes;
+	TSet<UEISEquipmentSlot*> ChangedSlots;
+	TSet<int> LoadoutItemIds;
+	
+	for (const FEISEquipmentLoadoutEntry& Entry : Loadout->Entries)
+	{
+		UEISEquipmentSlot* Slot = FindEquipmentSlotByName(Entry.SlotName);
+		if (!Slot || ChangedSlots.Contains(Slot))
+		{
+			return false;
+		}
+
+		bool bAlreadyInSet = false;
+		if (Entry.ItemId != 0)
+		{
+			LoadoutItemIds.Add(Entry.ItemId, &bAlreadyInSet);
+			if (bAlreadyInSet)
+			{
+				return false;
+			}
+		}
+
+		const UEISItemInstance* CurrentItem = Slot->GetItemInstance();
+		if ((CurrentItem ? CurrentItem->GetItemId() : 0) == Entry.ItemId)
+		{
+			continue;
+		}
+
+		FSlotChange& Change = Changes.Add_GetRef({Slot, nullptr, false});
+		ChangedSlots.Add(Slot);
+		
+		if (Entry.ItemId == 0)
+		{
+			continue;
+		}
+
+		if (UEISEquipmentSlot** FromSlot = EquippedSlots.Find(Entry.ItemId))
+		{
+			Change.NewItem = (*FromSlot)->GetItemInstance();
+		}
+		else if (Container)
+		{
+			Change.NewItem = Container->FindItemById(Entry.ItemId);
+			Change.bFromContainer = true;
+		}
+
+		if (!Change.NewItem || !Slot->IsAvailable() || !Slot->CanEquipItem(Change.NewItem))
+		{
+			return false;
+		}
+	}
+
+	// Slots left out of the loadout still give up items the loadout moves elsewhere.
+	for (int32 i = 0, Num = Changes.Num(); i < Num; i++)
+	{
+		if (Changes[i].NewItem && !Changes[i].bFromContainer)
+		{
+			UEISEquipmentSlot* FromSlot = EquippedSlots.FindChecked(Changes[i].NewItem->GetItemId());
+			if (!ChangedSlots.Contains(FromSlot))
+			{
+				Changes.Add({FromSlot, nullptr, false});
+				ChangedSlots.Add(FromSlot);
+			}
+		}
+	}
+
+	TArray<UEISItemInstance*> DisplacedItems;
+	for (const FSlotChange& Change : Changes)
+	{
+		UEISItemInstance* CurrentItem = Change.Slot->GetItemInstance();
+		if (CurrentItem && !LoadoutItemIds.Contains(CurrentItem->GetItemId()))
+		{
+			if (!Container || !Container->CanAddItem(CurrentItem))
+			{
+				return false;
+			}
+			DisplacedItems.Add(CurrentItem);
+		}
+	}
+
+	if (Changes.IsEmpty())
+	{
+		return true;
+	}
+
+	FEISItemContainerChangeBatch ContainerBatch(Container);
+	const bool bPredicted = !HasAuthority();
+
+	for (const FSlotChange& Change : Changes)
+	{
+		UEISInventoryFunctionLibrary::Slot_UnequipItem(Change.Slot);
+	}
+
+	for (const FSlotChange& Change : Changes)
+	{
+		if (!Change.NewItem)
+		{
+			continue;
+		}
+
+		if (Change.bFromContainer)
+		{
+			// Splitting a stack creates an item, which only the server may do; a client waits for the replicated slot.
+			if (bPredicted && Change.NewItem->GetAmount() > 1)
+			{
+				continue;
+			}
+
+			if (Change.NewItem->GetAmount() > 1)
+			{
+				if (UEISItemInstance* RemainedItem = UEISInventoryFunctionLibrary::GenerateItem(GetWorld(), Change.NewItem))
+				{
+					RemainedItem->SetAmount(Change.NewItem->GetAmount() - 1);
+					UEISInventoryFunctionLibrary::Container_AddItem(Container, RemainedItem);
+				}
+				Change.NewItem->SetAmount(1);
+			}
+			UEISInventoryFunctionLibrary::Container_RemoveItem(Container, Change.NewItem);
+		}
+		
+		UEISInventoryFunctionLibrary::Slot_EquipItem(Change.Slot, Change.NewItem);
+	}
+
+	for (UEISItemInstance* Item : DisplacedItems)
+	{
+		UEISInventoryFunctionLibrary::Container_AddItem(Container, Item);
+	}
+
+	OnLoadoutAppliedDelegate.Broadcast(LoadoutName);
+	OnLoadoutApplied.Broadcast(LoadoutName);
+	return true;
+}
+
 void UEISEquipmentComponent::BeginPlay()
 {
 	Super::BeginPlay();
+
+	for (UEISEquipmentSlot* Slot : EquipmentSlots)
+	{
+		BindEquipmentSlot(Slot);
+	}
+}
+
+void UEISEquipmentComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	for (UEISEquipmentSlot* Slot : EquipmentSlots)
+	{
+		UnbindEquipmentSlot(Slot);
+	}
+
+	StatTotals.Reset();
+	SlotStats.Reset();
+	
+	Super::EndPlay(EndPlayReason);
+}
+
+void UEISEquipmentComponent::BindEquipmentSlot(UEISEquipmentSlot* EquipmentSlot)
+{
+	if (!EquipmentSlot)
+	{
+		return;
+	}
+
+	EquipmentSlot->OnEquipmentSlotChangeDelegate.AddUObject(this, &ThisClass::OnEquipmentSlotChange, EquipmentSlot);
+	
+	if (UpdateSlotStats(EquipmentSlot))
+	{
+		OnStatTotalsChangeDelegate.Broadcast();
+		OnStatTotalsChange.Broadcast();
+	}
+}
+
+void UEISEquipmentComponent::UnbindEquipmentSlot(UEISEquipmentSlot* EquipmentSlot)
+{
+	if (EquipmentSlot)
+	{
+		EquipmentSlot->OnEquipmentSlotChangeDelegate.RemoveAll(this);
+	}
+}
+
+void UEISEquipmentComponent::OnEquipmentSlotChange(const FEISEquipmentSlotChangeData& ChangeData,
+                                                   UEISEquipmentSlot* EquipmentSlot)
+{
+	if (UpdateSlotStats(EquipmentSlot))
+	{
+		OnStatTotalsChangeDelegate.Broadcast();
+		OnStatTotalsChange.Broadcast();
+	}
+}
+
+bool UEISEquipmentComponent::UpdateSlotStats(UEISEquipmentSlot* EquipmentSlot)
+{
+	const UEISItemInstance* Item = EquipmentSlot->GetItemInstance();
+	const UEISItemStatsComponent* StatsComponent = Item
+		                                               ? Item->GetComponentByClass<UEISItemStatsComponent>(
+			                                               UEISItemStatsComponent::StaticClass())
+		                                               : nullptr;
+	
+	TArray<FEISItemStatModifier> PrevStats;
+	SlotStats.RemoveAndCopyValue(EquipmentSlot, PrevStats);
+
+	if (PrevStats.IsEmpty() && !StatsComponent)
+	{
+		return false;
+	}
+
+	for (const FEISItemStatModifier& Stat : PrevStats)
+	{
+		float& StatTotal = StatTotals.FindOrAdd(Stat.StatTag);
+		StatTotal -= Stat.Value;
+		
+		if (FMath::IsNearlyZero(StatTotal))
+		{
+			StatTotals.Remove(Stat.StatTag);
+		}
+	}
+
+	if (StatsComponent && !StatsComponent->GetStats().IsEmpty())
+	{
+		for (const FEISItemStatModifier& Stat : StatsComponent->GetStats())
+		{
+			StatTotals.FindOrAdd(Stat.StatTag) += Stat.Value;
+		}
+		SlotStats.Add(EquipmentSlot, StatsComponent->GetStats());
+	}
+	return true;
 }
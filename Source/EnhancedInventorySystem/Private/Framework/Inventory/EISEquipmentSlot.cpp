@@ -48,17 +48,56 @@ bool UEISEquipmentSlot::CanEquipItem(const UEISItemInstance* Item) const
 	return false;
 }
 
+uint32 UEISEquipmentSlot::GetContentsChecksum() const
+{
+	return ItemInstance ? ItemInstance->GetContentsHash() : 0;
+}
+
+TArray<UEISItemInstance*> UEISEquipmentSlot::GetRepositoryItems() const
+{
+	if (ItemInstance)
+	{
+		return TArray<UEISItemInstance*>{ItemInstance.Get()};
+	}
+	return {};
+}
+
 void UEISEquipmentSlot::CallRemoveItem(UEISItemInstance* Item)
 {
 	UnequipSlot();
 }
 
+void UEISEquipmentSlot::CallResyncItems(const TArray<UEISItemInstance*>& InItems,
+                                        const TArray<FEISItemInstanceData>& InItemsData)
+{
+	UEISItemInstance* NewItem = InItems.IsValidIndex(0) && InItemsData.IsValidIndex(0) ? InItems[0] : nullptr;
+	if (NewItem)
+	{
+		NewItem->ApplyItemInstanceData(InItemsData[0]);
+	}
+
+	if (NewItem != ItemInstance)
+	{
+		if (IsEquipped())
+		{
+			UnequipSlot();
+		}
+		
+		if (NewItem)
+		{
+			EquipSlot(NewItem);
+		}
+	}
+}
+
 void UEISEquipmentSlot::EquipSlot(UEISItemInstance* InItemInstance)
 {
 	check(InItemInstance);
 
 	ItemInstance = InItemInstance;
 	ItemInstance->AddToEquipmentSlot(this);
+	ItemInstance->OnAmountChangeDelegate.AddUObject(this, &ThisClass::OnItemAmountChange);
+	PublishSnapshot();
 	OnEquipmentSlotChangeDelegate.Broadcast(FEISEquipmentSlotChangeData(SlotName, ItemInstance.Get(), IsEquipped()));
 	OnEquipmentSlotChange.Broadcast(FEISEquipmentSlotChangeData(SlotName, ItemInstance.Get(), IsEquipped()));
 }
@@ -68,7 +107,9 @@ void UEISEquipmentSlot::UnequipSlot()
 	check(ItemInstance);
 
 	UEISItemInstance* PrevObject = ItemInstance;
+	PrevObject->OnAmountChangeDelegate.RemoveAll(this);
 	ItemInstance = nullptr;
+	PublishSnapshot();
 	OnEquipmentSlotChangeDelegate.Broadcast(FEISEquipmentSlotChangeData(SlotName, ItemInstance.Get(), IsEquipped()));
 	OnEquipmentSlotChange.Broadcast(FEISEquipmentSlotChangeData(SlotName, PrevObject, IsEquipped()));
 }
@@ -79,8 +120,41 @@ void UEISEquipmentSlot::SetAvailability(bool bInAvailability)
 	OnAvailabilityChange.Broadcast(bAvailable);
 }
 
+void UEISEquipmentSlot::PublishSnapshot()
+{
+	TSharedRef<FEISRepositorySnapshot, ESPMode::ThreadSafe> Snapshot = MakeShared<
+		FEISRepositorySnapshot, ESPMode::ThreadSafe>();
+	Snapshot->Version = ++SnapshotVersion;
+
+	if (ItemInstance)
+	{
+		Snapshot->Entries.Add({ItemInstance->GetItemId(), ItemInstance->GetDefinitionIndex(),
+		                       ItemInstance->GetDefinition(), ItemInstance->GetAmount()});
+	}
+
+	SnapshotSource.Publish(Snapshot);
+}
+
+void UEISEquipmentSlot::OnItemAmountChange(int NewAmount, int PrevAmount)
+{
+	PublishSnapshot();
+}
+
 void UEISEquipmentSlot::OnRep_ItemInstance(UEISItemInstance* PrevItem)
 {
+	if (PrevItem != ItemInstance)
+	{
+		if (PrevItem)
+		{
+			PrevItem->OnAmountChangeDelegate.RemoveAll(this);
+		}
+
+		if (ItemInstance)
+		{
+			ItemInstance->OnAmountChangeDelegate.AddUObject(this, &ThisClass::OnItemAmountChange);
+		}
+	}
+
 	if (UEISItemInstance* ItemInst = IsEquipped() ? ItemInstance.Get() : PrevItem)
 	{
 		if (ItemInstance)
@@ -88,6 +162,7 @@ void UEISEquipmentSlot::OnRep_ItemInstance(UEISItemInstance* PrevItem)
 			ItemInstance->AddToEquipmentSlot(this);
 		}
 
+		PublishSnapshot();
 		OnEquipmentSlotChangeDelegate.Broadcast(FEISEquipmentSlotChangeData(SlotName, ItemInstance.Get(), IsEquipped()));
 		OnEquipmentSlotChange.Broadcast(FEISEquipmentSlotChangeData(SlotName, ItemInst, IsEquipped()));
 	}
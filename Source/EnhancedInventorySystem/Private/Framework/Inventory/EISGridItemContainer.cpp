@@ -0,0 +1,417 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EISGridItemContainer.h"
+#include "EISItemInstance.h"
+#include "Engine/World.h"
+#include "Net/UnrealNetwork.h"
+
+bool FEISGridPlacement::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	// Column, rotation and width share one packed value; both columns and widths stay below 64.
+	uint32 PackedItemId = static_cast<uint32>(ItemId);
+	uint32 PackedColumn = Position.X | (bRotated ? 1u << 6 : 0u) | (Size.X - 1) << 7;
+	uint32 PackedRow = Position.Y;
+	uint32 PackedHeight = Size.Y - 1;
+
+	Ar.SerializeIntPacked(PackedItemId);
+	Ar.SerializeIntPacked(PackedColumn);
+	Ar.SerializeIntPacked(PackedRow);
+	Ar.SerializeIntPacked(PackedHeight);
+
+	if (Ar.IsLoading())
+	{
+		ItemId = static_cast<int32>(PackedItemId);
+		Position = FIntPoint(PackedColumn & 63, PackedRow);
+		bRotated = (PackedColumn & 1u << 6) != 0;
+		Size = FIntPoint((PackedColumn >> 7) + 1, PackedHeight + 1);
+	}
+
+	bOutSuccess = true;
+	return true;
+}
+
+void UEISGridItemContainer::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	RowOccupancy.SetNumZeroed(GridHeight);
+}
+
+void UEISGridItemContainer::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ThisClass, Placements);
+}
+
+FIntPoint UEISGridItemContainer::GetItemFootprint(const UEISItemInstance* Item, bool bRotated)
+{
+	const UEISItemDefinition* Definition = Item ? Item->GetDefinition() : nullptr;
+	const FIntPoint Size = Definition ? Definition->GridSize.ComponentMax(FIntPoint(1, 1)) : FIntPoint(1, 1);
+	return bRotated ? FIntPoint(Size.Y, Size.X) : Size;
+}
+
+bool UEISGridItemContainer::FindItemPlacement(const UEISItemInstance* Item, FEISGridPlacement& OutPlacement) const
+{
+	EnsureStartingData();
+
+	const int32* Index = Item ? PlacementIndices.Find(Item->GetItemId()) : nullptr;
+	if (!Index)
+	{
+		return false;
+	}
+
+	OutPlacement = Placements[*Index];
+	return true;
+}
+
+UEISItemInstance* UEISGridItemContainer::GetItemAtCell(FIntPoint Cell) const
+{
+	EnsureStartingData();
+
+	if (Cell.X < 0 || Cell.X >= GridWidth || Cell.Y < 0 || Cell.Y >= GridHeight
+		|| (RowOccupancy[Cell.Y] & MakeRowMask(Cell.X, 1)) == 0)
+	{
+		return nullptr;
+	}
+
+	for (const FEISGridPlacement& Placement : Placements)
+	{
+		if (Cell.X >= Placement.Position.X && Cell.X < Placement.Position.X + Placement.Size.X
+			&& Cell.Y >= Placement.Position.Y && Cell.Y < Placement.Position.Y + Placement.Size.Y)
+		{
+			return FindItemById(Placement.ItemId);
+		}
+	}
+	return nullptr;
+}
+
+bool UEISGridItemContainer::IsAreaFree(FIntPoint Position, FIntPoint Size) const
+{
+	if (Position.X < 0 || Position.Y < 0 || Size.X <= 0 || Size.Y <= 0
+		|| Position.X + Size.X > GridWidth || Position.Y + Size.Y > GridHeight)
+	{
+		return false;
+	}
+
+	const uint64 Mask = MakeRowMask(Position.X, Size.X);
+	for (int32 Row = Position.Y; Row < Position.Y + Size.Y; Row++)
+	{
+		if ((RowOccupancy[Row] & Mask) != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool UEISGridItemContainer::FindFirstFit(FIntPoint Size, FIntPoint& OutPosition, bool& bOutRotated) const
+{
+	return FindFirstFitIn(RowOccupancy, Size, OutPosition, bOutRotated);
+}
+
+bool UEISGridItemContainer::FindFirstFitIn(const TArray<uint64>& Occupancy, FIntPoint Size, FIntPoint& OutPosition,
+                                           bool& bOutRotated) const
+{
+	bOutRotated = false;
+	if (FindFirstFitUpright(Occupancy, Size, OutPosition))
+	{
+		return true;
+	}
+
+	if (bAllowRotation && Size.X != Size.Y && FindFirstFitUpright(Occupancy, FIntPoint(Size.Y, Size.X), OutPosition))
+	{
+		bOutRotated = true;
+		return true;
+	}
+	return false;
+}
+
+bool UEISGridItemContainer::FindFirstFitUpright(const TArray<uint64>& Occupancy, FIntPoint Size,
+                                                FIntPoint& OutPosition) const
+{
+	if (Size.X <= 0 || Size.Y <= 0 || Size.X > GridWidth || Size.Y > GridHeight)
+	{
+		return false;
+	}
+
+	const uint64 GridMask = MakeRowMask(0, GridWidth);
+	for (int32 Y = 0; Y + Size.Y <= GridHeight; Y++)
+	{
+		uint64 Taken = 0;
+		for (int32 Row = Y; Row < Y + Size.Y; Row++)
+		{
+			Taken |= Occupancy[Row];
+		}
+
+		// Bit X ends up set when cells X to X + Size.X - 1 are free; each step doubles the run length it checks.
+		uint64 Starts = ~Taken & GridMask;
+		for (int32 Run = 1; Run < Size.X && Starts != 0;)
+		{
+			const int32 Shift = FMath::Min(Run, Size.X - Run);
+			Starts &= Starts >> Shift;
+			Run += Shift;
+		}
+
+		if (Starts != 0)
+		{
+			OutPosition = FIntPoint(FMath::CountTrailingZeros64(Starts), Y);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool UEISGridItemContainer::MoveItemTo(UEISItemInstance* Item, FIntPoint Position, bool bRotated)
+{
+	EnsureStartingData();
+
+	const int32* Index = Item ? PlacementIndices.Find(Item->GetItemId()) : nullptr;
+	if (!Index || (bRotated && !bAllowRotation))
+	{
+		return false;
+	}
+
+	FEISGridPlacement& Placement = Placements[*Index];
+	const FIntPoint Size = GetItemFootprint(Item, bRotated);
+
+	SetAreaOccupied(Placement.Position, Placement.Size, false);
+	if (!IsAreaFree(Position, Size))
+	{
+		SetAreaOccupied(Placement.Position, Placement.Size, true);
+		return false;
+	}
+
+	Placement.Position = Position;
+	Placement.Size = Size;
+	Placement.bRotated = bRotated;
+	SetAreaOccupied(Position, Size, true);
+
+	BroadcastLayoutChange();
+	return true;
+}
+
+void UEISGridItemContainer::OnItemAdded(UEISItemInstance* Item)
+{
+	Super::OnItemAdded(Item);
+
+	if (HasLayoutAuthority() && !PlacementIndices.Contains(Item->GetItemId()) && PlaceItem(Item))
+	{
+		BroadcastLayoutChange();
+	}
+}
+
+void UEISGridItemContainer::OnItemRemoved(UEISItemInstance* Item)
+{
+	Super::OnItemRemoved(Item);
+
+	if (HasLayoutAuthority() && PlacementIndices.Contains(Item->GetItemId()))
+	{
+		RemovePlacement(Item->GetItemId());
+		BroadcastLayoutChange();
+	}
+}
+
+bool UEISGridItemContainer::PlaceItem(const UEISItemInstance* Item)
+{
+	FEISGridPlacement Placement;
+	Placement.ItemId = Item->GetItemId();
+	if (!FindFirstFit(GetItemFootprint(Item, false), Placement.Position, Placement.bRotated))
+	{
+		return false;
+	}
+
+	Placement.Size = GetItemFootprint(Item, Placement.bRotated);
+	AddPlacement(Placement);
+	return true;
+}
+
+bool UEISGridItemContainer::CanPlaceItem(const UEISItemInstance* Item) const
+{
+	FIntPoint Position;
+	bool bRotated;
+	return FindFirstFit(GetItemFootprint(Item, false), Position, bRotated);
+}
+
+int32 UEISGridItemContainer::GetFreeEntryCount(const UEISItemInstance* Item) const
+{
+	const int32 MaxFreeEntries = Super::GetFreeEntryCount(Item);
+	const FIntPoint Size = GetItemFootprint(Item, false);
+	if (Size == FIntPoint(1, 1))
+	{
+		return FMath::Min(MaxFreeEntries, GridWidth * GridHeight - OccupiedCells);
+	}
+
+	// Larger items fragment the free cells, so copies are placed on a scratch occupancy until none fits.
+	TArray<uint64> Occupancy = RowOccupancy;
+	int32 FreeEntries = 0;
+	while (FreeEntries < MaxFreeEntries && OccupyFirstFit(Occupancy, Size))
+	{
+		FreeEntries++;
+	}
+	return FreeEntries;
+}
+
+bool UEISGridItemContainer::CanPlaceItems(TConstArrayView<TPair<const UEISItemInstance*, int32>> ItemEntries) const
+{
+	TArray<uint64> Occupancy = RowOccupancy;
+	for (const TPair<const UEISItemInstance*, int32>& ItemEntry : ItemEntries)
+	{
+		const FIntPoint Size = GetItemFootprint(ItemEntry.Key, false);
+		for (int32 Entry = 0; Entry < ItemEntry.Value; Entry++)
+		{
+			if (!OccupyFirstFit(Occupancy, Size))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void UEISGridItemContainer::SaveLayout(FArchive& Ar) const
+{
+	uint32 NumPlacements = Placements.Num();
+	Ar.SerializeIntPacked(NumPlacements);
+
+	bool bSuccess = true;
+	for (FEISGridPlacement Placement : Placements)
+	{
+		Placement.NetSerialize(Ar, nullptr, bSuccess);
+	}
+}
+
+void UEISGridItemContainer::LoadLayout(FArchive& Ar)
+{
+	uint32 NumPlacements = 0;
+	Ar.SerializeIntPacked(NumPlacements);
+
+	const TArray<UEISItemInstance*> RestoredItems = GetItems();
+	TSet<int32> ItemIds;
+	ItemIds.Reserve(RestoredItems.Num());
+	for (const UEISItemInstance* Item : RestoredItems)
+	{
+		ItemIds.Add(Item->GetItemId());
+	}
+
+	// Saved placements replace the ones the restored items were given on insertion.
+	Placements.Reset();
+	bool bSuccess = true;
+	for (uint32 Index = 0; Index < NumPlacements && !Ar.IsError(); Index++)
+	{
+		FEISGridPlacement Placement;
+		Placement.NetSerialize(Ar, nullptr, bSuccess);
+
+		if (ItemIds.Remove(Placement.ItemId) > 0)
+		{
+			Placements.Add(Placement);
+		}
+	}
+	RebuildOccupancy();
+
+	for (const UEISItemInstance* Item : RestoredItems)
+	{
+		if (ItemIds.Contains(Item->GetItemId()))
+		{
+			PlaceItem(Item);
+		}
+	}
+
+	BroadcastLayoutChange();
+}
+
+void UEISGridItemContainer::SetAreaOccupied(FIntPoint Position, FIntPoint Size, bool bOccupied)
+{
+	const uint64 Mask = MakeRowMask(Position.X, Size.X);
+	for (int32 Row = Position.Y; Row < Position.Y + Size.Y; Row++)
+	{
+		if (bOccupied)
+		{
+			RowOccupancy[Row] |= Mask;
+		}
+		else
+		{
+			RowOccupancy[Row] &= ~Mask;
+		}
+	}
+
+	OccupiedCells += (bOccupied ? 1 : -1) * Size.X * Size.Y;
+}
+
+bool UEISGridItemContainer::OccupyFirstFit(TArray<uint64>& Occupancy, FIntPoint Size) const
+{
+	FIntPoint Position;
+	bool bRotated;
+	if (!FindFirstFitIn(Occupancy, Size, Position, bRotated))
+	{
+		return false;
+	}
+
+	const FIntPoint PlacedSize = bRotated ? FIntPoint(Size.Y, Size.X) : Size;
+	const uint64 Mask = MakeRowMask(Position.X, PlacedSize.X);
+	for (int32 Row = Position.Y; Row < Position.Y + PlacedSize.Y; Row++)
+	{
+		Occupancy[Row] |= Mask;
+	}
+	return true;
+}
+
+void UEISGridItemContainer::AddPlacement(const FEISGridPlacement& Placement)
+{
+	PlacementIndices.Add(Placement.ItemId, Placements.Add(Placement));
+	SetAreaOccupied(Placement.Position, Placement.Size, true);
+}
+
+void UEISGridItemContainer::RemovePlacement(int32 ItemId)
+{
+	int32 Index;
+	if (!PlacementIndices.RemoveAndCopyValue(ItemId, Index))
+	{
+		return;
+	}
+
+	SetAreaOccupied(Placements[Index].Position, Placements[Index].Size, false);
+
+	Placements.RemoveAtSwap(Index);
+	if (Placements.IsValidIndex(Index))
+	{
+		PlacementIndices.Add(Placements[Index].ItemId, Index);
+	}
+}
+
+void UEISGridItemContainer::RebuildOccupancy()
+{
+	RowOccupancy.Reset();
+	RowOccupancy.SetNumZeroed(GridHeight);
+	OccupiedCells = 0;
+	PlacementIndices.Reset();
+
+	for (int32 Index = 0; Index < Placements.Num(); Index++)
+	{
+		const FEISGridPlacement& Placement = Placements[Index];
+		PlacementIndices.Add(Placement.ItemId, Index);
+
+		if (Placement.Position.X + Placement.Size.X <= GridWidth && Placement.Position.Y + Placement.Size.Y <= GridHeight)
+		{
+			SetAreaOccupied(Placement.Position, Placement.Size, true);
+		}
+	}
+}
+
+bool UEISGridItemContainer::HasLayoutAuthority() const
+{
+	const UWorld* World = GetWorld();
+	return !World || World->GetNetMode() != NM_Client;
+}
+
+void UEISGridItemContainer::BroadcastLayoutChange()
+{
+	OnLayoutChangeDelegate.Broadcast();
+	OnLayoutChange.Broadcast();
+}
+
+void UEISGridItemContainer::OnRep_Placements()
+{
+	RebuildOccupancy();
+	BroadcastLayoutChange();
+}
@@ -60,7 +60,11 @@ void UEISInventoryComponent::BeginPlay()
 
 	if (HasAuthority())
 	{
-		if (ItemContainer)
+		if (ItemContainer && bGenerateStartingDataAsync)
+		{
+			ItemContainer->AddStartingDataAsync();
+		}
+		else if (ItemContainer)
 		{
 			ItemContainer->AddStartingData();
 		}
@@ -1,13 +1,27 @@
 ﻿// Fill out your copyright notice in the Description page of Project Settings.
 
 #include "EISInventoryManagerComponent.h"
+#include "Algo/Count.h"
+#include "EISCraftingRecipe.h"
+#include "EISCraftingSubsystem.h"
 #include "EISEquipmentComponent.h"
 #include "EISEquipmentSlot.h"
 #include "EISInventoryComponent.h"
 #include "EISInventoryFunctionLibrary.h"
+#include "EISInventoryPersistenceSubsystem.h"
+#include "EISInventorySerializer.h"
 #include "EISItemContainer.h"
+#include "EISItemRegistrySubsystem.h"
+#include "EISItemRepositoryInterface.h"
 #include "Engine/ActorChannel.h"
 #include "Net/UnrealNetwork.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+static EEISInventoryOperationResult MakeOperationResult(bool bSucceeded)
+{
+	return bSucceeded ? EEISInventoryOperationResult::Succeeded : EEISInventoryOperationResult::Rejected;
+}
 
 UEISItemContainer* FEISAppliedItemContainers::AddEntry(UEISItemContainer* ItemContainer)
 {
@@ -38,6 +52,28 @@ void FEISAppliedItemContainers::RemoveEntry(UEISItemContainer* ItemContainer)
 void FEISAppliedItemContainers::Clear()
 {
 	Entries.Empty();
+	MarkArrayDirty();
+}
+
+void FEISAppliedItemContainerEntry::PreReplicatedRemove(const FEISAppliedItemContainers& InArraySerializer)
+{
+	if (InArraySerializer.InventoryManagerComponent && ItemContainer)
+	{
+		InArraySerializer.InventoryManagerComponent->RemoveCountedContainer(ItemContainer);
+	}
+}
+
+void FEISAppliedItemContainerEntry::PostReplicatedAdd(const FEISAppliedItemContainers& InArraySerializer)
+{
+	if (InArraySerializer.InventoryManagerComponent && ItemContainer)
+	{
+		InArraySerializer.InventoryManagerComponent->AddCountedContainer(ItemContainer);
+	}
+}
+
+void FEISAppliedItemContainerEntry::PostReplicatedChange(const FEISAppliedItemContainers& InArraySerializer)
+{
+	PostReplicatedAdd(InArraySerializer);
 }
 
 UEISInventoryManagerComponent::UEISInventoryManagerComponent(const FObjectInitializer& ObjectInitializer) :
@@ -53,6 +89,7 @@ void UEISInventoryManagerComponent::GetLifetimeReplicatedProps(TArray<FLifetimeP
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
 	DOREPLIFETIME_CONDITION(ThisClass, ReplicatedContainers, COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(ThisClass, ReplicatedSlots, COND_OwnerOnly);
 }
 
 bool UEISInventoryManagerComponent::ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch,
@@ -64,7 +101,18 @@ bool UEISInventoryManagerComponent::ReplicateSubobjects(UActorChannel* Channel,
 		UEISItemContainer* Instance = Entry.ItemContainer;
 		if (IsValid(Instance))
 		{
+			Instance->EnsureStartingData();
 			WroteSomething |= Channel->ReplicateSubobject(Instance, *Bunch, *RepFlags);
+			WroteSomething |= Instance->ReplicateSubobjects(Channel, Bunch, RepFlags);
+		}
+	}
+
+	for (UEISEquipmentSlot* Slot : ReplicatedSlots)
+	{
+		if (IsValid(Slot))
+		{
+			WroteSomething |= Channel->ReplicateSubobject(Slot, *Bunch, *RepFlags);
+			WroteSomething |= Slot->ReplicateSubobjects(Channel, Bunch, RepFlags);
 		}
 	}
 
@@ -73,22 +121,290 @@ bool UEISInventoryManagerComponent::ReplicateSubobjects(UActorChannel* Channel,
 
 void UEISInventoryManagerComponent::AddReplicatedContainer(UEISItemContainer* Container)
 {
+	Container->EnsureStartingData();
+	
 	ReplicatedContainers.AddEntry(Container);
+	AddCountedContainer(Container);
+	OnRepositoriesChangeDelegate.Broadcast();
 }
 
 void UEISInventoryManagerComponent::RemoveReplicatedContainer(UEISItemContainer* Container)
 {
 	ReplicatedContainers.RemoveEntry(Container);
+	RemoveCountedContainer(Container);
+	OnRepositoriesChangeDelegate.Broadcast();
 }
 
 void UEISInventoryManagerComponent::AddReplicatedSlot(UEISEquipmentSlot* EquipmentSlot)
 {
-	
+	check(EquipmentSlot);
+
+	if (!ReplicatedSlots.Contains(EquipmentSlot))
+	{
+		ReplicatedSlots.Add(EquipmentSlot);
+		AddCountedSlot(EquipmentSlot);
+		OnRepositoriesChangeDelegate.Broadcast();
+	}
 }
 
 void UEISInventoryManagerComponent::RemoveReplicatedSlot(UEISEquipmentSlot* EquipmentSlot)
 {
-	
+	check(EquipmentSlot);
+
+	if (ReplicatedSlots.Remove(EquipmentSlot) > 0)
+	{
+		RemoveCountedSlot(EquipmentSlot);
+		OnRepositoriesChangeDelegate.Broadcast();
+	}
+}
+
+TArray<UEISItemContainer*> UEISInventoryManagerComponent::GetReplicatedContainers() const
+{
+	TArray<UEISItemContainer*> Containers;
+	Containers.Reserve(ReplicatedContainers.Entries.Num());
+	for (const FEISAppliedItemContainerEntry& Entry : ReplicatedContainers.Entries)
+	{
+		Containers.Add(Entry.ItemContainer);
+	}
+	return Containers;
+}
+
+void UEISInventoryManagerComponent::AddCountedContainer(UEISItemContainer* Container)
+{
+	bool bAlreadyCounted = false;
+	CountedContainers.Add(Container, &bAlreadyCounted);
+	if (bAlreadyCounted)
+	{
+		return;
+	}
+
+	Container->OnSubtreeCountChangeDelegate.AddUObject(this, &ThisClass::OnContainerItemCountChange);
+	for (const TPair<const UEISItemDefinition*, int32>& Count : Container->GetSubtreeCounts().DefinitionCounts)
+	{
+		ItemCounts.ApplyDelta(Count.Key, Count.Value);
+	}
+}
+
+void UEISInventoryManagerComponent::RemoveCountedContainer(UEISItemContainer* Container)
+{
+	if (CountedContainers.Remove(Container) == 0)
+	{
+		return;
+	}
+
+	Container->OnSubtreeCountChangeDelegate.RemoveAll(this);
+	for (const TPair<const UEISItemDefinition*, int32>& Count : Container->GetSubtreeCounts().DefinitionCounts)
+	{
+		ItemCounts.ApplyDelta(Count.Key, -Count.Value);
+	}
+}
+
+void UEISInventoryManagerComponent::AddCountedSlot(UEISEquipmentSlot* EquipmentSlot)
+{
+	if (SlotCounts.Contains(EquipmentSlot))
+	{
+		return;
+	}
+
+	SlotCounts.Add(EquipmentSlot, FSlotCount());
+	EquipmentSlot->OnEquipmentSlotChangeDelegate.AddUObject(this, &ThisClass::OnEquipmentSlotChange, EquipmentSlot);
+	UpdateSlotCount(EquipmentSlot);
+}
+
+void UEISInventoryManagerComponent::RemoveCountedSlot(UEISEquipmentSlot* EquipmentSlot)
+{
+	FSlotCount SlotCount;
+	if (SlotCounts.RemoveAndCopyValue(EquipmentSlot, SlotCount))
+	{
+		EquipmentSlot->OnEquipmentSlotChangeDelegate.RemoveAll(this);
+		ItemCounts.ApplyDelta(SlotCount.Definition, -SlotCount.Amount);
+
+		if (UEISItemInstance* Item = SlotCount.Item.Get())
+		{
+			Item->OnAmountChangeDelegate.RemoveAll(this);
+		}
+
+		if (UEISItemContainer* ChildContainer = SlotCount.ChildContainer.Get())
+		{
+			RemoveCountedContainer(ChildContainer);
+		}
+	}
+}
+
+void UEISInventoryManagerComponent::UpdateSlotCount(UEISEquipmentSlot* EquipmentSlot)
+{
+	FSlotCount* SlotCount = SlotCounts.Find(EquipmentSlot);
+	if (!SlotCount)
+	{
+		return;
+	}
+
+	UEISItemInstance* Item = EquipmentSlot->GetItemInstance();
+	const UEISItemDefinition* Definition = Item ? Item->GetDefinition() : nullptr;
+	const int32 Amount = Item ? Item->GetAmount() : 0;
+	UEISItemContainer* ChildContainer = Item ? Item->GetChildContainer() : nullptr;
+
+	if (SlotCount->Item != Item)
+	{
+		if (UEISItemInstance* PrevItem = SlotCount->Item.Get())
+		{
+			PrevItem->OnAmountChangeDelegate.RemoveAll(this);
+		}
+
+		SlotCount->Item = Item;
+		if (Item)
+		{
+			Item->OnAmountChangeDelegate.AddUObject(this, &ThisClass::OnEquippedItemAmountChange, EquipmentSlot);
+		}
+	}
+
+	if (SlotCount->Definition != Definition || SlotCount->Amount != Amount)
+	{
+		ItemCounts.ApplyDelta(SlotCount->Definition, -SlotCount->Amount);
+		ItemCounts.ApplyDelta(Definition, Amount);
+		SlotCount->Definition = Definition;
+		SlotCount->Amount = Amount;
+	}
+
+	if (SlotCount->ChildContainer != ChildContainer)
+	{
+		if (UEISItemContainer* PrevChildContainer = SlotCount->ChildContainer.Get())
+		{
+			RemoveCountedContainer(PrevChildContainer);
+		}
+
+		SlotCount->ChildContainer = ChildContainer;
+		if (ChildContainer)
+		{
+			AddCountedContainer(ChildContainer);
+		}
+	}
+}
+
+TArray<UEISItemInstance*> UEISInventoryManagerComponent::FindItemsAnywhere(const UEISItemDefinition* Definition) const
+{
+	TArray<UEISItemInstance*> FoundItems;
+	for (const TObjectKey<UEISItemContainer>& ContainerKey : CountedContainers)
+	{
+		if (const UEISItemContainer* Container = ContainerKey.ResolveObjectPtr())
+		{
+			FoundItems.Append(Container->FindItemsInSubtree(Definition));
+		}
+	}
+
+	for (const UEISEquipmentSlot* EquipmentSlot : ReplicatedSlots)
+	{
+		UEISItemInstance* Item = EquipmentSlot ? EquipmentSlot->GetItemInstance() : nullptr;
+		if (Item && Item->GetDefinition() == Definition)
+		{
+			FoundItems.Add(Item);
+		}
+	}
+	return FoundItems;
+}
+
+void UEISInventoryManagerComponent::SaveInventory(TArray<uint8>& OutData) const
+{
+	OutData.Reset();
+
+	FMemoryWriter Ar(OutData);
+	FEISInventoryWriter Writer(Ar);
+	Writer.WriteHeader();
+
+	Writer.WriteCount(ReplicatedContainers.Entries.Num());
+	for (const FEISAppliedItemContainerEntry& Entry : ReplicatedContainers.Entries)
+	{
+		Writer.WriteContainer(Entry.ItemContainer);
+	}
+
+	Writer.WriteCount(Algo::CountIf(ReplicatedSlots, [](const UEISEquipmentSlot* Slot) { return Slot != nullptr; }));
+	for (const UEISEquipmentSlot* EquipmentSlot : ReplicatedSlots)
+	{
+		if (EquipmentSlot)
+		{
+			Writer.WriteSlot(EquipmentSlot);
+		}
+	}
+}
+
+bool UEISInventoryManagerComponent::LoadInventory(const TArray<uint8>& Data)
+{
+	if (!HasAuthority())
+	{
+		return false;
+	}
+
+	FMemoryReader Ar(Data);
+	FEISInventoryRestore Restore;
+	FEISInventoryReader Reader(Ar, GetWorld(), Restore);
+
+	int32 NumContainers = 0;
+	if (!Reader.ReadHeader() || !Reader.ReadCount(NumContainers))
+	{
+		return false;
+	}
+
+	for (int32 Index = 0; Index < NumContainers; Index++)
+	{
+		const bool bKnownContainer = ReplicatedContainers.Entries.IsValidIndex(Index);
+		if (!Reader.ReadContainer(bKnownContainer ? ReplicatedContainers.Entries[Index].ItemContainer : nullptr))
+		{
+			return false;
+		}
+	}
+
+	int32 NumSlots = 0;
+	if (!Reader.ReadCount(NumSlots))
+	{
+		return false;
+	}
+
+	for (int32 Index = 0; Index < NumSlots; Index++)
+	{
+		if (!Reader.ReadSlot(ReplicatedSlots))
+		{
+			return false;
+		}
+	}
+
+	Restore.Commit();
+	return true;
+}
+
+void UEISInventoryManagerComponent::OnContainerItemCountChange(const UEISItemDefinition* Definition, int32 Delta)
+{
+	ItemCounts.ApplyDelta(Definition, Delta);
+}
+
+void UEISInventoryManagerComponent::OnEquipmentSlotChange(const FEISEquipmentSlotChangeData& ChangeData,
+                                                          UEISEquipmentSlot* EquipmentSlot)
+{
+	UpdateSlotCount(EquipmentSlot);
+}
+
+void UEISInventoryManagerComponent::OnEquippedItemAmountChange(int NewAmount, int PrevAmount,
+                                                               UEISEquipmentSlot* EquipmentSlot)
+{
+	UpdateSlotCount(EquipmentSlot);
+}
+
+void UEISInventoryManagerComponent::OnRep_ReplicatedSlots(const TArray<UEISEquipmentSlot*>& PrevSlots)
+{
+	for (UEISEquipmentSlot* Slot : PrevSlots)
+	{
+		if (Slot && !ReplicatedSlots.Contains(Slot))
+		{
+			RemoveCountedSlot(Slot);
+		}
+	}
+
+	for (UEISEquipmentSlot* Slot : ReplicatedSlots)
+	{
+		if (Slot)
+		{
+			AddCountedSlot(Slot);
+		}
+	}
 }
 
 void UEISInventoryManagerComponent::SetupInventoryManager(APawn* OwnPawn)
@@ -129,8 +445,24 @@ void UEISInventoryManagerComponent::SetupInventoryManager(APawn* OwnPawn)
 
 void UEISInventoryManagerComponent::ResetInventoryManager(APawn* OwnPawn)
 {
+	for (const FEISAppliedItemContainerEntry& Entry : ReplicatedContainers.Entries)
+	{
+		if (Entry.ItemContainer)
+		{
+			RemoveCountedContainer(Entry.ItemContainer);
+		}
+	}
 	ReplicatedContainers.Clear();
 
+	for (UEISEquipmentSlot* Slot : ReplicatedSlots)
+	{
+		if (Slot)
+		{
+			RemoveCountedSlot(Slot);
+		}
+	}
+	ReplicatedSlots.Reset();
+
 	K2_OnResetInventoryManager();
 }
 
@@ -146,21 +478,61 @@ void UEISInventoryManagerComponent::BeginPlay()
 
 void UEISInventoryManagerComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
+	// Persist the inventory while its containers are still in place.
+	if (UEISInventoryPersistenceSubsystem* Persistence = UWorld::GetSubsystem<UEISInventoryPersistenceSubsystem>(GetWorld()))
+	{
+		Persistence->UnregisterInventory(this);
+	}
+
 	ResetInventoryManager(GetPawn<APawn>());
+
+	TArray<int32> PendingRequestIds;
+	PendingOperations.GetKeys(PendingRequestIds);
+	for (const int32 RequestId : PendingRequestIds)
+	{
+		CompleteOperation(RequestId, EEISInventoryOperationResult::Cancelled);
+	}
 	
 	Super::EndPlay(EndPlayReason);
 }
 
-void UEISInventoryManagerComponent::Container_AddItem(UObject* FromSource, UEISItemContainer* ToContainer,
-                                                      UEISItemInstance* Item)
+TFuture<EEISInventoryOperationResult> UEISInventoryManagerComponent::GetOperationFuture(int32 RequestId)
+{
+	if (TArray<TPromise<EEISInventoryOperationResult>>* Promises = PendingOperations.Find(RequestId))
+	{
+		return Promises->AddDefaulted_GetRef().GetFuture();
+	}
+
+	EEISInventoryOperationResult Result = EEISInventoryOperationResult::Cancelled;
+	FindOperationResult(RequestId, Result);
+	return MakeFulfilledPromise<EEISInventoryOperationResult>(Result).GetFuture();
+}
+
+bool UEISInventoryManagerComponent::FindOperationResult(int32 RequestId, EEISInventoryOperationResult& OutResult) const
+{
+	for (const TPair<int32, EEISInventoryOperationResult>& CompletedOperation : CompletedOperations)
+	{
+		if (CompletedOperation.Key == RequestId)
+		{
+			OutResult = CompletedOperation.Value;
+			return true;
+		}
+	}
+	return false;
+}
+
+int32 UEISInventoryManagerComponent::Container_AddItem(UObject* FromSource, UEISItemContainer* ToContainer,
+                                                       UEISItemInstance* Item)
 {
 	check(FromSource);
 	check(ToContainer);
 	check(Item);
 
+	const int32 RequestId = BeginOperation();
+
 	if (!GetController<AController>())
 	{
-		return;
+		return RejectOperation(RequestId);
 	}
 	
 	if (!HasAuthority() && IsLocalController())
@@ -172,21 +544,26 @@ void UEISInventoryManagerComponent::Container_AddItem(UObject* FromSource, UEISI
 		}
 		else
 		{
-			return;
+			return RejectOperation(RequestId);
 		}
 	}
 
-	ServerContainerAddItem(FromSource, ToContainer, Item);
+	ServerContainerAddItem(RequestId, FromSource, ToContainer, Item->GetItemHandle());
+	VerifyRepositoryChecksum(ToContainer);
+	VerifyRepositoryChecksum(FromSource);
+	return RequestId;
 }
 
-void UEISInventoryManagerComponent::Container_RemoveItem(UEISItemContainer* Container, UEISItemInstance* Item)
+int32 UEISInventoryManagerComponent::Container_RemoveItem(UEISItemContainer* Container, UEISItemInstance* Item)
 {
 	check(Container);
 	check(Item);
 
+	const int32 RequestId = BeginOperation();
+
 	if (!GetController<AController>())
 	{
-		return;
+		return RejectOperation(RequestId);
 	}
 	
 	if (!HasAuthority() && IsLocalController())
@@ -197,80 +574,193 @@ void UEISInventoryManagerComponent::Container_RemoveItem(UEISItemContainer* Cont
 		}
 		else
 		{
-			return;
+			return RejectOperation(RequestId);
 		}
 	}
 
-	ServerContainerRemoveItem(Container, Item);
+	ServerContainerRemoveItem(RequestId, Container, Item->GetItemHandle());
+	VerifyRepositoryChecksum(Container);
+	return RequestId;
 }
 
-void UEISInventoryManagerComponent::Container_StackItem(UObject* FromSource, UEISItemContainer* InContainer,
-                                                        UEISItemInstance* SourceItem, UEISItemInstance* TargetItem)
+int32 UEISInventoryManagerComponent::Container_StackItem(UObject* FromSource, UEISItemContainer* InContainer,
+                                                         UEISItemInstance* SourceItem, UEISItemInstance* TargetItem)
 {
 	check(FromSource);
 	check(InContainer);
 	check(SourceItem);
 	check(TargetItem);
 	
+	const int32 RequestId = BeginOperation();
+
 	if (!GetController<AController>())
 	{
-		return;
+		return RejectOperation(RequestId);
 	}
 	
 	if (!HasAuthority() && IsLocalController())
 	{
-		if (TargetItem->CanStackItem(SourceItem))
+		if (TargetItem->CanStackItem(SourceItem) && InContainer->GetStackableAmount(SourceItem, TargetItem) > 0)
 		{
+			const bool bFullStack = InContainer->GetStackableAmount(SourceItem, TargetItem) >= SourceItem->GetAmount();
 			UEISInventoryFunctionLibrary::Container_StackItem(InContainer, SourceItem, TargetItem);
-			RemoveItemFromSource(FromSource, SourceItem);
+			
+			if (bFullStack)
+			{
+				RemoveItemFromSource(FromSource, SourceItem);
+			}
 		}
 		else
 		{
-			return;
+			return RejectOperation(RequestId);
 		}
 	}
 
-	ServerContainerStackItem(FromSource, InContainer, SourceItem, TargetItem);
+	ServerContainerStackItem(RequestId, FromSource, InContainer, SourceItem->GetItemHandle(),
+	                         TargetItem->GetItemHandle());
+	VerifyRepositoryChecksum(InContainer);
+	if (FromSource != InContainer)
+	{
+		VerifyRepositoryChecksum(FromSource);
+	}
+	return RequestId;
 }
 
-void UEISInventoryManagerComponent::Container_SplitItem(UEISItemContainer* Container, UEISItemInstance* Item, int Amount)
+int32 UEISInventoryManagerComponent::Container_SplitItem(UEISItemContainer* Container, UEISItemInstance* Item, int Amount)
 {
 	check(Container);
 	check(Item);
 
+	const int32 RequestId = BeginOperation();
+
 	if (!GetController<AController>() || Amount <= 0)
 	{
-		return;
+		return RejectOperation(RequestId);
 	}
 	
 	if (!HasAuthority() && IsLocalController())
 	{
-		if (Container->CanAddItem(Item))
+		if (!Container->CanSplitItem(Item, Amount))
 		{
-			if (Item->GetAmount() > 1 && Item->GetAmount() > Amount)
-			{
-				Item->RemoveAmount(Amount);
-			}
+			return RejectOperation(RequestId);
 		}
-		else
+		Item->RemoveAmount(Amount);
+	}
+
+	ServerContainerSplitItem(RequestId, Container, Item->GetItemHandle(), Amount);
+	VerifyRepositoryChecksum(Container);
+	return RequestId;
+}
+
+int32 UEISInventoryManagerComponent::Container_ConsolidateStacks(UEISItemContainer* Container)
+{
+	check(Container);
+
+	const int32 RequestId = BeginOperation();
+
+	if (!GetController<AController>())
+	{
+		return RejectOperation(RequestId);
+	}
+
+	if (!HasAuthority() && IsLocalController())
+	{
+		UEISInventoryFunctionLibrary::Container_ConsolidateStacks(Container);
+	}
+
+	ServerContainerConsolidateStacks(RequestId, Container);
+	VerifyRepositoryChecksum(Container);
+	return RequestId;
+}
+
+int32 UEISInventoryManagerComponent::Container_SortItems(UEISItemContainer* Container, EEISItemSortKey SortKey,
+                                                         bool bDescending)
+{
+	check(Container);
+
+	const int32 RequestId = BeginOperation();
+
+	if (!GetController<AController>())
+	{
+		return RejectOperation(RequestId);
+	}
+
+	if (!HasAuthority() && IsLocalController())
+	{
+		UEISInventoryFunctionLibrary::Container_SortItems(Container, SortKey, bDescending);
+	}
+
+	ServerContainerSortItems(RequestId, Container, SortKey, bDescending);
+	return RequestId;
+}
+
+int32 UEISInventoryManagerComponent::Container_MoveAllItems(UEISItemContainer* SourceContainer,
+                                                            UEISItemContainer* TargetContainer,
+                                                            FGameplayTagContainer Filter)
+{
+	check(SourceContainer);
+	check(TargetContainer);
+
+	const int32 RequestId = BeginOperation();
+
+	if (!GetController<AController>() || SourceContainer == TargetContainer)
+	{
+		return RejectOperation(RequestId);
+	}
+
+	if (!HasAuthority() && IsLocalController())
+	{
+		TArray<UEISItemInstance*> RemainingItems;
+		UEISInventoryFunctionLibrary::MoveAllItemsFromContainerToContainer(SourceContainer, TargetContainer, Filter,
+		                                                                   RemainingItems);
+	}
+
+	ServerContainerMoveAllItems(RequestId, SourceContainer, TargetContainer, Filter);
+	VerifyRepositoryChecksum(TargetContainer);
+	VerifyRepositoryChecksum(SourceContainer);
+	return RequestId;
+}
+
+int32 UEISInventoryManagerComponent::Container_CraftRecipe(UEISItemContainer* Container, UEISCraftingRecipe* Recipe,
+                                                           int Times)
+{
+	check(Container);
+	check(Recipe);
+
+	const int32 RequestId = BeginOperation();
+
+	UEISCraftingSubsystem* CraftingSubsystem = UWorld::GetSubsystem<UEISCraftingSubsystem>(GetWorld());
+	if (!GetController<AController>() || !CraftingSubsystem || Times <= 0)
+	{
+		return RejectOperation(RequestId);
+	}
+
+	// Outputs are new items, which only the server may create, so a client checks the craft without predicting it.
+	if (!HasAuthority() && IsLocalController())
+	{
+		if (!CraftingSubsystem->CanCraftRecipe(Container, Recipe, Times)
+			|| !CraftingSubsystem->CanStoreRecipeOutputs(Container, Recipe, Times))
 		{
-			return;
+			return RejectOperation(RequestId);
 		}
 	}
 
-	ServerContainerSplitItem(Container, Item, Amount);
+	ServerContainerCraftRecipe(RequestId, Container, Recipe, Times);
+	return RequestId;
 }
 
-void UEISInventoryManagerComponent::EquipSlot(UObject* FromSource, UEISEquipmentSlot* AtEquipmentSlot,
-                                              UEISItemInstance* Item)
+int32 UEISInventoryManagerComponent::EquipSlot(UObject* FromSource, UEISEquipmentSlot* AtEquipmentSlot,
+                                               UEISItemInstance* Item)
 {
 	check(FromSource);
 	check(AtEquipmentSlot);
 	check(Item);
 
+	const int32 RequestId = BeginOperation();
+
 	if (!GetController<AController>())
 	{
-		return;
+		return RejectOperation(RequestId);
 	}
 
 	if (!HasAuthority() && IsLocalController())
@@ -282,20 +772,25 @@ void UEISInventoryManagerComponent::EquipSlot(UObject* FromSource, UEISEquipment
 		}
 		else
 		{
-			return;
+			return RejectOperation(RequestId);
 		}
 	}
 
-	ServerSlotEquipItem(FromSource, AtEquipmentSlot, Item);
+	ServerSlotEquipItem(RequestId, FromSource, AtEquipmentSlot, Item->GetItemHandle());
+	VerifyRepositoryChecksum(AtEquipmentSlot);
+	VerifyRepositoryChecksum(FromSource);
+	return RequestId;
 }
 
-void UEISInventoryManagerComponent::UnequipSlot(UEISEquipmentSlot* EquipmentSlot)
+int32 UEISInventoryManagerComponent::UnequipSlot(UEISEquipmentSlot* EquipmentSlot)
 {
 	check(EquipmentSlot);
 
+	const int32 RequestId = BeginOperation();
+
 	if (!GetController<AController>())
 	{
-		return;
+		return RejectOperation(RequestId);
 	}
 
 	if (!HasAuthority() && IsLocalController())
@@ -306,11 +801,58 @@ void UEISInventoryManagerComponent::UnequipSlot(UEISEquipmentSlot* EquipmentSlot
 		}
 		else
 		{
-			return;
+			return RejectOperation(RequestId);
+		}
+	}
+
+	ServerSlotUnequipItem(RequestId, EquipmentSlot);
+	VerifyRepositoryChecksum(EquipmentSlot);
+	return RequestId;
+}
+
+int32 UEISInventoryManagerComponent::SaveLoadout(UEISEquipmentComponent* EquipmentComponent, FName LoadoutName)
+{
+	check(EquipmentComponent);
+
+	const int32 RequestId = BeginOperation();
+
+	if (!GetController<AController>())
+	{
+		return RejectOperation(RequestId);
+	}
+
+	if (!HasAuthority() && IsLocalController())
+	{
+		EquipmentComponent->SaveLoadout(LoadoutName);
+	}
+
+	ServerSaveLoadout(RequestId, EquipmentComponent, LoadoutName);
+	return RequestId;
+}
+
+int32 UEISInventoryManagerComponent::ApplyLoadout(UEISEquipmentComponent* EquipmentComponent, FName LoadoutName,
+                                                  UEISItemContainer* Container)
+{
+	check(EquipmentComponent);
+
+	const int32 RequestId = BeginOperation();
+
+	if (!GetController<AController>())
+	{
+		return RejectOperation(RequestId);
+	}
+
+	if (!HasAuthority() && IsLocalController())
+	{
+		if (!UEISInventoryFunctionLibrary::Equipment_ApplyLoadout(EquipmentComponent, LoadoutName, Container))
+		{
+			return RejectOperation(RequestId);
 		}
 	}
 
-	ServerSlotUnequipItem(EquipmentSlot);
+	ServerApplyLoadout(RequestId, EquipmentComponent, LoadoutName, Container);
+	VerifyRepositoryChecksum(Container);
+	return RequestId;
 }
 
 void UEISInventoryManagerComponent::RemoveItemFromSource(UObject* Source, UEISItemInstance* Item)
@@ -323,72 +865,406 @@ void UEISInventoryManagerComponent::SubtractOrRemoveItemFromSource(UObject* Sour
 	UEISInventoryFunctionLibrary::SubtractOrRemoveItemFromSource(Source, Item, Amount);
 }
 
-void UEISInventoryManagerComponent::ServerContainerAddItem_Implementation(UObject* FromSource, UEISItemContainer* ToContainer, UEISItemInstance* Item)
+void UEISInventoryManagerComponent::ServerContainerAddItem_Implementation(int32 RequestId, UObject* FromSource,
+                                                                          UEISItemContainer* ToContainer,
+                                                                          FEISItemHandle ItemHandle)
 {
-	UEISInventoryFunctionLibrary::Container_AddItem(ToContainer, Item);
-	RemoveItemFromSource(FromSource, Item);
+	UEISItemInstance* Item = ResolveItemHandle(ItemHandle);
+	if (!Item || Item->GetOwner() != FromSource || !IsManagedRepository(FromSource) || !IsManagedRepository(ToContainer))
+	{
+		AcknowledgeOperation(RequestId, EEISInventoryOperationResult::Rejected);
+		return;
+	}
+	
+	const bool bSucceeded = ToContainer->CanAddItem(Item);
+	if (bSucceeded)
+	{
+		UEISInventoryFunctionLibrary::Container_AddItem(ToContainer, Item);
+		RemoveItemFromSource(FromSource, Item);
+	}
+
+	AcknowledgeOperation(RequestId, MakeOperationResult(bSucceeded));
 }
 
-bool UEISInventoryManagerComponent::ServerContainerAddItem_Validate(UObject* FromSource, UEISItemContainer* ToContainer, UEISItemInstance* Item)
+bool UEISInventoryManagerComponent::ServerContainerAddItem_Validate(int32 RequestId, UObject* FromSource,
+                                                                    UEISItemContainer* ToContainer,
+                                                                    FEISItemHandle ItemHandle)
 {
-	return IsValid(FromSource) && IsValid(ToContainer) && IsValid(Item);
+	return RequestId > 0 && IsValid(FromSource) && IsValid(ToContainer);
 }
 
-void UEISInventoryManagerComponent::ServerContainerRemoveItem_Implementation(UEISItemContainer* Container, UEISItemInstance* Item)
+void UEISInventoryManagerComponent::ServerContainerRemoveItem_Implementation(int32 RequestId,
+                                                                             UEISItemContainer* Container,
+                                                                             FEISItemHandle ItemHandle)
 {
-	UEISInventoryFunctionLibrary::Container_RemoveItem(Container, Item);
+	UEISItemInstance* Item = ResolveItemHandle(ItemHandle);
+	if (!Item || Item->GetOwner() != Container || !IsManagedRepository(Container))
+	{
+		AcknowledgeOperation(RequestId, EEISInventoryOperationResult::Rejected);
+		return;
+	}
+	
+	const bool bSucceeded = Container->Contains(Item);
+	if (bSucceeded)
+	{
+		UEISInventoryFunctionLibrary::Container_RemoveItem(Container, Item);
+	}
+
+	AcknowledgeOperation(RequestId, MakeOperationResult(bSucceeded));
 }
 
-bool UEISInventoryManagerComponent::ServerContainerRemoveItem_Validate(UEISItemContainer* Container, UEISItemInstance* Item)
+bool UEISInventoryManagerComponent::ServerContainerRemoveItem_Validate(int32 RequestId, UEISItemContainer* Container,
+                                                                       FEISItemHandle ItemHandle)
 {
-	return IsValid(Container) && IsValid(Item);
+	return RequestId > 0 && IsValid(Container);
 }
 
 void UEISInventoryManagerComponent::ServerContainerStackItem_Implementation(
-	UObject* FromSource, UEISItemContainer* InContainer, UEISItemInstance* SourceItem, UEISItemInstance* TargetItem)
+	int32 RequestId, UObject* FromSource, UEISItemContainer* InContainer, FEISItemHandle SourceItemHandle,
+	FEISItemHandle TargetItemHandle)
 {
-	UEISInventoryFunctionLibrary::Container_StackItem(InContainer, SourceItem, TargetItem);
-	RemoveItemFromSource(FromSource, SourceItem);
+	UEISItemInstance* SourceItem = ResolveItemHandle(SourceItemHandle);
+	UEISItemInstance* TargetItem = ResolveItemHandle(TargetItemHandle);
+	if (!SourceItem || !TargetItem || SourceItem->GetOwner() != FromSource || TargetItem->GetOwner() != InContainer ||
+		!IsManagedRepository(FromSource) || !IsManagedRepository(InContainer))
+	{
+		AcknowledgeOperation(RequestId, EEISInventoryOperationResult::Rejected);
+		return;
+	}
+	
+	const bool bFullStack = InContainer->GetStackableAmount(SourceItem, TargetItem) >= SourceItem->GetAmount();
+	const bool bSucceeded = UEISInventoryFunctionLibrary::Container_StackItem(InContainer, SourceItem, TargetItem);
+	if (bSucceeded && bFullStack)
+	{
+		RemoveItemFromSource(FromSource, SourceItem);
+	}
+
+	AcknowledgeOperation(RequestId, MakeOperationResult(bSucceeded));
 }
 
-bool UEISInventoryManagerComponent::ServerContainerStackItem_Validate(UObject* FromSource,
+bool UEISInventoryManagerComponent::ServerContainerStackItem_Validate(int32 RequestId, UObject* FromSource,
                                                                       UEISItemContainer* InContainer,
-                                                                      UEISItemInstance* SourceItem, UEISItemInstance* TargetItem)
+                                                                      FEISItemHandle SourceItemHandle,
+                                                                      FEISItemHandle TargetItemHandle)
+{
+	return RequestId > 0 && IsValid(FromSource) && IsValid(InContainer);
+}
+
+void UEISInventoryManagerComponent::ServerContainerSplitItem_Implementation(int32 RequestId,
+                                                                            UEISItemContainer* Container,
+                                                                            FEISItemHandle ItemHandle, int Amount)
+{
+	UEISItemInstance* Item = ResolveItemHandle(ItemHandle);
+	if (!Item || Item->GetOwner() != Container || !IsManagedRepository(Container))
+	{
+		AcknowledgeOperation(RequestId, EEISInventoryOperationResult::Rejected);
+		return;
+	}
+	
+	const bool bSucceeded = Container->CanSplitItem(Item, Amount);
+	if (bSucceeded)
+	{
+		UEISInventoryFunctionLibrary::Container_SplitItem(Container, Item, Amount);
+	}
+
+	AcknowledgeOperation(RequestId, MakeOperationResult(bSucceeded));
+}
+
+bool UEISInventoryManagerComponent::ServerContainerSplitItem_Validate(int32 RequestId, UEISItemContainer* Container,
+                                                                      FEISItemHandle ItemHandle, int Amount)
 {
-	return IsValid(FromSource) && IsValid(InContainer) && IsValid(SourceItem) && IsValid(TargetItem);
+	return RequestId > 0 && IsValid(Container) && Amount > 0;
+}
+
+void UEISInventoryManagerComponent::ServerContainerConsolidateStacks_Implementation(int32 RequestId,
+                                                                                    UEISItemContainer* Container)
+{
+	if (!IsManagedRepository(Container))
+	{
+		AcknowledgeOperation(RequestId, EEISInventoryOperationResult::Rejected);
+		return;
+	}
+	
+	UEISInventoryFunctionLibrary::Container_ConsolidateStacks(Container);
+	AcknowledgeOperation(RequestId, EEISInventoryOperationResult::Succeeded);
 }
 
-void UEISInventoryManagerComponent::ServerContainerSplitItem_Implementation(UEISItemContainer* Container, UEISItemInstance* Item, int Amount)
+bool UEISInventoryManagerComponent::ServerContainerConsolidateStacks_Validate(int32 RequestId,
+                                                                              UEISItemContainer* Container)
 {
-	UEISInventoryFunctionLibrary::Container_SplitItem(Container, Item, Amount);
+	return RequestId > 0 && IsValid(Container);
 }
 
-bool UEISInventoryManagerComponent::ServerContainerSplitItem_Validate(UEISItemContainer* Container, UEISItemInstance* Item, int Amount)
+void UEISInventoryManagerComponent::ServerContainerSortItems_Implementation(int32 RequestId,
+                                                                           UEISItemContainer* Container,
+                                                                           EEISItemSortKey SortKey, bool bDescending)
 {
-	return IsValid(Container) && IsValid(Item) && Amount > 0;
+	if (!IsManagedRepository(Container))
+	{
+		AcknowledgeOperation(RequestId, EEISInventoryOperationResult::Rejected);
+		return;
+	}
+	
+	UEISInventoryFunctionLibrary::Container_SortItems(Container, SortKey, bDescending);
+	AcknowledgeOperation(RequestId, EEISInventoryOperationResult::Succeeded);
 }
 
-void UEISInventoryManagerComponent::ServerSlotEquipItem_Implementation(UObject* FromSource,
+bool UEISInventoryManagerComponent::ServerContainerSortItems_Validate(int32 RequestId, UEISItemContainer* Container,
+                                                                     EEISItemSortKey SortKey, bool bDescending)
+{
+	return RequestId > 0 && IsValid(Container);
+}
+
+void UEISInventoryManagerComponent::ServerContainerMoveAllItems_Implementation(int32 RequestId,
+                                                                              UEISItemContainer* SourceContainer,
+                                                                              UEISItemContainer* TargetContainer,
+                                                                              const FGameplayTagContainer& Filter)
+{
+	if (!IsManagedRepository(SourceContainer) || !IsManagedRepository(TargetContainer))
+	{
+		AcknowledgeOperation(RequestId, EEISInventoryOperationResult::Rejected);
+		return;
+	}
+	
+	TArray<UEISItemInstance*> RemainingItems;
+	const bool bSucceeded = UEISInventoryFunctionLibrary::MoveAllItemsFromContainerToContainer(
+		SourceContainer, TargetContainer, Filter, RemainingItems);
+	AcknowledgeOperation(RequestId, MakeOperationResult(bSucceeded));
+}
+
+bool UEISInventoryManagerComponent::ServerContainerMoveAllItems_Validate(int32 RequestId,
+                                                                        UEISItemContainer* SourceContainer,
+                                                                        UEISItemContainer* TargetContainer,
+                                                                        const FGameplayTagContainer& Filter)
+{
+	return RequestId > 0 && IsValid(SourceContainer) && IsValid(TargetContainer) &&
+		SourceContainer != TargetContainer;
+}
+
+void UEISInventoryManagerComponent::ServerContainerCraftRecipe_Implementation(int32 RequestId,
+                                                                             UEISItemContainer* Container,
+                                                                             UEISCraftingRecipe* Recipe, int Times)
+{
+	UEISCraftingSubsystem* CraftingSubsystem = UWorld::GetSubsystem<UEISCraftingSubsystem>(GetWorld());
+	const bool bSucceeded = CraftingSubsystem && IsManagedRepository(Container) &&
+		CraftingSubsystem->CraftRecipe(Container, Recipe, Times);
+	AcknowledgeOperation(RequestId, MakeOperationResult(bSucceeded));
+}
+
+bool UEISInventoryManagerComponent::ServerContainerCraftRecipe_Validate(int32 RequestId, UEISItemContainer* Container,
+                                                                       UEISCraftingRecipe* Recipe, int Times)
+{
+	return RequestId > 0 && IsValid(Container) && IsValid(Recipe) && Times > 0;
+}
+
+void UEISInventoryManagerComponent::ServerSlotEquipItem_Implementation(int32 RequestId, UObject* FromSource,
                                                                        UEISEquipmentSlot* AtEquipmentSlot,
-                                                                       UEISItemInstance* Item)
+                                                                       FEISItemHandle ItemHandle)
 {
-	UEISInventoryFunctionLibrary::Slot_EquipItem(AtEquipmentSlot, Item);
-	RemoveItemFromSource(FromSource, Item);
+	UEISItemInstance* Item = ResolveItemHandle(ItemHandle);
+	if (!Item || Item->GetOwner() != FromSource || !IsManagedRepository(FromSource) ||
+		!IsManagedRepository(AtEquipmentSlot))
+	{
+		AcknowledgeOperation(RequestId, EEISInventoryOperationResult::Rejected);
+		return;
+	}
+	
+	const bool bSucceeded = AtEquipmentSlot->CanEquipItem(Item);
+	if (bSucceeded)
+	{
+		UEISInventoryFunctionLibrary::Slot_EquipItem(AtEquipmentSlot, Item);
+		RemoveItemFromSource(FromSource, Item);
+	}
+
+	AcknowledgeOperation(RequestId, MakeOperationResult(bSucceeded));
 }
 
-bool UEISInventoryManagerComponent::ServerSlotEquipItem_Validate(UObject* FromSource,
+bool UEISInventoryManagerComponent::ServerSlotEquipItem_Validate(int32 RequestId, UObject* FromSource,
                                                                  UEISEquipmentSlot* AtEquipmentSlot,
-                                                                 UEISItemInstance* Item)
+                                                                 FEISItemHandle ItemHandle)
 {
-	return IsValid(FromSource) && IsValid(AtEquipmentSlot) && IsValid(Item);
+	return RequestId > 0 && IsValid(FromSource) && IsValid(AtEquipmentSlot);
 }
 
-void UEISInventoryManagerComponent::ServerSlotUnequipItem_Implementation(UEISEquipmentSlot* EquipmentSlot)
+void UEISInventoryManagerComponent::ServerSlotUnequipItem_Implementation(int32 RequestId,
+                                                                         UEISEquipmentSlot* EquipmentSlot)
 {
-	UEISInventoryFunctionLibrary::Slot_UnequipItem(EquipmentSlot);
+	const bool bSucceeded = IsManagedRepository(EquipmentSlot) && EquipmentSlot->IsEquipped();
+	if (bSucceeded)
+	{
+		UEISInventoryFunctionLibrary::Slot_UnequipItem(EquipmentSlot);
+	}
+
+	AcknowledgeOperation(RequestId, MakeOperationResult(bSucceeded));
 }
 
-bool UEISInventoryManagerComponent::ServerSlotUnequipItem_Validate(UEISEquipmentSlot* EquipmentSlot)
+bool UEISInventoryManagerComponent::ServerSlotUnequipItem_Validate(int32 RequestId, UEISEquipmentSlot* EquipmentSlot)
 {
-	return IsValid(EquipmentSlot);
+	return RequestId > 0 && IsValid(EquipmentSlot);
+}
+
+void UEISInventoryManagerComponent::ServerSaveLoadout_Implementation(int32 RequestId,
+                                                                     UEISEquipmentComponent* EquipmentComponent,
+                                                                     FName LoadoutName)
+{
+	EquipmentComponent->SaveLoadout(LoadoutName);
+	AcknowledgeOperation(RequestId, EEISInventoryOperationResult::Succeeded);
+}
+
+bool UEISInventoryManagerComponent::ServerSaveLoadout_Validate(int32 RequestId,
+                                                               UEISEquipmentComponent* EquipmentComponent,
+                                                               FName LoadoutName)
+{
+	return RequestId > 0 && IsValid(EquipmentComponent);
+}
+
+void UEISInventoryManagerComponent::ServerApplyLoadout_Implementation(int32 RequestId,
+                                                                      UEISEquipmentComponent* EquipmentComponent,
+                                                                      FName LoadoutName,
+                                                                      UEISItemContainer* Container)
+{
+	if (Container && !IsManagedRepository(Container))
+	{
+		AcknowledgeOperation(RequestId, EEISInventoryOperationResult::Rejected);
+		return;
+	}
+	
+	const bool bSucceeded = UEISInventoryFunctionLibrary::Equipment_ApplyLoadout(EquipmentComponent, LoadoutName,
+	                                                                             Container);
+	AcknowledgeOperation(RequestId, MakeOperationResult(bSucceeded));
+}
+
+bool UEISInventoryManagerComponent::ServerApplyLoadout_Validate(int32 RequestId,
+                                                                UEISEquipmentComponent* EquipmentComponent,
+                                                                FName LoadoutName,
+                                                                UEISItemContainer* Container)
+{
+	return RequestId > 0 && IsValid(EquipmentComponent);
+}
+
+void UEISInventoryManagerComponent::ClientAcknowledgeOperation_Implementation(int32 RequestId,
+                                                                             EEISInventoryOperationResult Result)
+{
+	CompleteOperation(RequestId, Result);
+}
+
+void UEISInventoryManagerComponent::ServerVerifyChecksum_Implementation(UObject* Repository, uint32 Checksum)
+{
+	auto RepositoryInterface = Cast<IEISItemRepositoryInterface>(Repository);
+	if (!RepositoryInterface || RepositoryInterface->GetContentsChecksum() == Checksum)
+	{
+		return;
+	}
+
+	TArray<UEISItemInstance*> RepositoryItems = RepositoryInterface->GetRepositoryItems();
+	TArray<FEISItemInstanceData> RepositoryItemsData;
+	RepositoryItemsData.Reserve(RepositoryItems.Num());
+	
+	for (UEISItemInstance* Item : RepositoryItems)
+	{
+		RepositoryItemsData.Add(Item->GetItemInstanceData());
+	}
+
+	ClientResyncRepository(Repository, RepositoryItems, RepositoryItemsData);
+}
+
+bool UEISInventoryManagerComponent::ServerVerifyChecksum_Validate(UObject* Repository, uint32 Checksum)
+{
+	return IsValid(Repository);
+}
+
+void UEISInventoryManagerComponent::ClientResyncRepository_Implementation(UObject* Repository,
+                                                                          const TArray<UEISItemInstance*>& RepositoryItems,
+                                                                          const TArray<FEISItemInstanceData>& RepositoryItemsData)
+{
+	if (auto RepositoryInterface = Cast<IEISItemRepositoryInterface>(Repository))
+	{
+		RepositoryInterface->CallResyncItems(RepositoryItems, RepositoryItemsData);
+	}
+}
+
+void UEISInventoryManagerComponent::VerifyRepositoryChecksum(UObject* Repository)
+{
+	if (HasAuthority())
+	{
+		return;
+	}
+	
+	if (auto RepositoryInterface = Cast<IEISItemRepositoryInterface>(Repository))
+	{
+		ServerVerifyChecksum(Repository, RepositoryInterface->GetContentsChecksum());
+	}
+}
+
+void UEISInventoryManagerComponent::AcknowledgeOperation(int32 RequestId, EEISInventoryOperationResult Result)
+{
+	if (RequestId < 0)
+	{
+		CompleteOperation(RequestId, Result);
+	}
+	else
+	{
+		ClientAcknowledgeOperation(RequestId, Result);
+	}
+}
+
+int32 UEISInventoryManagerComponent::BeginOperation()
+{
+	// Operations started with authority count down, so they never collide with the ids clients send.
+	const int32 RequestId = HasAuthority() ? --LastRequestId : ++LastRequestId;
+	PendingOperations.Add(RequestId);
+	return RequestId;
+}
+
+int32 UEISInventoryManagerComponent::RejectOperation(int32 RequestId)
+{
+	CompleteOperation(RequestId, EEISInventoryOperationResult::Rejected);
+	return RequestId;
+}
+
+void UEISInventoryManagerComponent::CompleteOperation(int32 RequestId, EEISInventoryOperationResult Result)
+{
+	TArray<TPromise<EEISInventoryOperationResult>>* Promises = PendingOperations.Find(RequestId);
+	if (!Promises)
+	{
+		return;
+	}
+
+	TArray<TPromise<EEISInventoryOperationResult>> CompletedPromises = MoveTemp(*Promises);
+	PendingOperations.Remove(RequestId);
+
+	if (CompletedOperations.Num() < CompletedOperationsCapacity)
+	{
+		CompletedOperations.Emplace(RequestId, Result);
+	}
+	else
+	{
+		CompletedOperations[NextCompletedOperation] = TPair<int32, EEISInventoryOperationResult>(RequestId, Result);
+	}
+	NextCompletedOperation = (NextCompletedOperation + 1) % CompletedOperationsCapacity;
+
+	for (TPromise<EEISInventoryOperationResult>& Promise : CompletedPromises)
+	{
+		Promise.SetValue(Result);
+	}
+
+	OnOperationCompleteDelegate.Broadcast(RequestId, Result);
+	OnOperationComplete.Broadcast(RequestId, Result);
+}
+
+UEISItemInstance* UEISInventoryManagerComponent::ResolveItemHandle(const FEISItemHandle& ItemHandle) const
+{
+	const UEISItemRegistrySubsystem* Registry = UWorld::GetSubsystem<UEISItemRegistrySubsystem>(GetWorld());
+	return Registry ? Registry->ResolveItem(ItemHandle) : nullptr;
+}
+
+bool UEISInventoryManagerComponent::IsManagedRepository(const UObject* Repository) const
+{
+	if (!Repository)
+	{
+		return false;
+	}
+
+	return ReplicatedSlots.Contains(Repository) || ReplicatedContainers.Entries.ContainsByPredicate(
+		[Repository](const FEISAppliedItemContainerEntry& Entry) { return Entry.ItemContainer == Repository; });
 }
@@ -0,0 +1,56 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EISInventoryOperationAsyncAction.h"
+
+UEISInventoryOperationAsyncAction* UEISInventoryOperationAsyncAction::WaitForInventoryOperation(
+	UEISInventoryManagerComponent* InventoryManager, int32 RequestId)
+{
+	UEISInventoryOperationAsyncAction* Action = NewObject<UEISInventoryOperationAsyncAction>();
+	Action->InventoryManager = InventoryManager;
+	Action->RequestId = RequestId;
+	Action->RegisterWithGameInstance(InventoryManager);
+	return Action;
+}
+
+void UEISInventoryOperationAsyncAction::Activate()
+{
+	if (!InventoryManager)
+	{
+		Finish(EEISInventoryOperationResult::Cancelled);
+		return;
+	}
+
+	if (InventoryManager->IsOperationPending(RequestId))
+	{
+		OperationCompleteHandle = InventoryManager->OnOperationCompleteDelegate.AddUObject(
+			this, &ThisClass::OnOperationComplete);
+		return;
+	}
+
+	EEISInventoryOperationResult Result = EEISInventoryOperationResult::Cancelled;
+	InventoryManager->FindOperationResult(RequestId, Result);
+	Finish(Result);
+}
+
+void UEISInventoryOperationAsyncAction::OnOperationComplete(int32 InRequestId, EEISInventoryOperationResult Result)
+{
+	if (InRequestId == RequestId)
+	{
+		InventoryManager->OnOperationCompleteDelegate.Remove(OperationCompleteHandle);
+		Finish(Result);
+	}
+}
+
+void UEISInventoryOperationAsyncAction::Finish(EEISInventoryOperationResult Result)
+{
+	if (Result == EEISInventoryOperationResult::Succeeded)
+	{
+		OnSucceeded.Broadcast(Result);
+	}
+	else
+	{
+		OnFailed.Broadcast(Result);
+	}
+
+	SetReadyToDestroy();
+}
@@ -0,0 +1,796 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EISInventoryPersistenceSubsystem.h"
+#include "Async/Async.h"
+#include "Containers/Queue.h"
+#include "EISEquipmentSlot.h"
+#include "EISGridItemContainer.h"
+#include "EISInventoryManagerComponent.h"
+#include "EISInventorySerializer.h"
+#include "EISItemContainer.h"
+#include "EISItemInstance.h"
+#include "EnhancedInventorySystem.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/Crc.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include <atomic>
+
+static const TCHAR* ContainerPartPrefix = TEXT("Container.");
+static const TCHAR* SlotPartPrefix = TEXT("Slot.");
+
+/**
+ * Journal and snapshot share one record framing: payload size, payload CRC, then the payload holding the sequence
+ * number, inventory key, part name and part data. A size running past the end of the file or a CRC mismatch marks a
+ * torn tail, and reading stops there. The snapshot starts with a header naming the last sequence it covers, so journal
+ * records that survived a crash between writing the snapshot and resetting the journal are not applied twice. A record
+ * without part data removes the part; compaction leaves such records out.
+ */
+class FEISInventoryJournal : public FRunnable
+{
+public:
+	using FOnPartsLoaded = TFunction<void(FString, TArray<FEISInventoryJournalPart>)>;
+
+	FEISInventoryJournal(const FString& Directory, FOnPartsLoaded InOnPartsLoaded);
+	virtual ~FEISInventoryJournal() override;
+
+	void Append(const FString& InventoryKey, TArray<FEISInventoryJournalPart>&& Parts);
+
+	/** The callback runs on the journal thread once recovery has finished, with the latest parts stored for the key. */
+	void RequestLoad(const FString& InventoryKey);
+
+	void SetCompactionThreshold(int64 InCompactionThreshold) { CompactionThreshold = InCompactionThreshold; }
+
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	static constexpr uint32 SnapshotMagic = 0x534A4945;
+	static constexpr uint32 SnapshotVersion = 1;
+
+	struct FRecord
+	{
+		uint64 Sequence = 0;
+		FString InventoryKey;
+		FEISInventoryJournalPart Part;
+	};
+
+	/** Appends and loads share one queue, so a load always sees the appends queued before it. */
+	struct FCommand
+	{
+		FString InventoryKey;
+		TArray<FEISInventoryJournalPart> Parts;
+		bool bLoad = false;
+	};
+
+	static void WriteRecord(FArchive& Ar, FRecord& Record);
+
+	/** Returns false when reading stopped at a torn or damaged record; OutIntactSize is where the intact records end. */
+	bool ReadRecords(FArchive& Ar, uint64 MinSequence, int64& OutIntactSize);
+	void ApplyRecord(FRecord&& Record);
+	void Recover();
+	void ProcessCommands();
+	bool Compact();
+	void OpenJournal(bool bAppend);
+
+	FString JournalPath;
+	FString SnapshotPath;
+	FOnPartsLoaded OnPartsLoaded;
+
+	TQueue<FCommand, EQueueMode::Spsc> PendingCommands;
+	FEvent* WakeEvent = nullptr;
+	FRunnableThread* Thread = nullptr;
+	std::atomic<bool> bStopping {false};
+	std::atomic<int64> CompactionThreshold {4 * 1024 * 1024};
+
+	// Everything below is only touched by the journal thread.
+	TUniquePtr<FArchive> JournalWriter;
+	uint64 NextSequence = 1;
+	TMap<FString, TMap<FString, FRecord>> LatestRecords;
+};
+
+FEISInventoryJournal::FEISInventoryJournal(const FString& Directory, FOnPartsLoaded InOnPartsLoaded)
+	: JournalPath(Directory / TEXT("Inventory.journal")),
+	  SnapshotPath(Directory / TEXT("Inventory.snapshot")),
+	  OnPartsLoaded(MoveTemp(InOnPartsLoaded))
+{
+	WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	Thread = FRunnableThread::Create(this, TEXT("EISInventoryJournal"), 0, TPri_BelowNormal);
+}
+
+FEISInventoryJournal::~FEISInventoryJournal()
+{
+	if (Thread)
+	{
+		Thread->Kill(true);
+		delete Thread;
+	}
+	FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+}
+
+void FEISInventoryJournal::Append(const FString& InventoryKey, TArray<FEISInventoryJournalPart>&& Parts)
+{
+	PendingCommands.Enqueue(FCommand {InventoryKey, MoveTemp(Parts), false});
+	WakeEvent->Trigger();
+}
+
+void FEISInventoryJournal::RequestLoad(const FString& InventoryKey)
+{
+	PendingCommands.Enqueue(FCommand {InventoryKey, {}, true});
+	WakeEvent->Trigger();
+}
+
+uint32 FEISInventoryJournal::Run()
+{
+	Recover();
+
+	while (!bStopping)
+	{
+		ProcessCommands();
+		WakeEvent->Wait();
+	}
+
+	// Whatever was queued before the stop still goes to disk.
+	ProcessCommands();
+	JournalWriter.Reset();
+	return 0;
+}
+
+void FEISInventoryJournal::Stop()
+{
+	bStopping = true;
+	WakeEvent->Trigger();
+}
+
+void FEISInventoryJournal::WriteRecord(FArchive& Ar, FRecord& Record)
+{
+	TArray<uint8> Payload;
+	FMemoryWriter PayloadAr(Payload);
+	PayloadAr << Record.Sequence << Record.InventoryKey << Record.Part.PartName << Record.Part.Data;
+
+	uint32 Size = Payload.Num();
+	uint32 Crc = FCrc::MemCrc32(Payload.GetData(), Payload.Num());
+	Ar << Size << Crc;
+	Ar.Serialize(Payload.GetData(), Payload.Num());
+}
+
+bool FEISInventoryJournal::ReadRecords(FArchive& Ar, uint64 MinSequence, int64& OutIntactSize)
+{
+	TArray<uint8> Payload;
+	const int64 TotalSize = Ar.TotalSize();
+	OutIntactSize = Ar.Tell();
+	while (Ar.Tell() < TotalSize)
+	{
+		uint32 Size = 0;
+		uint32 Crc = 0;
+		if (TotalSize - Ar.Tell() < static_cast<int64>(sizeof(Size) + sizeof(Crc)))
+		{
+			return false;
+		}
+
+		Ar << Size << Crc;
+		if (Size > TotalSize - Ar.Tell())
+		{
+			return false;
+		}
+
+		Payload.SetNumUninitialized(Size);
+		Ar.Serialize(Payload.GetData(), Size);
+		if (Ar.IsError() || FCrc::MemCrc32(Payload.GetData(), Size) != Crc)
+		{
+			return false;
+		}
+
+		FRecord Record;
+		FMemoryReader PayloadAr(Payload);
+		PayloadAr << Record.Sequence << Record.InventoryKey << Record.Part.PartName << Record.Part.Data;
+		if (PayloadAr.IsError())
+		{
+			return false;
+		}
+
+		NextSequence = FMath::Max(NextSequence, Record.Sequence + 1);
+		if (Record.Sequence > MinSequence)
+		{
+			ApplyRecord(MoveTemp(Record));
+		}
+		OutIntactSize = Ar.Tell();
+	}
+	return true;
+}
+
+void FEISInventoryJournal::ApplyRecord(FRecord&& Record)
+{
+	const FString InventoryKey = Record.InventoryKey;
+	const FString PartName = Record.Part.PartName;
+	if (!Record.Part.Data.IsEmpty())
+	{
+		LatestRecords.FindOrAdd(InventoryKey).Add(PartName, MoveTemp(Record));
+		return;
+	}
+
+	TMap<FString, FRecord>* Records = LatestRecords.Find(InventoryKey);
+	if (Records && Records->Remove(PartName) > 0 && Records->IsEmpty())
+	{
+		LatestRecords.Remove(InventoryKey);
+	}
+}
+
+void FEISInventoryJournal::Recover()
+{
+	IFileManager& FileManager = IFileManager::Get();
+	FileManager.MakeDirectory(*FPaths::GetPath(JournalPath), true);
+
+	uint64 SnapshotSequence = 0;
+	int64 IntactSize = 0;
+	if (TUniquePtr<FArchive> SnapshotReader {FileManager.CreateFileReader(*SnapshotPath)})
+	{
+		uint32 Magic = 0;
+		uint32 Version = 0;
+		*SnapshotReader << Magic << Version << SnapshotSequence;
+
+		if (SnapshotReader->IsError() || Magic != SnapshotMagic || Version != SnapshotVersion)
+		{
+			UE_LOG(LogEnhancedInventorySystem, Error, TEXT("Inventory snapshot %s has an unknown format, ignoring it."),
+			       *SnapshotPath);
+			SnapshotSequence = 0;
+		}
+		else if (!ReadRecords(*SnapshotReader, 0, IntactSize))
+		{
+			UE_LOG(LogEnhancedInventorySystem, Error, TEXT("Inventory snapshot %s is damaged, keeping its intact records."),
+			       *SnapshotPath);
+		}
+		NextSequence = FMath::Max(NextSequence, SnapshotSequence + 1);
+	}
+
+	bool bCleanJournal = true;
+	if (TUniquePtr<FArchive> JournalReader {FileManager.CreateFileReader(*JournalPath)})
+	{
+		bCleanJournal = ReadRecords(*JournalReader, SnapshotSequence, IntactSize);
+	}
+
+	if (bCleanJournal)
+	{
+		OpenJournal(true);
+		return;
+	}
+
+	// Records appended behind a torn tail could never be read back, so the journal starts over from a snapshot, or
+	// failing that, is cut back to its intact records.
+	UE_LOG(LogEnhancedInventorySystem, Warning, TEXT("Inventory journal %s ends in a torn record, dropping it."),
+	       *JournalPath);
+
+	if (Compact())
+	{
+		return;
+	}
+
+	TUniquePtr<IFileHandle> JournalHandle {FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*JournalPath, true)};
+	if (JournalHandle && JournalHandle->Truncate(IntactSize))
+	{
+		JournalHandle.Reset();
+		OpenJournal(true);
+	}
+	else
+	{
+		UE_LOG(LogEnhancedInventorySystem, Error,
+		       TEXT("Could not drop the torn tail of inventory journal %s, changes are kept in memory only."),
+		       *JournalPath);
+	}
+}
+
+void FEISInventoryJournal::ProcessCommands()
+{
+	bool bAppended = false;
+	FCommand Command;
+	while (PendingCommands.Dequeue(Command))
+	{
+		if (Command.bLoad)
+		{
+			TArray<FEISInventoryJournalPart> Parts;
+			if (const TMap<FString, FRecord>* Records = LatestRecords.Find(Command.InventoryKey))
+			{
+				Parts.Reserve(Records->Num());
+				for (const TPair<FString, FRecord>& Record : *Records)
+				{
+					Parts.Add(Record.Value.Part);
+				}
+			}
+			OnPartsLoaded(MoveTemp(Command.InventoryKey), MoveTemp(Parts));
+			continue;
+		}
+
+		for (FEISInventoryJournalPart& Part : Command.Parts)
+		{
+			FRecord Record {NextSequence++, Command.InventoryKey, MoveTemp(Part)};
+			if (JournalWriter)
+			{
+				WriteRecord(*JournalWriter, Record);
+			}
+			ApplyRecord(MoveTemp(Record));
+			bAppended = true;
+		}
+	}
+
+	if (bAppended && JournalWriter)
+	{
+		JournalWriter->Flush();
+		if (JournalWriter->TotalSize() > CompactionThreshold)
+		{
+			Compact();
+		}
+	}
+}
+
+bool FEISInventoryJournal::Compact()
+{
+	IFileManager& FileManager = IFileManager::Get();
+	const FString TempPath = SnapshotPath + TEXT(".tmp");
+	{
+		TUniquePtr<FArchive> SnapshotWriter {FileManager.CreateFileWriter(*TempPath)};
+		if (!SnapshotWriter)
+		{
+			UE_LOG(LogEnhancedInventorySystem, Error, TEXT("Could not create inventory snapshot %s."), *TempPath);
+			return false;
+		}
+
+		uint32 Magic = SnapshotMagic;
+		uint32 Version = SnapshotVersion;
+		uint64 LastSequence = NextSequence - 1;
+		*SnapshotWriter << Magic << Version << LastSequence;
+
+		for (TPair<FString, TMap<FString, FRecord>>& Inventory : LatestRecords)
+		{
+			for (TPair<FString, FRecord>& Record : Inventory.Value)
+			{
+				WriteRecord(*SnapshotWriter, Record.Value);
+			}
+		}
+
+		if (!SnapshotWriter->Close())
+		{
+			UE_LOG(LogEnhancedInventorySystem, Error, TEXT("Could not write inventory snapshot %s."), *TempPath);
+			return false;
+		}
+	}
+
+	if (!FileManager.Move(*SnapshotPath, *TempPath, true, true))
+	{
+		UE_LOG(LogEnhancedInventorySystem, Error, TEXT("Could not replace inventory snapshot %s."), *SnapshotPath);
+		return false;
+	}
+
+	JournalWriter.Reset();
+	OpenJournal(false);
+	return true;
+}
+
+void FEISInventoryJournal::OpenJournal(bool bAppend)
+{
+	JournalWriter.Reset(IFileManager::Get().CreateFileWriter(*JournalPath, bAppend ? FILEWRITE_Append : FILEWRITE_None));
+	if (!JournalWriter)
+	{
+		UE_LOG(LogEnhancedInventorySystem, Error,
+		       TEXT("Could not open inventory journal %s, changes are kept in memory only."), *JournalPath);
+	}
+}
+
+void UEISInventoryPersistenceSubsystem::Deinitialize()
+{
+	Flush();
+
+	for (FTrackedInventory& Inventory : TrackedInventories)
+	{
+		UnbindRepositories(Inventory);
+		if (UEISInventoryManagerComponent* InventoryManager = Inventory.InventoryManager.Get())
+		{
+			InventoryManager->OnRepositoriesChangeDelegate.RemoveAll(this);
+		}
+	}
+	TrackedInventories.Reset();
+
+	Journal.Reset();
+
+	Super::Deinitialize();
+}
+
+void UEISInventoryPersistenceSubsystem::Tick(float DeltaTime)
+{
+	TimeSinceFlush += DeltaTime;
+	if (TimeSinceFlush >= FlushInterval)
+	{
+		Flush();
+	}
+}
+
+TStatId UEISInventoryPersistenceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UEISInventoryPersistenceSubsystem, STATGROUP_Tickables);
+}
+
+void UEISInventoryPersistenceSubsystem::RegisterInventory(UEISInventoryManagerComponent* InventoryManager,
+                                                          const FString& InventoryKey)
+{
+	if (!InventoryManager || !InventoryManager->HasAuthority() || InventoryKey.IsEmpty())
+	{
+		return;
+	}
+
+	if (FindInventory(InventoryManager) || FindInventory(InventoryKey))
+	{
+		UE_LOG(LogEnhancedInventorySystem, Warning, TEXT("Inventory %s is already registered for persistence."),
+		       *InventoryKey);
+		return;
+	}
+
+	if (!Journal)
+	{
+		TWeakObjectPtr<UEISInventoryPersistenceSubsystem> WeakThis(this);
+		Journal = MakeShared<FEISInventoryJournal, ESPMode::ThreadSafe>(
+			FPaths::ProjectSavedDir() / TEXT("Inventory"),
+			[WeakThis](FString LoadedKey, TArray<FEISInventoryJournalPart> Parts)
+			{
+				AsyncTask(ENamedThreads::GameThread,
+				          [WeakThis, LoadedKey = MoveTemp(LoadedKey), Parts = MoveTemp(Parts)]() mutable
+				{
+					if (UEISInventoryPersistenceSubsystem* This = WeakThis.Get())
+					{
+						This->RestoreInventory(LoadedKey, MoveTemp(Parts));
+					}
+				});
+			});
+		Journal->SetCompactionThreshold(CompactionThreshold);
+	}
+
+	FTrackedInventory& Inventory = TrackedInventories.AddDefaulted_GetRef();
+	Inventory.InventoryManager = InventoryManager;
+	Inventory.InventoryKey = InventoryKey;
+
+	InventoryManager->OnRepositoriesChangeDelegate.AddUObject(this, &ThisClass::OnRepositoriesChange, InventoryManager);
+	BindRepositories(Inventory);
+
+	Journal->RequestLoad(InventoryKey);
+}
+
+void UEISInventoryPersistenceSubsystem::UnregisterInventory(UEISInventoryManagerComponent* InventoryManager)
+{
+	const int32 Index = TrackedInventories.IndexOfByPredicate([InventoryManager](const FTrackedInventory& Inventory)
+	{
+		return Inventory.InventoryManager == InventoryManager;
+	});
+
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	FTrackedInventory& Inventory = TrackedInventories[Index];
+	if (Inventory.bRestored)
+	{
+		FlushInventory(Inventory);
+	}
+
+	UnbindRepositories(Inventory);
+	InventoryManager->OnRepositoriesChangeDelegate.RemoveAll(this);
+	TrackedInventories.RemoveAtSwap(Index);
+}
+
+bool UEISInventoryPersistenceSubsystem::IsInventoryRestored(const UEISInventoryManagerComponent* InventoryManager) const
+{
+	const FTrackedInventory* Inventory = TrackedInventories.FindByPredicate(
+		[InventoryManager](const FTrackedInventory& TrackedInventory)
+		{
+			return TrackedInventory.InventoryManager == InventoryManager;
+		});
+	return Inventory && Inventory->bRestored;
+}
+
+void UEISInventoryPersistenceSubsystem::SetCompactionThreshold(int64 InCompactionThreshold)
+{
+	CompactionThreshold = FMath::Max<int64>(InCompactionThreshold, 0);
+	if (Journal)
+	{
+		Journal->SetCompactionThreshold(CompactionThreshold);
+	}
+}
+
+UEISInventoryPersistenceSubsystem::FTrackedInventory* UEISInventoryPersistenceSubsystem::FindInventory(
+	const UEISInventoryManagerComponent* InventoryManager)
+{
+	return TrackedInventories.FindByPredicate([InventoryManager](const FTrackedInventory& Inventory)
+	{
+		return Inventory.InventoryManager == InventoryManager;
+	});
+}
+
+UEISInventoryPersistenceSubsystem::FTrackedInventory* UEISInventoryPersistenceSubsystem::FindInventory(
+	const FString& InventoryKey)
+{
+	return TrackedInventories.FindByPredicate([&InventoryKey](const FTrackedInventory& Inventory)
+	{
+		return Inventory.InventoryKey == InventoryKey;
+	});
+}
+
+void UEISInventoryPersistenceSubsystem::BindRepositories(FTrackedInventory& Inventory)
+{
+	UEISInventoryManagerComponent* InventoryManager = Inventory.InventoryManager.Get();
+	if (!InventoryManager)
+	{
+		return;
+	}
+
+	for (UEISItemContainer* Container : InventoryManager->GetReplicatedContainers())
+	{
+		if (!Container)
+		{
+			continue;
+		}
+
+		UObject* Repository = Container;
+		Container->OnContainerChangeDelegate.AddUObject(this, &ThisClass::OnContainerChange, Repository);
+		Container->OnSubtreeCountChangeDelegate.AddUObject(this, &ThisClass::OnCountChange, Repository);
+		Container->OnCommodityChangeDelegate.AddUObject(this, &ThisClass::MarkDirty, Repository);
+		if (UEISGridItemContainer* GridContainer = Cast<UEISGridItemContainer>(Container))
+		{
+			GridContainer->OnLayoutChangeDelegate.AddUObject(this, &ThisClass::MarkDirty, Repository);
+		}
+		Inventory.BoundObjects.Add(Container);
+	}
+
+	// An equipped item has no container of its own, so its amount and nested contents are tracked for its slot.
+	for (UEISEquipmentSlot* EquipmentSlot : InventoryManager->GetReplicatedSlots())
+	{
+		if (!EquipmentSlot)
+		{
+			continue;
+		}
+
+		UObject* Repository = EquipmentSlot;
+		EquipmentSlot->OnEquipmentSlotChangeDelegate.AddUObject(this, &ThisClass::OnEquipmentSlotChange, EquipmentSlot);
+		Inventory.BoundObjects.Add(EquipmentSlot);
+
+		if (UEISItemInstance* Item = EquipmentSlot->GetItemInstance())
+		{
+			Item->OnAmountChangeDelegate.AddUObject(this, &ThisClass::OnItemAmountChange, Repository);
+			Inventory.BoundObjects.Add(Item);
+
+			if (UEISItemContainer* ChildContainer = Item->GetChildContainer())
+			{
+				ChildContainer->OnSubtreeCountChangeDelegate.AddUObject(this, &ThisClass::OnCountChange, Repository);
+				Inventory.BoundObjects.Add(ChildContainer);
+			}
+		}
+	}
+}
+
+void UEISInventoryPersistenceSubsystem::UnbindRepositories(FTrackedInventory& Inventory)
+{
+	for (const TWeakObjectPtr<UObject>& BoundObject : Inventory.BoundObjects)
+	{
+		if (UEISItemContainer* Container = Cast<UEISItemContainer>(BoundObject.Get()))
+		{
+			Container->OnContainerChangeDelegate.RemoveAll(this);
+			Container->OnSubtreeCountChangeDelegate.RemoveAll(this);
+			Container->OnCommodityChangeDelegate.RemoveAll(this);
+			if (UEISGridItemContainer* GridContainer = Cast<UEISGridItemContainer>(Container))
+			{
+				GridContainer->OnLayoutChangeDelegate.RemoveAll(this);
+			}
+		}
+		else if (UEISEquipmentSlot* EquipmentSlot = Cast<UEISEquipmentSlot>(BoundObject.Get()))
+		{
+			EquipmentSlot->OnEquipmentSlotChangeDelegate.RemoveAll(this);
+		}
+		else if (UEISItemInstance* Item = Cast<UEISItemInstance>(BoundObject.Get()))
+		{
+			Item->OnAmountChangeDelegate.RemoveAll(this);
+		}
+	}
+	Inventory.BoundObjects.Reset();
+}
+
+void UEISInventoryPersistenceSubsystem::MarkAllDirty(const FTrackedInventory& Inventory)
+{
+	if (UEISInventoryManagerComponent* InventoryManager = Inventory.InventoryManager.Get())
+	{
+		for (UEISItemContainer* Container : InventoryManager->GetReplicatedContainers())
+		{
+			MarkDirty(Container);
+		}
+
+		for (UEISEquipmentSlot* EquipmentSlot : InventoryManager->GetReplicatedSlots())
+		{
+			MarkDirty(EquipmentSlot);
+		}
+	}
+}
+
+void UEISInventoryPersistenceSubsystem::MarkDirty(UObject* Repository)
+{
+	if (Repository)
+	{
+		DirtyRepositories.Add(Repository);
+	}
+}
+
+void UEISInventoryPersistenceSubsystem::Flush()
+{
+	TimeSinceFlush = 0.f;
+
+	for (FTrackedInventory& Inventory : TrackedInventories)
+	{
+		if (Inventory.bRestored)
+		{
+			FlushInventory(Inventory);
+		}
+	}
+
+	// Marks left over belong to inventories still waiting for their restore, which replaces those changes anyway.
+	DirtyRepositories.Reset();
+}
+
+void UEISInventoryPersistenceSubsystem::FlushInventory(FTrackedInventory& Inventory)
+{
+	UEISInventoryManagerComponent* InventoryManager = Inventory.InventoryManager.Get();
+	if (!InventoryManager || !Journal)
+	{
+		return;
+	}
+
+	TArray<FEISInventoryJournalPart> Parts;
+
+	const TArray<UEISItemContainer*> Containers = InventoryManager->GetReplicatedContainers();
+	for (int32 Index = 0; Index < Containers.Num(); Index++)
+	{
+		if (Containers[Index] && DirtyRepositories.Remove(Containers[Index]) > 0)
+		{
+			FEISInventoryJournalPart& Part = Parts.AddDefaulted_GetRef();
+			Part.PartName = ContainerPartPrefix + FString::FromInt(Index);
+
+			FMemoryWriter Ar(Part.Data);
+			FEISInventoryWriter Writer(Ar);
+			Writer.WriteHeader();
+			Writer.WriteContainer(Containers[Index]);
+		}
+	}
+
+	// Parts of containers past the current count would otherwise be restored into whichever container takes their
+	// position later.
+	for (int32 Index = Containers.Num(); Index < Inventory.NumSavedContainers; Index++)
+	{
+		Parts.AddDefaulted_GetRef().PartName = ContainerPartPrefix + FString::FromInt(Index);
+	}
+	Inventory.NumSavedContainers = Containers.Num();
+
+	for (const UEISEquipmentSlot* EquipmentSlot : InventoryManager->GetReplicatedSlots())
+	{
+		if (EquipmentSlot && DirtyRepositories.Remove(EquipmentSlot) > 0)
+		{
+			FEISInventoryJournalPart& Part = Parts.AddDefaulted_GetRef();
+			Part.PartName = SlotPartPrefix + EquipmentSlot->GetSlotName();
+
+			FMemoryWriter Ar(Part.Data);
+			FEISInventoryWriter Writer(Ar);
+			Writer.WriteHeader();
+			Writer.WriteSlot(EquipmentSlot);
+		}
+	}
+
+	if (!Parts.IsEmpty())
+	{
+		Journal->Append(Inventory.InventoryKey, MoveTemp(Parts));
+	}
+}
+
+void UEISInventoryPersistenceSubsystem::RestoreInventory(const FString& InventoryKey,
+                                                         TArray<FEISInventoryJournalPart>&& Parts)
+{
+	FTrackedInventory* Inventory = FindInventory(InventoryKey);
+	UEISInventoryManagerComponent* InventoryManager = Inventory ? Inventory->InventoryManager.Get() : nullptr;
+	if (!InventoryManager || Inventory->bRestored)
+	{
+		return;
+	}
+
+	// Parts are only applied once all of them read cleanly, so a damaged save leaves the inventory as it is.
+	const TArray<UEISItemContainer*> Containers = InventoryManager->GetReplicatedContainers();
+	FEISInventoryRestore Restore;
+	bool bAllRestored = true;
+	for (const FEISInventoryJournalPart& Part : Parts)
+	{
+		FMemoryReader Ar(Part.Data);
+		FEISInventoryReader Reader(Ar, GetWorld(), Restore);
+
+		bool bRestored = Reader.ReadHeader();
+		if (Part.PartName.StartsWith(ContainerPartPrefix))
+		{
+			const int32 Index = FCString::Atoi(*Part.PartName.RightChop(FCString::Strlen(ContainerPartPrefix)));
+			Inventory->NumSavedContainers = FMath::Max(Inventory->NumSavedContainers, Index + 1);
+			bRestored = bRestored && Reader.ReadContainer(Containers.IsValidIndex(Index) ? Containers[Index] : nullptr);
+		}
+		else
+		{
+			bRestored = bRestored && Reader.ReadSlot(InventoryManager->GetReplicatedSlots());
+		}
+
+		if (!bRestored)
+		{
+			UE_LOG(LogEnhancedInventorySystem, Warning, TEXT("Could not restore %s of inventory %s."), *Part.PartName,
+			       *InventoryKey);
+			bAllRestored = false;
+		}
+	}
+
+	// Left unrestored, the inventory is never flushed, so its current contents do not overwrite the damaged save.
+	if (!bAllRestored)
+	{
+		UE_LOG(LogEnhancedInventorySystem, Error, TEXT("Inventory %s has a damaged save, it is not persisted this session."),
+		       *InventoryKey);
+		return;
+	}
+
+	Restore.Commit();
+
+	// Equipping restored items replaced the slot items, so the bindings follow them.
+	UnbindRepositories(*Inventory);
+	BindRepositories(*Inventory);
+	Inventory->bRestored = true;
+
+	// Without a save the starting contents become the first one.
+	if (Parts.IsEmpty())
+	{
+		MarkAllDirty(*Inventory);
+	}
+}
+
+void UEISInventoryPersistenceSubsystem::OnRepositoriesChange(UEISInventoryManagerComponent* InventoryManager)
+{
+	if (FTrackedInventory* Inventory = FindInventory(InventoryManager))
+	{
+		UnbindRepositories(*Inventory);
+		BindRepositories(*Inventory);
+
+		// Containers are saved by position, which may have shifted for all of them.
+		MarkAllDirty(*Inventory);
+	}
+}
+
+void UEISInventoryPersistenceSubsystem::OnContainerChange(const FEISItemContainerChangeData& ChangeData,
+                                                          UObject* Repository)
+{
+	MarkDirty(Repository);
+}
+
+void UEISInventoryPersistenceSubsystem::OnCountChange(const UEISItemDefinition* Definition, int32 Delta,
+                                                      UObject* Repository)
+{
+	MarkDirty(Repository);
+}
+
+void UEISInventoryPersistenceSubsystem::OnItemAmountChange(int NewAmount, int PrevAmount, UObject* Repository)
+{
+	MarkDirty(Repository);
+}
+
+void UEISInventoryPersistenceSubsystem::OnEquipmentSlotChange(const FEISEquipmentSlotChangeData& ChangeData,
+                                                              UEISEquipmentSlot* EquipmentSlot)
+{
+	MarkDirty(EquipmentSlot);
+
+	// The slot holds another item now, so its item bindings move over to it.
+	for (FTrackedInventory& Inventory : TrackedInventories)
+	{
+		const UEISInventoryManagerComponent* InventoryManager = Inventory.InventoryManager.Get();
+		if (InventoryManager && InventoryManager->GetReplicatedSlots().Contains(EquipmentSlot))
+		{
+			UnbindRepositories(Inventory);
+			BindRepositories(Inventory);
+			break;
+		}
+	}
+}
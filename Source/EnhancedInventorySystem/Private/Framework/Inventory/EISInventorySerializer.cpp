@@ -0,0 +1,366 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EISInventorySerializer.h"
+#include "Algo/Count.h"
+#include "EISEquipmentSlot.h"
+#include "EISInventoryFunctionLibrary.h"
+#include "EISItemContainer.h"
+#include "EISItemInstance.h"
+#include "EnhancedInventorySystem.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+void FEISInventoryWriter::WriteHeader()
+{
+	uint32 Magic = EISInventorySerializer::Magic;
+	uint16 Version = static_cast<uint16>(EISInventorySerializer::EVersion::Latest);
+	Ar << Magic;
+	Ar << Version;
+}
+
+void FEISInventoryWriter::WriteCount(int32 Count)
+{
+	uint32 PackedCount = static_cast<uint32>(Count);
+	Ar.SerializeIntPacked(PackedCount);
+}
+
+void FEISInventoryWriter::WriteContainer(const UEISItemContainer* Container)
+{
+	if (Container)
+	{
+		Container->EnsureStartingData();
+	}
+
+	const TArray<UEISItemInstance*> NoItems;
+	const TArray<UEISItemInstance*>& Items = Container ? Container->Items : NoItems;
+	WriteCount(Algo::CountIf(Items, [](const UEISItemInstance* Item) { return Item != nullptr; }));
+
+	for (const UEISItemInstance* Item : Items)
+	{
+		if (Item)
+		{
+			WriteItem(Item);
+		}
+	}
+
+	const FEISCommodityStacks NoCommodityStacks;
+	const FEISCommodityStacks& CommodityStacks = Container ? Container->CommodityStacks : NoCommodityStacks;
+
+	int32 NumRows = 0;
+	for (int32 Row = 0; Row < CommodityStacks.Num(); Row++)
+	{
+		NumRows += CommodityStacks.GetRowClass(Row) != nullptr;
+	}
+	WriteCount(NumRows);
+
+	for (int32 Row = 0; Row < CommodityStacks.Num(); Row++)
+	{
+		if (const UClass* RowClass = CommodityStacks.GetRowClass(Row))
+		{
+			WriteClass(RowClass);
+			WriteCount(CommodityStacks.ItemIds[Row]);
+			WriteCount(CommodityStacks.Amounts[Row]);
+		}
+	}
+
+	// The layout is prefixed with its size, so readers can skip it when the container class has changed. It goes
+	// through a buffer to learn the size up front.
+	TArray<uint8> Layout;
+	if (Container)
+	{
+		FMemoryWriter LayoutAr(Layout);
+		Container->SaveLayout(LayoutAr);
+	}
+
+	uint32 LayoutSize = Layout.Num();
+	Ar << LayoutSize;
+	Ar.Serialize(Layout.GetData(), LayoutSize);
+}
+
+void FEISInventoryWriter::WriteSlot(const UEISEquipmentSlot* EquipmentSlot)
+{
+	check(EquipmentSlot);
+
+	FString SlotName = EquipmentSlot->GetSlotName();
+	Ar << SlotName;
+
+	const UEISItemInstance* Item = EquipmentSlot->GetItemInstance();
+	uint8 bHasItem = Item != nullptr;
+	Ar << bHasItem;
+
+	if (Item)
+	{
+		WriteItem(Item);
+	}
+}
+
+void FEISInventoryWriter::WriteClass(const UClass* ItemClass)
+{
+	if (const uint32* Index = Palette.Find(ItemClass))
+	{
+		uint32 PackedIndex = *Index;
+		Ar.SerializeIntPacked(PackedIndex);
+		return;
+	}
+
+	// A class seen for the first time takes the next palette index and is followed by its path.
+	uint32 Index = Palette.Num();
+	Palette.Add(ItemClass, Index);
+	Ar.SerializeIntPacked(Index);
+
+	FString ClassPath = FSoftClassPath(ItemClass).ToString();
+	Ar << ClassPath;
+}
+
+void FEISInventoryWriter::WriteItem(const UEISItemInstance* Item)
+{
+	WriteClass(Item->GetClass());
+	WriteCount(Item->GetItemId());
+	WriteCount(Item->GetAmount());
+
+	const UEISItemContainer* ChildContainer = Item->GetChildContainer();
+	uint8 bHasChildContainer = ChildContainer != nullptr;
+	Ar << bHasChildContainer;
+
+	if (ChildContainer)
+	{
+		WriteContainer(ChildContainer);
+	}
+}
+
+void FEISInventoryRestore::Commit()
+{
+	for (FContainerRecord& Record : Containers)
+	{
+		Record.Container->RestoreContents(MoveTemp(Record.Items), MoveTemp(Record.CommodityStacks));
+
+		if (!Record.Layout.IsEmpty())
+		{
+			FMemoryReader LayoutAr(Record.Layout);
+			Record.Container->LoadLayout(LayoutAr);
+		}
+	}
+
+	for (const FSlotRecord& Record : Slots)
+	{
+		UEISInventoryFunctionLibrary::Slot_UnequipItem(Record.EquipmentSlot);
+		UEISInventoryFunctionLibrary::Slot_EquipItem(Record.EquipmentSlot, Record.Item);
+	}
+
+	Containers.Reset();
+	Slots.Reset();
+}
+
+bool FEISInventoryReader::ReadHeader()
+{
+	uint32 Magic = 0;
+	uint16 RawVersion = 0;
+	Ar << Magic;
+	Ar << RawVersion;
+
+	if (Ar.IsError() || Magic != EISInventorySerializer::Magic)
+	{
+		UE_LOG(LogEnhancedInventorySystem, Error, TEXT("Inventory data has no valid header."));
+		Ar.SetError();
+		return false;
+	}
+
+	if (RawVersion == 0 || RawVersion > static_cast<uint16>(EISInventorySerializer::EVersion::Latest))
+	{
+		UE_LOG(LogEnhancedInventorySystem, Error, TEXT("Inventory data version %d is not supported."), RawVersion);
+		Ar.SetError();
+		return false;
+	}
+
+	Version = static_cast<EISInventorySerializer::EVersion>(RawVersion);
+	return true;
+}
+
+bool FEISInventoryReader::ReadCount(int32& OutCount)
+{
+	uint32 PackedCount = 0;
+	Ar.SerializeIntPacked(PackedCount);
+
+	OutCount = static_cast<int32>(PackedCount);
+	return !Ar.IsError();
+}
+
+bool FEISInventoryReader::ReadContainer(UEISItemContainer* Container)
+{
+	int32 NumItems = 0;
+	if (!ReadCount(NumItems))
+	{
+		return false;
+	}
+
+	// Every item record takes at least four bytes, which bounds the reservation for damaged data.
+	TArray<UEISItemInstance*> Items;
+	if (Container)
+	{
+		Items.Reserve(FMath::Min<int64>(NumItems, GetRemainingSize() / 4));
+	}
+
+	for (int32 Index = 0; Index < NumItems; Index++)
+	{
+		UEISItemInstance* Item = nullptr;
+		if (!ReadItem(Item, Container != nullptr))
+		{
+			return false;
+		}
+
+		if (Item)
+		{
+			Items.Add(Item);
+		}
+	}
+
+	int32 NumRows = 0;
+	if (!ReadCount(NumRows))
+	{
+		return false;
+	}
+
+	FEISCommodityStacks CommodityStacks;
+	for (int32 Row = 0; Row < NumRows; Row++)
+	{
+		UClass* RowClass = nullptr;
+		int32 ItemId = 0;
+		int32 Amount = 0;
+		if (!ReadClass(RowClass) || !ReadCount(ItemId) || !ReadCount(Amount))
+		{
+			return false;
+		}
+
+		UEISInventoryFunctionLibrary::ReserveItemIds(ItemId);
+		if (Container && RowClass)
+		{
+			CommodityStacks.AddRow(CommodityStacks.FindOrAddClass(RowClass), ItemId, Amount);
+		}
+	}
+
+	uint32 LayoutSize = 0;
+	Ar << LayoutSize;
+	if (Ar.IsError() || LayoutSize > GetRemainingSize())
+	{
+		Ar.SetError();
+		return false;
+	}
+
+	TArray<uint8> Layout;
+	Layout.SetNumUninitialized(LayoutSize);
+	Ar.Serialize(Layout.GetData(), LayoutSize);
+	if (Ar.IsError())
+	{
+		return false;
+	}
+
+	if (Container)
+	{
+		FEISInventoryRestore::FContainerRecord& Record = Restore.Containers.AddDefaulted_GetRef();
+		Record.Container = Container;
+		Record.Items = MoveTemp(Items);
+		Record.CommodityStacks = MoveTemp(CommodityStacks);
+		Record.Layout = MoveTemp(Layout);
+	}
+	return true;
+}
+
+bool FEISInventoryReader::ReadSlot(TConstArrayView<UEISEquipmentSlot*> EquipmentSlots)
+{
+	FString SlotName;
+	uint8 bHasItem = 0;
+	Ar << SlotName;
+	Ar << bHasItem;
+
+	UEISEquipmentSlot* const* FoundSlot = EquipmentSlots.FindByPredicate([&SlotName](const UEISEquipmentSlot* Slot)
+	{
+		return Slot && Slot->GetSlotName() == SlotName;
+	});
+	UEISEquipmentSlot* EquipmentSlot = FoundSlot ? *FoundSlot : nullptr;
+
+	UEISItemInstance* Item = nullptr;
+	if (Ar.IsError() || (bHasItem && !ReadItem(Item, EquipmentSlot != nullptr)))
+	{
+		return false;
+	}
+
+	if (EquipmentSlot)
+	{
+		Restore.Slots.Add({EquipmentSlot, Item});
+	}
+	return true;
+}
+
+bool FEISInventoryReader::ReadClass(UClass*& OutItemClass)
+{
+	int32 Index = 0;
+	if (!ReadCount(Index))
+	{
+		return false;
+	}
+
+	if (Palette.IsValidIndex(Index))
+	{
+		OutItemClass = Palette[Index];
+		return true;
+	}
+
+	if (Index != Palette.Num())
+	{
+		Ar.SetError();
+		return false;
+	}
+
+	FString ClassPath;
+	Ar << ClassPath;
+	if (Ar.IsError())
+	{
+		return false;
+	}
+
+	// Classes that no longer load keep their palette entry, and their items are dropped.
+	OutItemClass = FSoftClassPath(ClassPath).TryLoadClass<UEISItemInstance>();
+	if (!OutItemClass)
+	{
+		UE_LOG(LogEnhancedInventorySystem, Warning, TEXT("Item class %s in inventory data could not be loaded."),
+		       *ClassPath);
+	}
+
+	Palette.Add(OutItemClass);
+	return true;
+}
+
+bool FEISInventoryReader::ReadItem(UEISItemInstance*& OutItem, bool bCreate)
+{
+	UClass* ItemClass = nullptr;
+	FEISItemInstanceData ItemData;
+	uint8 bHasChildContainer = 0;
+
+	if (!ReadClass(ItemClass) || !ReadCount(ItemData.ItemId) || !ReadCount(ItemData.Amount))
+	{
+		return false;
+	}
+
+	Ar << bHasChildContainer;
+	if (Ar.IsError())
+	{
+		return false;
+	}
+
+	UEISInventoryFunctionLibrary::ReserveItemIds(ItemData.ItemId);
+
+	OutItem = nullptr;
+	if (bCreate && ItemClass && World)
+	{
+		OutItem = UEISInventoryFunctionLibrary::GenerateItemWithData(
+			World, ItemClass->GetDefaultObject<UEISItemInstance>(), ItemData);
+	}
+
+	return !bHasChildContainer || ReadContainer(OutItem ? OutItem->GetChildContainer() : nullptr);
+}
+
+int64 FEISInventoryReader::GetRemainingSize() const
+{
+	const int64 TotalSize = Ar.TotalSize();
+	return TotalSize < 0 ? MAX_int64 : FMath::Max<int64>(TotalSize - Ar.Tell(), 0);
+}
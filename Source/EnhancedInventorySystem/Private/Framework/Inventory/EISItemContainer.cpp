@@ -1,208 +1,1792 @@
 ﻿// Fill out your copyright notice in the Description page of Project Settings.
 
 #include "EISItemContainer.h"
+#include "Algo/BinarySearch.h"
 #include "EISInventoryFunctionLibrary.h"
+#include "EISItemFilterView.h"
+#include "EISItemSortedView.h"
+#include "EISItemGenerationSubsystem.h"
 #include "EISItemInstance.h"
 #include "Engine/ActorChannel.h"
 #include "Net/UnrealNetwork.h"
 
+FEISItemContainerChangeBatch::FEISItemContainerChangeBatch(UEISItemContainer* InContainer) : Container(InContainer)
+{
+	if (Container)
+	{
+		Container->ChangeBatchDepth++;
+	}
+}
+
+FEISItemContainerChangeBatch::~FEISItemContainerChangeBatch()
+{
+	if (Container && --Container->ChangeBatchDepth == 0)
+	{
+		FEISItemContainerChangeData ChangeData = MoveTemp(Container->PendingChangeData);
+		Container->PendingChangeData = FEISItemContainerChangeData();
+
+		if (!ChangeData.AddedItems.IsEmpty() || !ChangeData.RemovedItems.IsEmpty() || ChangeData.bOrderChanged)
+		{
+			Container->BroadcastChange(ChangeData);
+		}
+
+		if (Container->bCommodityChangePending)
+		{
+			Container->bCommodityChangePending = false;
+			Container->BroadcastCommodityChange();
+		}
+
+		if (Container->bSnapshotPending)
+		{
+			Container->bSnapshotPending = false;
+			Container->PublishSnapshot();
+		}
+	}
+}
+
+void FEISItemCounts::ApplyDelta(const UEISItemDefinition* Definition, int32 Delta)
+{
+	if (!Definition || Delta == 0)
+	{
+		return;
+	}
+
+	int32& Count = DefinitionCounts.FindOrAdd(Definition);
+	Count += Delta;
+	if (Count == 0)
+	{
+		DefinitionCounts.Remove(Definition);
+	}
+
+	if (UEISItemDefinitionRegistry* Registry = UEISItemDefinitionRegistry::Get())
+	{
+		for (const FGameplayTag& Tag : Registry->GetExpandedTags(Definition))
+		{
+			int32& TagCount = TagCounts.FindOrAdd(Tag);
+			TagCount += Delta;
+			if (TagCount == 0)
+			{
+				TagCounts.Remove(Tag);
+			}
+		}
+	}
+}
+
+static bool IsSearchNameLess(const TPair<FString, UEISItemInstance*>& Entry, const FString& Name)
+{
+	return Entry.Key.Compare(Name, ESearchCase::CaseSensitive) < 0;
+}
+
+void FEISItemSearchIndex::Build(const TArray<UEISItemInstance*>& Items)
+{
+	Reset();
+
+	TArray<FString, TInlineAllocator<2>> Names;
+	for (UEISItemInstance* Item : Items)
+	{
+		if (!Item)
+		{
+			continue;
+		}
+
+		for (const FGameplayTag& Tag : GetSearchTags(Item))
+		{
+			TagBuckets.FindOrAdd(Tag).Add(Item);
+		}
+
+		Names.Reset();
+		GetSearchNames(Item, Names);
+		for (FString& Name : Names)
+		{
+			SortedNames.Emplace(MoveTemp(Name), Item);
+		}
+	}
+
+	SortedNames.Sort([](const TPair<FString, UEISItemInstance*>& A, const TPair<FString, UEISItemInstance*>& B)
+	{
+		return IsSearchNameLess(A, B.Key);
+	});
+}
+
+void FEISItemSearchIndex::AddItem(UEISItemInstance* Item)
+{
+	for (const FGameplayTag& Tag : GetSearchTags(Item))
+	{
+		TagBuckets.FindOrAdd(Tag).Add(Item);
+	}
+
+	TArray<FString, TInlineAllocator<2>> Names;
+	GetSearchNames(Item, Names);
+	for (FString& Name : Names)
+	{
+		const int32 Index = Algo::LowerBound(SortedNames, Name, IsSearchNameLess);
+		SortedNames.Insert(TPair<FString, UEISItemInstance*>(MoveTemp(Name), Item), Index);
+	}
+}
+
+void FEISItemSearchIndex::RemoveItem(UEISItemInstance* Item)
+{
+	for (const FGameplayTag& Tag : GetSearchTags(Item))
+	{
+		if (TSet<UEISItemInstance*>* Bucket = TagBuckets.Find(Tag))
+		{
+			Bucket->Remove(Item);
+			if (Bucket->IsEmpty())
+			{
+				TagBuckets.Remove(Tag);
+			}
+		}
+	}
+
+	TArray<FString, TInlineAllocator<2>> Names;
+	GetSearchNames(Item, Names);
+	for (const FString& Name : Names)
+	{
+		for (int32 Index = Algo::LowerBound(SortedNames, Name, IsSearchNameLess);
+		     Index < SortedNames.Num() && SortedNames[Index].Key.Equals(Name, ESearchCase::CaseSensitive); Index++)
+		{
+			if (SortedNames[Index].Value == Item)
+			{
+				SortedNames.RemoveAt(Index);
+				break;
+			}
+		}
+	}
+}
+
+void FEISItemSearchIndex::FindByPrefix(const FString& Prefix, TArray<UEISItemInstance*>& OutItems) const
+{
+	TSet<UEISItemInstance*> FoundItems;
+	for (int32 Index = Algo::LowerBound(SortedNames, Prefix, IsSearchNameLess);
+	     Index < SortedNames.Num() && SortedNames[Index].Key.StartsWith(Prefix, ESearchCase::CaseSensitive); Index++)
+	{
+		bool bAlreadyFound = false;
+		FoundItems.Add(SortedNames[Index].Value, &bAlreadyFound);
+		if (!bAlreadyFound)
+		{
+			OutItems.Add(SortedNames[Index].Value);
+		}
+	}
+}
+
+void FEISItemSearchIndex::GetSearchNames(const UEISItemInstance* Item, TArray<FString, TInlineAllocator<2>>& OutNames)
+{
+	const UEISItemDefinition* Definition = Item->GetDefinition();
+	if (!Definition)
+	{
+		return;
+	}
+
+	const FString ScriptName = Definition->ScriptName.ToString().ToLower();
+	OutNames.Add(ScriptName);
+
+	if (!Definition->DisplayName.IsEmpty())
+	{
+		FString DisplayName = Definition->DisplayName.ToString().ToLower();
+		if (!DisplayName.Equals(ScriptName, ESearchCase::CaseSensitive))
+		{
+			OutNames.Add(MoveTemp(DisplayName));
+		}
+	}
+}
+
+const FGameplayTagContainer& FEISItemSearchIndex::GetSearchTags(const UEISItemInstance* Item)
+{
+	const UEISItemDefinition* Definition = Item->GetDefinition();
+	if (!Definition)
+	{
+		return FGameplayTagContainer::EmptyContainer;
+	}
+
+	UEISItemDefinitionRegistry* Registry = UEISItemDefinitionRegistry::Get();
+	return Registry ? Registry->GetExpandedTags(Definition) : Definition->Tags;
+}
+
+FEISItemSortEntry FEISItemSortEntry::Make(UEISItemInstance* InItem)
+{
+	FEISItemSortEntry Entry;
+	Entry.Item = InItem;
+	Entry.Name = InItem ? InItem->GetScriptName() : NAME_None;
+	Entry.Category = InItem && !InItem->GetTags().IsEmpty() ? InItem->GetTags().First().GetTagName() : NAME_None;
+	Entry.Amount = InItem ? InItem->GetAmount() : 0;
+	Entry.ItemId = InItem ? InItem->GetItemId() : 0;
+	return Entry;
+}
+
+int32 FEISItemSortEntry::Compare(const FEISItemSortEntry& A, const FEISItemSortEntry& B, EEISItemSortKey SortKey)
+{
+	int32 Order = 0;
+	switch (SortKey)
+	{
+	case EEISItemSortKey::Name:
+		Order = A.Name.Compare(B.Name);
+		break;
+	case EEISItemSortKey::Amount:
+		Order = A.Amount - B.Amount;
+		break;
+	case EEISItemSortKey::Category:
+		Order = A.Category.Compare(B.Category);
+		Order = Order != 0 ? Order : A.Name.Compare(B.Name);
+		break;
+	default:
+		break;
+	}
+
+	// Item ids break ties so the server and a predicting client arrive at the same order.
+	return Order != 0 ? Order : A.ItemId - B.ItemId;
+}
+
+int32 FEISCommodityStacks::FindClass(const UClass* ItemClass) const
+{
+	return ItemClasses.IndexOfByKey(ItemClass);
+}
+
+int32 FEISCommodityStacks::FindOrAddClass(UClass* ItemClass)
+{
+	int32 ClassIndex = FindClass(ItemClass);
+	if (ClassIndex == INDEX_NONE)
+	{
+		check(ItemClasses.Num() < MAX_uint16);
+		ClassIndex = ItemClasses.Add(ItemClass);
+	}
+	return ClassIndex;
+}
+
+int32 FEISCommodityStacks::AddRow(int32 ClassIndex, int32 ItemId, int32 Amount)
+{
+	ClassIndices.Add(static_cast<uint16>(ClassIndex));
+	ItemIds.Add(ItemId);
+	return Amounts.Add(Amount);
+}
+
+void FEISCommodityStacks::RemoveRow(int32 Row)
+{
+	ClassIndices.RemoveAtSwap(Row, 1, false);
+	ItemIds.RemoveAtSwap(Row, 1, false);
+	Amounts.RemoveAtSwap(Row, 1, false);
+}
+
 void UEISItemContainer::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	UObject::GetLifetimeReplicatedProps(OutLifetimeProps);
 	
-	DOREPLIFETIME(ThisClass, Items);
-}
+	DOREPLIFETIME(ThisClass, Items);
+	DOREPLIFETIME(ThisClass, CommodityStacks);
+}
+
+bool UEISItemContainer::ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags)
+{
+	bool bReplicateSomething = false;
+	for (UEISItemInstance* Item : GetItems())
+	{
+		bReplicateSomething |= Channel->ReplicateSubobject(Item, *Bunch, *RepFlags);
+		bReplicateSomething |= Item->ReplicateSubobjects(Channel, Bunch, RepFlags);
+	}
+
+	return bReplicateSomething;
+}
+
+void UEISItemContainer::SetupItemContainer(FGameplayTagContainer ContainerTags)
+{
+	CategoryTags = ContainerTags;
+	CategoryTagMask = 0;
+}
+
+void UEISItemContainer::AddStartingData()
+{
+	if (bLazyStartingData)
+	{
+		bStartingDataPending = !StartingData.IsEmpty();
+		return;
+	}
+
+	MaterializeStartingData();
+}
+
+void UEISItemContainer::MaterializeStartingData()
+{
+	bStartingDataPending = false;
+
+	FEISItemContainerChangeBatch ChangeBatch(this);
+	bSnapshotPending = bPublishSnapshots;
+	
+	for (UClass* RawClass : StartingData)
+	{
+		if (!IsValid(RawClass))
+		{
+			continue;
+		}
+
+		const UEISItemInstance* ItemCDO = RawClass->GetDefaultObject<UEISItemInstance>();
+		check(ItemCDO);
+
+		if (IsCommodityItem(ItemCDO))
+		{
+			AddCommodityAmount(RawClass, ItemCDO->GetAmount());
+		}
+		else if (CanAddItem(ItemCDO))
+		{
+			UEISItemInstance* Item = UEISInventoryFunctionLibrary::GenerateItem(GetWorld(), ItemCDO);
+			check(Item);
+
+			AddItem(Item);
+		}
+	}
+	
+	StartingData.Empty();
+}
+
+void UEISItemContainer::RestoreContents(TArray<UEISItemInstance*>&& NewItems, FEISCommodityStacks&& NewCommodityStacks)
+{
+	FEISItemContainerChangeBatch ChangeBatch(this);
+
+	bStartingDataPending = false;
+	StartingData.Empty();
+
+	// Starting items still being generated would land on top of the restored contents.
+	if (UEISItemGenerationSubsystem* GenerationSubsystem = UWorld::GetSubsystem<UEISItemGenerationSubsystem>(GetWorld()))
+	{
+		GenerationSubsystem->CancelRequests(this);
+	}
+
+	TArray<UEISItemInstance*> RemovedItems = MoveTemp(Items);
+	for (UEISItemInstance* Item : RemovedItems)
+	{
+		if (Item)
+		{
+			UntrackItem(Item);
+		}
+	}
+
+	Items = MoveTemp(NewItems);
+	for (UEISItemInstance* Item : Items)
+	{
+		TrackItem(Item);
+	}
+
+	// Rows are accounted for the same way as replicated ones, by their difference to the previous rows.
+	const FEISCommodityStacks PrevCommodityStacks = MoveTemp(CommodityStacks);
+	CommodityStacks = MoveTemp(NewCommodityStacks);
+	OnRep_CommodityStacks(PrevCommodityStacks);
+
+	BroadcastChange(FEISItemContainerChangeData(Items, RemovedItems));
+}
+
+TFuture<int32> UEISItemContainer::AddStartingDataAsync()
+{
+	UEISItemGenerationSubsystem* GenerationSubsystem = UWorld::GetSubsystem<UEISItemGenerationSubsystem>(GetWorld());
+	if (bLazyStartingData || !GenerationSubsystem)
+	{
+		AddStartingData();
+		return MakeFulfilledPromise<int32>(0).GetFuture();
+	}
+
+	TArray<FEISItemGenerationEntry> Entries;
+	Entries.Reserve(StartingData.Num());
+	
+	for (const TSubclassOf<UEISItemInstance>& ItemClass : StartingData)
+	{
+		if (IsValid(ItemClass))
+		{
+			Entries.Add({ItemClass, ItemClass.GetDefaultObject()->GetAmount()});
+		}
+	}
+	
+	StartingData.Empty();
+	return GenerationSubsystem->RequestItems(this, MoveTemp(Entries));
+}
+
+void UEISItemContainer::SetPublishSnapshots(bool bInPublishSnapshots)
+{
+	if (bPublishSnapshots == bInPublishSnapshots)
+	{
+		return;
+	}
+
+	bPublishSnapshots = bInPublishSnapshots;
+	if (bPublishSnapshots)
+	{
+		EnsureStartingData();
+		PublishSnapshot();
+	}
+	else
+	{
+		bSnapshotPending = false;
+		SnapshotSource.Publish(nullptr);
+	}
+}
+
+bool UEISItemContainer::CanAddItem(const UEISItemInstance* Item) const
+{
+	check(Item);
+
+	return MatchesCategory(Item) && FitsCapacity(Item);
+}
+
+int UEISItemContainer::GetMaxAddableAmount(const UEISItemInstance* Item) const
+{
+	check(Item);
+	EnsureStartingData();
+
+	if (!MatchesCategory(Item))
+	{
+		return 0;
+	}
+
+	const FEISItemDefinitionHotData HotData = Item->GetHotData();
+	int64 MaxAmount = MAX_int32;
+
+	const int64 FreeEntries = GetFreeEntryCount(Item);
+	if (FreeEntries < MAX_int32)
+	{
+		const int64* OpenCapacity = OpenStackCapacity.Find(Item->GetDefinition());
+		MaxAmount = (OpenCapacity ? *OpenCapacity : 0) + FreeEntries * FMath::Max(HotData.StackLimit, 1);
+	}
+
+	if (HotData.Weight > 0.f)
+	{
+		const float RemainingWeight = GetRemainingWeight();
+		if (RemainingWeight < MAX_flt)
+		{
+			MaxAmount = FMath::Min<int64>(MaxAmount, FMath::FloorToInt64(
+				                              (RemainingWeight + KINDA_SMALL_NUMBER) / HotData.Weight));
+		}
+	}
+
+	if (MaxVolume > 0.f && HotData.Volume > 0.f)
+	{
+		MaxAmount = FMath::Min<int64>(MaxAmount, FMath::FloorToInt64(
+			                              (MaxVolume - ContentsVolume + KINDA_SMALL_NUMBER) / HotData.Volume));
+	}
+
+	return static_cast<int>(FMath::Clamp<int64>(MaxAmount, 0, MAX_int32));
+}
+
+bool UEISItemContainer::CanAddItemAmounts(TConstArrayView<TPair<const UEISItemInstance*, int>> ItemAmounts) const
+{
+	EnsureStartingData();
+
+	float AddedWeight = 0.f;
+	float AddedVolume = 0.f;
+	int64 NewEntries = 0;
+	TMap<const UEISItemDefinition*, int64, TInlineSetAllocator<4>> UsedOpenCapacity;
+	TArray<TPair<const UEISItemInstance*, int32>, TInlineAllocator<4>> ItemEntries;
+
+	for (const TPair<const UEISItemInstance*, int>& ItemAmount : ItemAmounts)
+	{
+		const UEISItemInstance* Item = ItemAmount.Key;
+		const int Amount = ItemAmount.Value;
+		if (!Item || !MatchesCategory(Item))
+		{
+			return false;
+		}
+
+		const FEISItemDefinitionHotData& HotData = Item->GetHotData();
+		AddedWeight += HotData.Weight * Amount;
+		AddedVolume += HotData.Volume * Amount;
+
+		// Open stacks of a definition are shared by every amount of it.
+		int64 StackedAmount = 0;
+		if (HotData.IsStackable())
+		{
+			const int64* OpenCapacity = OpenStackCapacity.Find(Item->GetDefinition());
+			int64& UsedCapacity = UsedOpenCapacity.FindOrAdd(Item->GetDefinition());
+			StackedAmount = FMath::Clamp<int64>((OpenCapacity ? *OpenCapacity : 0) - UsedCapacity, 0, Amount);
+			UsedCapacity += StackedAmount;
+		}
+
+		const int32 Entries = FMath::DivideAndRoundUp<int64>(Amount - StackedAmount, FMath::Max(HotData.StackLimit, 1));
+		NewEntries += Entries;
+		if (Entries > 0 && !IsCommodityItem(Item))
+		{
+			ItemEntries.Emplace(Item, Entries);
+		}
+	}
+
+	if (MaxEntries > 0 && GetEntryCount() + NewEntries > MaxEntries)
+	{
+		return false;
+	}
+
+	if (AddedWeight > 0.f && AddedWeight > GetRemainingWeight() + KINDA_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	if (MaxVolume > 0.f && AddedVolume > MaxVolume - ContentsVolume + KINDA_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	return CanPlaceItems(ItemEntries);
+}
+
+int32 UEISItemContainer::GetFreeEntryCount(const UEISItemInstance* Item) const
+{
+	return MaxEntries > 0 ? FMath::Max(MaxEntries - GetEntryCount(), 0) : MAX_int32;
+}
+
+float UEISItemContainer::GetRemainingWeight() const
+{
+	float RemainingWeight = MAX_flt;
+	for (const UEISItemContainer* Container = this; Container; Container = Container->ParentContainer.Get())
+	{
+		if (Container->MaxWeight > 0.f)
+		{
+			RemainingWeight = FMath::Min(RemainingWeight, Container->MaxWeight - Container->SubtreeWeight);
+		}
+	}
+	return RemainingWeight;
+}
+
+bool UEISItemContainer::MatchesCategory(const UEISItemInstance* Item) const
+{
+	// A container may not end up inside the item that carries it.
+	if (Item->GetChildContainer())
+	{
+		for (const UEISItemContainer* Container = this; Container; Container = Container->ParentContainer.Get())
+		{
+			if (Container->GetOwningItem() == Item)
+			{
+				return false;
+			}
+		}
+	}
+
+	if (CategoryTagMask == 0)
+	{
+		CategoryTagMask = FEISItemDefinitionHotData::MakeTagMask(CategoryTags);
+	}
+
+	if ((Item->GetHotData().TagMask & CategoryTagMask) == 0)
+	{
+		return false;
+	}
+	
+	const UEISItemDefinition* Def = Item->GetDefinition();
+	if (Def != nullptr)
+	{
+		return Def->Tags.HasAny(CategoryTags);
+	}
+	
+	return false;
+}
+
+bool UEISItemContainer::CanSplitItem(const UEISItemInstance* Item, int Amount) const
+{
+	EnsureStartingData();
+
+	return Item && Amount > 0 && Item->GetAmount() > Amount && Items.Contains(Item) && GetFreeEntryCount(Item) > 0;
+}
+
+bool UEISItemContainer::FitsCapacity(const UEISItemInstance* Item) const
+{
+	const int Amount = Item->GetAmount();
+	if (IsCommodityItem(Item))
+	{
+		return GetMaxAddableAmount(Item) >= Amount;
+	}
+
+	const FEISItemDefinitionHotData HotData = Item->GetHotData();
+	if (MaxEntries > 0 && GetEntryCount() + FMath::DivideAndRoundUp(Amount, FMath::Max(HotData.StackLimit, 1)) > MaxEntries)
+	{
+		return false;
+	}
+
+	const float ItemWeight = HotData.Weight * Amount + (Item->GetChildContainer()
+		                                                    ? Item->GetChildContainer()->GetSubtreeWeight()
+		                                                    : 0.f);
+	if (ItemWeight > 0.f && ItemWeight > GetRemainingWeight() + KINDA_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	if (MaxVolume > 0.f && HotData.Volume * Amount > MaxVolume - ContentsVolume + KINDA_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	return CanPlaceItem(Item);
+}
+
+TArray<UEISItemInstance*> UEISItemContainer::FindItemsInSubtree(const UEISItemDefinition* Definition) const
+{
+	EnsureStartingData();
+
+	const TArray<UEISItemInstance*>* DefinitionItems = SubtreeItems.Find(Definition);
+	return DefinitionItems ? *DefinitionItems : TArray<UEISItemInstance*>();
+}
+
+bool UEISItemContainer::Contains(const UEISItemInstance* Item) const
+{
+	EnsureStartingData();
+
+	return Items.Contains(Item);
+}
+
+bool UEISItemContainer::IsCommodityItem(const UEISItemInstance* Item) const
+{
+	if (!bStoreCommodityStacks || !Item)
+	{
+		return false;
+	}
+	
+	return Item->GetHotData().IsCommodity() && CanAddItem(Item);
+}
+
+int UEISItemContainer::GetCommodityAmount(TSubclassOf<UEISItemInstance> ItemClass) const
+{
+	EnsureStartingData();
+
+	const int32 ClassIndex = CommodityStacks.FindClass(ItemClass);
+	if (ClassIndex == INDEX_NONE)
+	{
+		return 0;
+	}
+
+	int TotalAmount = 0;
+	for (int32 Row = 0; Row < CommodityStacks.Num(); Row++)
+	{
+		if (CommodityStacks.ClassIndices[Row] == ClassIndex)
+		{
+			TotalAmount += CommodityStacks.Amounts[Row];
+		}
+	}
+	return TotalAmount;
+}
+
+UEISItemInstance* UEISItemContainer::FindFirstStackForItem(const UEISItemInstance* ForItem) const
+{
+	EnsureStartingData();
+
+	for (int i = 0; i < Items.Num(); i++)
+	{
+		auto FoundItem = Items[i];
+		if (!FoundItem)
+		{
+			continue;
+		}
+		
+		if (FoundItem->CanStackItem(ForItem))
+		{
+			return FoundItem;
+		}
+	}
+	return nullptr;
+}
+
+UEISItemInstance* UEISItemContainer::FindItemByDefinition(const UEISItemDefinition* Definition) const
+{
+	EnsureStartingData();
+
+	for (UEISItemInstance* Item : Items)
+	{
+		const UEISItemDefinition* Def = Item->GetDefinition();
+		if (Def == Definition)
+		{
+			return Item;
+		}
+	}
+	return nullptr;
+}
+
+UEISItemInstance* UEISItemContainer::FindItemByName(const FName& ScriptName) const
+{
+	EnsureStartingData();
+
+	const UEISItemDefinitionRegistry* Registry = UEISItemDefinitionRegistry::Get();
+	const uint16 DefinitionIndex = Registry ? Registry->FindIndexByName(ScriptName) : UEISItemDefinitionRegistry::InvalidIndex;
+	
+	if (DefinitionIndex != UEISItemDefinitionRegistry::InvalidIndex)
+	{
+		for (UEISItemInstance* Item : Items)
+		{
+			if (Item->GetDefinitionIndex() == DefinitionIndex)
+			{
+				return Item;
+			}
+		}
+		return nullptr;
+	}
+	
+	for (UEISItemInstance* Item : Items)
+	{
+		const UEISItemDefinition* Def = Item->GetDefinition();
+		if (Def->ScriptName == ScriptName)
+		{
+			return Item;
+		}
+	}
+	return nullptr;
+}
+
+UEISItemInstance* UEISItemContainer::FindItemById(int ItemId) const
+{
+	EnsureStartingData();
+
+	for (UEISItemInstance* Item : Items)
+	{
+		if (Item->GetItemId() == ItemId)
+		{
+			return Item;
+		}
+	}
+	return nullptr;
+}
+
+void UEISItemContainer::CallRemoveItem(UEISItemInstance* Item)
+{
+	RemoveItem(Item);
+}
+
+void UEISItemContainer::CallResyncItems(const TArray<UEISItemInstance*>& InItems,
+                                        const TArray<FEISItemInstanceData>& InItemsData)
+{
+	if (InItems.Num() != InItemsData.Num())
+	{
+		return;
+	}
+
+	TArray<UEISItemInstance*> PrevItems = Items;
+	for (UEISItemInstance* Item : PrevItems)
+	{
+		UntrackItem(Item);
+	}
+	Items.Reset();
+	
+	for (int i = 0; i < InItems.Num(); i++)
+	{
+		if (UEISItemInstance* Item = InItems[i])
+		{
+			Item->ApplyItemInstanceData(InItemsData[i]);
+			InsertItemInternal(Item);
+		}
+	}
+
+	TArray<UEISItemInstance*> AddedItems;
+	TArray<UEISItemInstance*> RemovedItems;
+	
+	for (UEISItemInstance* Item : Items)
+	{
+		if (!PrevItems.Contains(Item))
+		{
+			AddedItems.Add(Item);
+		}
+	}
+	
+	for (UEISItemInstance* Item : PrevItems)
+	{
+		if (!Items.Contains(Item))
+		{
+			RemovedItems.Add(Item);
+		}
+	}
+
+	BroadcastChange(FEISItemContainerChangeData(AddedItems, RemovedItems));
+}
+
+bool UEISItemContainer::FindAvailablePlace(UEISItemInstance* Item)
+{
+	EnsureStartingData();
+
+	if (IsCommodityItem(Item))
+	{
+		return AddCommodityAmountFrom(Item);
+	}
+	
+	if (!Item)
+	{
+		return false;
+	}
+
+	const int Amount = Item->GetAmount();
+	const int FittingAmount = FMath::Min(Amount, GetMaxAddableAmount(Item));
+	int RemainingAmount = FillExistingStacks(Item, FittingAmount);
+	int LeftAmount = Amount - FittingAmount;
+
+	if (RemainingAmount == 0 && LeftAmount == 0)
+	{
+		RemoveItem(Item);
+		return true;
+	}
+
+	// The item itself is placed first, so whatever the generated stacks cannot take can go back onto it.
+	TArray<UEISItemInstance*> AddedItems;
+	if (RemainingAmount > 0)
+	{
+		Item->SetAmount(FMath::Min(RemainingAmount, FMath::Max(Item->GetStackLimit(), 1)));
+		if (CanAddItem(Item))
+		{
+			InsertItemInternal(Item);
+			AddedItems.Add(Item);
+			RemainingAmount = GenerateStacks(Item, RemainingAmount - Item->GetAmount(), AddedItems);
+		}
+	}
+	LeftAmount += RemainingAmount;
+
+	if (LeftAmount > 0)
+	{
+		if (AddedItems.Num() > 0 && AddedItems[0] == Item)
+		{
+			RemoveItemInternal(Item);
+			AddedItems.RemoveAt(0);
+			LeftAmount += Item->GetAmount();
+		}
+		Item->SetAmount(LeftAmount);
+	}
+
+	if (!AddedItems.IsEmpty())
+	{
+		BroadcastChange(FEISItemContainerChangeData(AddedItems, {}));
+	}
+	return LeftAmount == 0;
+}
+
+bool UEISItemContainer::AddItem(UEISItemInstance* Item)
+{
+	EnsureStartingData();
+
+	if (IsCommodityItem(Item))
+	{
+		return AddCommodityAmountFrom(Item);
+	}
+	
+	if (!Item || !CanAddItem(Item))
+	{
+		return false;
+	}
+
+	InsertItemInternal(Item);
+	BroadcastChange(FEISItemContainerChangeData(TArray{Item}, {}));
+	return true;
+}
+
+void UEISItemContainer::RemoveItem(UEISItemInstance* Item)
+{
+	EnsureStartingData();
+
+	if (Item && Items.Contains(Item))
+	{
+		RemoveItemInternal(Item);
+		BroadcastChange(FEISItemContainerChangeData({}, TArray{Item}));
+	}
+}
+
+bool UEISItemContainer::StackItem(UEISItemInstance* SourceItem, UEISItemInstance* TargetItem)
+{
+	EnsureStartingData();
+
+	if (SourceItem && TargetItem)
+	{
+		if (TargetItem->CanStackItem(SourceItem))
+		{
+			const int StackedAmount = GetStackableAmount(SourceItem, TargetItem);
+			if (StackedAmount <= 0)
+			{
+				return false;
+			}
+			
+			TargetItem->AddAmount(StackedAmount);
+			
+			if (StackedAmount == SourceItem->GetAmount())
+			{
+				RemoveItem(SourceItem);
+			}
+			else
+			{
+				SourceItem->RemoveAmount(StackedAmount);
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+int UEISItemContainer::GetStackableAmount(const UEISItemInstance* SourceItem, const UEISItemInstance* TargetItem) const
+{
+	check(SourceItem);
+	check(TargetItem);
+
+	const int StackedAmount = FMath::Min(TargetItem->GetStackCapacity(), SourceItem->GetAmount());
+	
+	// Stacking within the container moves amount between entries and leaves the budgets untouched.
+	return SourceItem->GetOwner() == this ? StackedAmount : FMath::Min(StackedAmount, GetMaxAddableAmount(SourceItem));
+}
+
+bool UEISItemContainer::SplitItem(UEISItemInstance* Item, int Amount)
+{
+	EnsureStartingData();
+
+	if (!CanSplitItem(Item, Amount))
+	{
+		return false;
+	}
+
+	UEISItemInstance* SplitItem = UEISInventoryFunctionLibrary::GenerateItem(GetWorld(), Item);
+	if (SplitItem == nullptr)
+	{
+		return false;
+	}
+
+	Item->RemoveAmount(Amount);
+	SplitItem->SetAmount(Amount);
+
+	// Checked by CanSplitItem; AddItem would count the moved amount against the budgets a second time.
+	InsertItemInternal(SplitItem);
+	BroadcastChange(FEISItemContainerChangeData(TArray{SplitItem}, {}));
+	return true;
+}
+
+int UEISItemContainer::InsertItemAmount(TSubclassOf<UEISItemInstance> ItemClass, int Amount)
+{
+	if (!ItemClass)
+	{
+		return Amount;
+	}
+	
+	return InsertItemAmountFrom(ItemClass->GetDefaultObject<UEISItemInstance>(), Amount);
+}
+
+int UEISItemContainer::InsertItemAmountFrom(const UEISItemInstance* SourceItem, int Amount)
+{
+	EnsureStartingData();
+
+	if (!SourceItem || Amount <= 0)
+	{
+		return FMath::Max(Amount, 0);
+	}
+
+	if (IsCommodityItem(SourceItem))
+	{
+		return Amount - AddCommodityAmount(SourceItem->GetClass(), Amount);
+	}
+
+	const int FittingAmount = FMath::Min(Amount, GetMaxAddableAmount(SourceItem));
+	if (FittingAmount <= 0)
+	{
+		return Amount;
+	}
+	
+	int RemainingAmount = FillExistingStacks(SourceItem, FittingAmount);
+	if (RemainingAmount > 0)
+	{
+		TArray<UEISItemInstance*> AddedItems;
+		RemainingAmount = GenerateStacks(SourceItem, RemainingAmount, AddedItems);
+		
+		if (!AddedItems.IsEmpty())
+		{
+			BroadcastChange(FEISItemContainerChangeData(AddedItems, {}));
+		}
+	}
+	return RemainingAmount + Amount - FittingAmount;
+}
+
+int UEISItemContainer::ConsumeItemAmount(const UEISItemDefinition* Definition, int Amount)
+{
+	EnsureStartingData();
+
+	if (!Definition || Amount <= 0)
+	{
+		return 0;
+	}
+
+	FEISItemContainerChangeBatch ChangeBatch(this);
+	int RemainingAmount = Amount;
+	
+	for (int32 i = Items.Num() - 1; i >= 0 && RemainingAmount > 0; i--)
+	{
+		UEISItemInstance* Item = Items[i];
+		if (!Item || Item->GetDefinition() != Definition)
+		{
+			continue;
+		}
+
+		const int ConsumedAmount = FMath::Min(Item->GetAmount(), RemainingAmount);
+		RemainingAmount -= ConsumedAmount;
+		
+		if (ConsumedAmount == Item->GetAmount())
+		{
+			Items.RemoveAt(i);
+			UntrackItem(Item);
+			BroadcastChange(FEISItemContainerChangeData({}, TArray{Item}));
+		}
+		else
+		{
+			Item->RemoveAmount(ConsumedAmount);
+		}
+	}
+
+	for (int32 ClassIndex = 0; ClassIndex < CommodityStacks.ItemClasses.Num() && RemainingAmount > 0; ClassIndex++)
+	{
+		const TSubclassOf<UEISItemInstance> ItemClass = CommodityStacks.ItemClasses[ClassIndex];
+		if (ItemClass && ItemClass.GetDefaultObject()->GetDefinition() == Definition)
+		{
+			RemainingAmount -= RemoveCommodityAmount(ItemClass, RemainingAmount);
+		}
+	}
+	return Amount - RemainingAmount;
+}
+
+void UEISItemContainer::ConsolidateStacks()
+{
+	EnsureStartingData();
+
+	TArray<int> Amounts;
+	Amounts.SetNumUninitialized(Items.Num());
+
+	TMap<const UEISItemDefinition*, int32> OpenStacks;
+	bool bAmountsChanged = false;
+	
+	for (int32 i = 0; i < Items.Num(); i++)
+	{
+		const UEISItemInstance* Item = Items[i];
+		Amounts[i] = Item ? Item->GetAmount() : 0;
+		
+		if (!Item || !Item->GetHotData().IsStackable())
+		{
+			continue;
+		}
+
+		const int StackLimit = Item->GetStackLimit();
+		const UEISItemDefinition* Def = Item->GetDefinition();
+		
+		int32* OpenStack = OpenStacks.Find(Def);
+		if (OpenStack && Items[*OpenStack]->CanStackItem(Item))
+		{
+			const int StackedAmount = FMath::Min(StackLimit - Amounts[*OpenStack], Amounts[i]);
+			Amounts[*OpenStack] += StackedAmount;
+			Amounts[i] -= StackedAmount;
+			bAmountsChanged |= StackedAmount > 0;
+
+			if (Amounts[*OpenStack] < StackLimit)
+			{
+				continue;
+			}
+			
+			OpenStacks.Remove(Def);
+		}
+		
+		if (Amounts[i] > 0 && Amounts[i] < StackLimit)
+		{
+			OpenStacks.Add(Def, i);
+		}
+	}
+
+	if (!bAmountsChanged)
+	{
+		return;
+	}
+
+	TArray<UEISItemInstance*> KeptItems;
+	TArray<UEISItemInstance*> RemovedItems;
+	KeptItems.Reserve(Items.Num());
+	
+	for (int32 i = 0; i < Items.Num(); i++)
+	{
+		UEISItemInstance* Item = Items[i];
+		if (Item && Amounts[i] == 0)
+		{
+			RemovedItems.Add(Item);
+			continue;
+		}
+		
+		KeptItems.Add(Item);
+		if (Item && Item->GetAmount() != Amounts[i])
+		{
+			Item->SetAmount(Amounts[i]);
+		}
+	}
+
+	for (UEISItemInstance* Item : RemovedItems)
+	{
+		UntrackItem(Item);
+	}
+	Items = MoveTemp(KeptItems);
+	
+	BroadcastChange(FEISItemContainerChangeData({}, RemovedItems));
+}
+
+void UEISItemContainer::SortItems(EEISItemSortKey SortKey, bool bDescending)
+{
+	EnsureStartingData();
+
+	TArray<FEISItemSortEntry> Entries;
+	Entries.Reserve(Items.Num());
+	
+	for (UEISItemInstance* Item : Items)
+	{
+		Entries.Add(FEISItemSortEntry::Make(Item));
+	}
+
+	Entries.StableSort([SortKey, bDescending](const FEISItemSortEntry& A, const FEISItemSortEntry& B)
+	{
+		const int32 Order = FEISItemSortEntry::Compare(A, B, SortKey);
+		return bDescending ? Order > 0 : Order < 0;
+	});
+
+	bool bOrderChanged = false;
+	for (int32 i = 0; i < Entries.Num(); i++)
+	{
+		bOrderChanged |= Items[i] != Entries[i].Item;
+		Items[i] = Entries[i].Item;
+	}
+
+	if (bOrderChanged)
+	{
+		FEISItemContainerChangeData ChangeData;
+		ChangeData.bOrderChanged = true;
+		BroadcastChange(ChangeData);
+		MarkSnapshotDirty();
+	}
+}
+
+bool UEISItemContainer::MoveAllItemsFrom(UEISItemContainer* SourceContainer, const FGameplayTagContainer& Filter,
+                                         TArray<UEISItemInstance*>& OutRemainingItems)
+{
+	EnsureStartingData();
+
+	OutRemainingItems.Reset();
+	
+	if (!SourceContainer || SourceContainer == this)
+	{
+		return false;
+	}
+
+	SourceContainer->EnsureStartingData();
+	
+	FEISItemContainerChangeBatch SourceBatch(SourceContainer);
+	FEISItemContainerChangeBatch TargetBatch(this);
+
+	// Stacks with free capacity by definition, so moved items do not scan the whole target.
+	TMap<const UEISItemDefinition*, TArray<UEISItemInstance*>> OpenStacks;
+	for (UEISItemInstance* Item : Items)
+	{
+		if (Item && Item->GetHotData().IsStackable() && Item->GetStackCapacity() > 0)
+		{
+			OpenStacks.FindOrAdd(Item->GetDefinition()).Add(Item);
+		}
+	}
+
+	TSet<UEISItemInstance*> LeavingItems;
+	TArray<UEISItemInstance*> AddedItems;
+	
+	for (UEISItemInstance* Item : SourceContainer->Items)
+	{
+		if (!Item || (!Filter.IsEmpty() && !Item->GetTags().HasAny(Filter)))
+		{
+			continue;
+		}
+
+		if (IsCommodityItem(Item))
+		{
+			AddCommodityAmount(Item->GetClass(), Item->GetAmount());
+			LeavingItems.Add(Item);
+			SourceContainer->UntrackItem(Item);
+			continue;
+		}
+		
+		if (!CanAddItem(Item))
+		{
+			OutRemainingItems.Add(Item);
+			continue;
+		}
+
+		int RemainingAmount = Item->GetAmount();
+		TArray<UEISItemInstance*>* DefinitionStacks = Item->GetHotData().IsStackable()
+			                                              ? OpenStacks.Find(Item->GetDefinition())
+			                                              : nullptr;
+		
+		for (int32 StackIndex = DefinitionStacks ? DefinitionStacks->Num() - 1 : INDEX_NONE;
+		     StackIndex >= 0 && RemainingAmount > 0; StackIndex--)
+		{
+			UEISItemInstance* StackableItem = (*DefinitionStacks)[StackIndex];
+			if (!StackableItem->CanStackItem(Item))
+			{
+				continue;
+			}
+
+			const int StackedAmount = FMath::Min(StackableItem->GetStackCapacity(), RemainingAmount);
+			StackableItem->AddAmount(StackedAmount);
+			RemainingAmount -= StackedAmount;
+
+			if (StackableItem->GetStackCapacity() == 0)
+			{
+				DefinitionStacks->RemoveAtSwap(StackIndex, 1, false);
+			}
+		}
+
+		if (RemainingAmount > 0 && RemainingAmount != Item->GetAmount())
+		{
+			Item->SetAmount(RemainingAmount);
+		}
+		
+		LeavingItems.Add(Item);
+		SourceContainer->UntrackItem(Item);
+
+		if (RemainingAmount > 0)
+		{
+			InsertItemInternal(Item);
+			AddedItems.Add(Item);
+
+			if (Item->GetHotData().IsStackable() && Item->GetStackCapacity() > 0)
+			{
+				OpenStacks.FindOrAdd(Item->GetDefinition()).Add(Item);
+			}
+		}
+	}
+
+	const FEISCommodityStacks SourceCommodityStacks = SourceContainer->CommodityStacks;
+	for (const TSubclassOf<UEISItemInstance>& ItemClass : SourceCommodityStacks.ItemClasses)
+	{
+		if (!ItemClass || (!Filter.IsEmpty() && !ItemClass.GetDefaultObject()->GetTags().HasAny(Filter)))
+		{
+			continue;
+		}
+
+		const int CommodityAmount = SourceContainer->GetCommodityAmount(ItemClass);
+		const int MovedAmount = CommodityAmount - InsertItemAmount(ItemClass, CommodityAmount);
+		SourceContainer->RemoveCommodityAmount(ItemClass, MovedAmount);
+	}
+
+	if (!LeavingItems.IsEmpty())
+	{
+		TArray<UEISItemInstance*> RemovedItems;
+		RemovedItems.Reserve(LeavingItems.Num());
+		
+		SourceContainer->Items.RemoveAll([&LeavingItems, &RemovedItems](UEISItemInstance* Item)
+		{
+			if (LeavingItems.Contains(Item))
+			{
+				RemovedItems.Add(Item);
+				return true;
+			}
+			return false;
+		});
+		SourceContainer->BroadcastChange(FEISItemContainerChangeData({}, RemovedItems));
+	}
+
+	if (!AddedItems.IsEmpty())
+	{
+		BroadcastChange(FEISItemContainerChangeData(AddedItems, {}));
+	}
+	return OutRemainingItems.IsEmpty();
+}
+
+int UEISItemContainer::AddCommodityAmount(TSubclassOf<UEISItemInstance> ItemClass, int Amount)
+{
+	EnsureStartingData();
+
+	if (!ItemClass || Amount <= 0)
+	{
+		return 0;
+	}
+
+	const UEISItemInstance* CommodityItem = ItemClass->GetDefaultObject<UEISItemInstance>();
+	if (!IsCommodityItem(CommodityItem))
+	{
+		return 0;
+	}
+
+	Amount = FMath::Min(Amount, GetMaxAddableAmount(CommodityItem));
+	if (Amount <= 0)
+	{
+		return 0;
+	}
+
+	const int32 ClassIndex = CommodityStacks.FindOrAddClass(ItemClass);
+	const int StackLimit = CommodityItem->GetStackLimit();
+	int RemainingAmount = Amount;
+	
+	for (int32 Row = 0; Row < CommodityStacks.Num() && RemainingAmount > 0; Row++)
+	{
+		const int PrevAmount = CommodityStacks.Amounts[Row];
+		if (CommodityStacks.ClassIndices[Row] != ClassIndex || PrevAmount >= StackLimit)
+		{
+			continue;
+		}
 
-bool UEISItemContainer::ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags)
-{
-	bool bReplicateSomething = false;
-	for (UEISItemInstance* Item : GetItems())
+		const int AddedAmount = FMath::Min(StackLimit - PrevAmount, RemainingAmount);
+		CommodityStacks.Amounts[Row] += AddedAmount;
+		RemainingAmount -= AddedAmount;
+		OnCommodityAmountChange(CommodityItem, CommodityStacks.ItemIds[Row], CommodityStacks.Amounts[Row], PrevAmount);
+	}
+	
+	while (RemainingAmount > 0)
 	{
-		bReplicateSomething |= Channel->ReplicateSubobject(Item, *Bunch, *RepFlags);
-		bReplicateSomething |= Item->ReplicateSubobjects(Channel, Bunch, RepFlags);
+		const int StackAmount = FMath::Min(StackLimit, RemainingAmount);
+		const int32 Row = CommodityStacks.AddRow(ClassIndex, UEISInventoryFunctionLibrary::GenerateItemId(), StackAmount);
+		RemainingAmount -= StackAmount;
+		OnCommodityAmountChange(CommodityItem, CommodityStacks.ItemIds[Row], StackAmount, 0);
 	}
 
-	return bReplicateSomething;
+	BroadcastCommodityChange();
+	return Amount;
 }
 
-void UEISItemContainer::SetupItemContainer(FGameplayTagContainer ContainerTags)
+bool UEISItemContainer::AddCommodityAmountFrom(UEISItemInstance* Item)
 {
-	CategoryTags = ContainerTags;
+	const int AddedAmount = AddCommodityAmount(Item->GetClass(), Item->GetAmount());
+	if (AddedAmount < Item->GetAmount())
+	{
+		Item->SetAmount(Item->GetAmount() - AddedAmount);
+		return false;
+	}
+	return true;
 }
 
-void UEISItemContainer::AddStartingData()
+int UEISItemContainer::RemoveCommodityAmount(TSubclassOf<UEISItemInstance> ItemClass, int Amount)
 {
-	for (UClass* RawClass : StartingData)
+	EnsureStartingData();
+
+	const int32 ClassIndex = CommodityStacks.FindClass(ItemClass);
+	if (ClassIndex == INDEX_NONE || Amount <= 0)
 	{
-		if (!IsValid(RawClass))
+		return 0;
+	}
+
+	const UEISItemInstance* CommodityItem = ItemClass->GetDefaultObject<UEISItemInstance>();
+	int RemainingAmount = Amount;
+	
+	for (int32 Row = CommodityStacks.Num() - 1; Row >= 0 && RemainingAmount > 0; Row--)
+	{
+		if (CommodityStacks.ClassIndices[Row] != ClassIndex)
 		{
 			continue;
 		}
 
-		const UEISItemInstance* ItemCDO = RawClass->GetDefaultObject<UEISItemInstance>();
-		check(ItemCDO);
-
-		if (CanAddItem(ItemCDO))
+		const int PrevAmount = CommodityStacks.Amounts[Row];
+		const int RemovedAmount = FMath::Min(PrevAmount, RemainingAmount);
+		const int32 ItemId = CommodityStacks.ItemIds[Row];
+		RemainingAmount -= RemovedAmount;
+		
+		if (RemovedAmount == PrevAmount)
 		{
-			UEISItemInstance* Item = UEISInventoryFunctionLibrary::GenerateItem(GetWorld(), ItemCDO);
-			check(Item);
-
-			AddItem(Item);
+			CommodityStacks.RemoveRow(Row);
 		}
+		else
+		{
+			CommodityStacks.Amounts[Row] -= RemovedAmount;
+		}
+		
+		OnCommodityAmountChange(CommodityItem, ItemId, PrevAmount - RemovedAmount, PrevAmount);
 	}
-	
-	StartingData.Empty();
+
+	if (RemainingAmount != Amount)
+	{
+		BroadcastCommodityChange();
+	}
+	return Amount - RemainingAmount;
 }
 
-bool UEISItemContainer::CanAddItem(const UEISItemInstance* Item) const
+UEISItemInstance* UEISItemContainer::MaterializeCommodity(TSubclassOf<UEISItemInstance> ItemClass, int Amount)
 {
-	check(Item);
+	EnsureStartingData();
+
+	const int32 ClassIndex = CommodityStacks.FindClass(ItemClass);
+	if (ClassIndex == INDEX_NONE || Amount <= 0)
+	{
+		return nullptr;
+	}
+
+	const int32 Row = CommodityStacks.ClassIndices.FindLast(static_cast<uint16>(ClassIndex));
+	if (Row == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	const UEISItemInstance* CommodityItem = ItemClass->GetDefaultObject<UEISItemInstance>();
+	const int PrevAmount = CommodityStacks.Amounts[Row];
+	const int RowItemId = CommodityStacks.ItemIds[Row];
+
+	FEISItemInstanceData ItemData;
+	ItemData.Amount = FMath::Min(PrevAmount, Amount);
+	ItemData.ItemId = ItemData.Amount == PrevAmount ? RowItemId : UEISInventoryFunctionLibrary::GenerateItemId();
 	
-	const UEISItemDefinition* Def = Item->GetDefinition();
-	if (Def != nullptr)
+	UEISItemInstance* Item = UEISInventoryFunctionLibrary::GenerateItemWithData(GetWorld(), CommodityItem, ItemData);
+	if (!Item)
 	{
-		return Def->Tags.HasAny(CategoryTags);
+		return nullptr;
+	}
+
+	if (ItemData.Amount == PrevAmount)
+	{
+		CommodityStacks.RemoveRow(Row);
 	}
+	else
+	{
+		CommodityStacks.Amounts[Row] -= ItemData.Amount;
+	}
+	OnCommodityAmountChange(CommodityItem, RowItemId, PrevAmount - ItemData.Amount, PrevAmount);
 	
-	return false;
+	InsertItemInternal(Item);
+	BroadcastCommodityChange();
+	BroadcastChange(FEISItemContainerChangeData(TArray{Item}, {}));
+	return Item;
 }
 
-bool UEISItemContainer::Contains(const UEISItemInstance* Item) const
+void UEISItemContainer::OnItemAdded(UEISItemInstance* Item)
 {
-	return Items.Contains(Item);
+	ContentsChecksum += Item->GetContentsHash();
+	ApplyItemCountDelta(Item->GetDefinition(), Item->GetAmount());
+	UpdateOpenStackCapacity(Item, Item->GetAmount(), 0);
+	MarkSnapshotDirty();
 }
 
-UEISItemInstance* UEISItemContainer::FindFirstStackForItem(const UEISItemInstance* ForItem) const
+void UEISItemContainer::OnItemRemoved(UEISItemInstance* Item)
 {
-	for (int i = 0; i < Items.Num(); i++)
+	ContentsChecksum -= Item->GetContentsHash();
+	ApplyItemCountDelta(Item->GetDefinition(), -Item->GetAmount());
+	UpdateOpenStackCapacity(Item, 0, Item->GetAmount());
+	MarkSnapshotDirty();
+}
+
+void UEISItemContainer::OnItemAmountChange(int NewAmount, int PrevAmount, UEISItemInstance* Item)
+{
+	ContentsChecksum -= UEISItemInstance::MakeContentsHash(Item->GetItemId(), Item->GetHotData().NameHash, PrevAmount);
+	ContentsChecksum += UEISItemInstance::MakeContentsHash(Item->GetItemId(), Item->GetHotData().NameHash, NewAmount);
+	ApplyItemCountDelta(Item->GetDefinition(), NewAmount - PrevAmount);
+	UpdateOpenStackCapacity(Item, NewAmount, PrevAmount);
+	MarkSnapshotDirty();
+}
+
+void UEISItemContainer::OnCommodityAmountChange(const UEISItemInstance* CommodityItem, int ItemId, int NewAmount,
+                                                int PrevAmount)
+{
+	if (PrevAmount > 0)
 	{
-		auto FoundItem = Items[i];
-		if (!FoundItem)
+		ContentsChecksum -= UEISItemInstance::MakeContentsHash(ItemId, CommodityItem->GetHotData().NameHash, PrevAmount);
+	}
+	
+	if (NewAmount > 0)
+	{
+		ContentsChecksum += UEISItemInstance::MakeContentsHash(ItemId, CommodityItem->GetHotData().NameHash, NewAmount);
+	}
+
+	ApplyItemCountDelta(CommodityItem->GetDefinition(), NewAmount - PrevAmount);
+	UpdateOpenStackCapacity(CommodityItem, NewAmount, PrevAmount);
+	MarkSnapshotDirty();
+}
+
+void UEISItemContainer::UpdateOpenStackCapacity(const UEISItemInstance* Item, int NewAmount, int PrevAmount)
+{
+	if (!Item->GetDefinition())
+	{
+		return;
+	}
+
+	// An empty stack has no room left: it is gone from the container, not waiting to be refilled.
+	const int64 StackLimit = Item->GetHotData().StackLimit;
+	auto GetOpenCapacity = [StackLimit](int Amount) -> int64
+	{
+		return Amount > 0 ? FMath::Max<int64>(StackLimit - Amount, 0) : 0;
+	};
+
+	const int64 Delta = GetOpenCapacity(NewAmount) - GetOpenCapacity(PrevAmount);
+	if (Delta != 0)
+	{
+		int64& OpenCapacity = OpenStackCapacity.FindOrAdd(Item->GetDefinition());
+		OpenCapacity += Delta;
+		if (OpenCapacity <= 0)
+		{
+			OpenStackCapacity.Remove(Item->GetDefinition());
+		}
+	}
+}
+
+int UEISItemContainer::FillExistingStacks(const UEISItemInstance* ForItem, int Amount)
+{
+	// Early out only; CanStackItem below has the final say, overrides included.
+	if (!ForItem->GetHotData().IsStackable())
+	{
+		return Amount;
+	}
+	
+	for (int i = 0; i < Items.Num() && Amount > 0; i++)
+	{
+		UEISItemInstance* StackableItem = Items[i];
+		if (!StackableItem || !StackableItem->CanStackItem(ForItem))
 		{
 			continue;
 		}
-		
-		if (FoundItem->CanStackItem(ForItem))
+
+		const int StackedAmount = FMath::Min(StackableItem->GetStackCapacity(), Amount);
+		if (StackedAmount > 0)
 		{
-			return FoundItem;
+			StackableItem->AddAmount(StackedAmount);
+			Amount -= StackedAmount;
 		}
 	}
-	return nullptr;
+	return Amount;
 }
 
-UEISItemInstance* UEISItemContainer::FindItemByDefinition(const UEISItemDefinition* Definition) const
+int UEISItemContainer::GenerateStacks(const UEISItemInstance* SourceItem, int Amount,
+                                      TArray<UEISItemInstance*>& OutAddedItems)
 {
-	for (UEISItemInstance* Item : Items)
+	const int StackLimit = FMath::Max(SourceItem->GetStackLimit(), 1);
+	OutAddedItems.Reserve(OutAddedItems.Num() + FMath::DivideAndRoundUp(Amount, StackLimit));
+	
+	while (Amount > 0 && CanPlaceItem(SourceItem))
 	{
-		const UEISItemDefinition* Def = Item->GetDefinition();
-		if (Def == Definition)
+		FEISItemInstanceData ItemData;
+		ItemData.ItemId = UEISInventoryFunctionLibrary::GenerateItemId();
+		ItemData.Amount = FMath::Min(StackLimit, Amount);
+
+		UEISItemInstance* NewItem = UEISInventoryFunctionLibrary::GenerateItemWithData(GetWorld(), SourceItem, ItemData);
+		if (!NewItem)
 		{
-			return Item;
+			break;
 		}
+		
+		InsertItemInternal(NewItem);
+		OutAddedItems.Add(NewItem);
+		Amount -= ItemData.Amount;
 	}
-	return nullptr;
+	return Amount;
 }
 
-UEISItemInstance* UEISItemContainer::FindItemByName(const FName& ScriptName) const
+void UEISItemContainer::InsertItemInternal(UEISItemInstance* Item)
 {
-	for (UEISItemInstance* Item : Items)
+	Items.Add(Item);
+	TrackItem(Item);
+}
+
+void UEISItemContainer::RemoveItemInternal(UEISItemInstance* Item)
+{
+	Items.Remove(Item);
+	UntrackItem(Item);
+}
+
+UEISItemFilterView* UEISItemContainer::CreateFilterView(const FGameplayTagContainer& TagFilter,
+                                                        const FString& SearchText)
+{
+	UEISItemFilterView* View = NewObject<UEISItemFilterView>(this);
+	View->Initialize(this, TagFilter, SearchText);
+	return View;
+}
+
+UEISItemSortedView* UEISItemContainer::CreateSortedView(EEISItemSortKey SortKey, bool bDescending)
+{
+	UEISItemSortedView* View = NewObject<UEISItemSortedView>(this);
+	View->Initialize(this, SortKey, bDescending);
+	return View;
+}
+
+const FEISItemSearchIndex& UEISItemContainer::GetSearchIndex() const
+{
+	EnsureStartingData();
+
+	if (!bSearchIndexBuilt)
 	{
-		const UEISItemDefinition* Def = Item->GetDefinition();
-		if (Def->ScriptName == ScriptName)
-		{
-			return Item;
-		}
+		bSearchIndexBuilt = true;
+		SearchIndex.Build(Items);
 	}
-	return nullptr;
+	return SearchIndex;
 }
 
-UEISItemInstance* UEISItemContainer::FindItemById(int ItemId) const
+void UEISItemContainer::TrackItem(UEISItemInstance* Item)
 {
-	for (UEISItemInstance* Item : Items)
+	Item->AddToContainer(this);
+	Item->OnAmountChangeDelegate.AddUObject(this, &ThisClass::OnItemAmountChange, Item);
+	OnItemAdded(Item);
+
+	PropagateIndexedItem(Item, true);
+	AttachChildContainer(Item->GetChildContainer());
+
+	if (bSearchIndexBuilt)
 	{
-		if (Item->GetItemId() == ItemId)
-		{
-			return Item;
-		}
+		SearchIndex.AddItem(Item);
 	}
-	return nullptr;
 }
 
-void UEISItemContainer::CallRemoveItem(UEISItemInstance* Item)
+void UEISItemContainer::UntrackItem(UEISItemInstance* Item)
 {
-	RemoveItem(Item);
+	Item->OnAmountChangeDelegate.RemoveAll(this);
+	OnItemRemoved(Item);
+
+	DetachChildContainer(Item->GetChildContainer());
+	PropagateIndexedItem(Item, false);
+
+	if (bSearchIndexBuilt)
+	{
+		SearchIndex.RemoveItem(Item);
+	}
 }
 
-bool UEISItemContainer::FindAvailablePlace(UEISItemInstance* Item)
+void UEISItemContainer::BroadcastChange(const FEISItemContainerChangeData& ChangeData)
 {
-	if (Item)
+	if (ChangeBatchDepth > 0)
 	{
-		if (UEISItemInstance* StackableItem = FindFirstStackForItem(Item))
+		for (UEISItemInstance* Item : ChangeData.AddedItems)
 		{
-			StackItem(Item, StackableItem);
-			return true;
+			if (PendingChangeData.RemovedItems.Remove(Item) == 0)
+			{
+				PendingChangeData.AddedItems.Add(Item);
+			}
 		}
 		
-		if (CanAddItem(Item))
+		for (UEISItemInstance* Item : ChangeData.RemovedItems)
 		{
-			AddItem(Item);
-			return true;
+			if (PendingChangeData.AddedItems.Remove(Item) == 0)
+			{
+				PendingChangeData.RemovedItems.Add(Item);
+			}
 		}
+		
+		PendingChangeData.bOrderChanged |= ChangeData.bOrderChanged;
+		return;
 	}
-	return false;
+	
+	OnContainerChangeDelegate.Broadcast(ChangeData);
+	OnContainerChange.Broadcast(ChangeData);
 }
 
-void UEISItemContainer::AddItem(UEISItemInstance* Item)
+void UEISItemContainer::ApplyItemCountDelta(const UEISItemDefinition* Definition, int32 Delta)
 {
-	if (Item && CanAddItem(Item))
+	if (Definition && Delta != 0)
 	{
-		Items.Add(Item);
-		Item->AddToContainer(this);
-		OnContainerChangeDelegate.Broadcast(FEISItemContainerChangeData(TArray{Item}, {}));
-		OnContainerChange.Broadcast(FEISItemContainerChangeData(TArray{Item}, {}));
+		ItemCounts.ApplyDelta(Definition, Delta);
+		ContentsVolume += Definition->Volume * Delta;
+		OnItemCountChangeDelegate.Broadcast(Definition, Delta);
+		PropagateCountDelta(Definition, Delta);
 	}
 }
 
-void UEISItemContainer::RemoveItem(UEISItemInstance* Item)
+void UEISItemContainer::PropagateCountDelta(const UEISItemDefinition* Definition, int32 Delta)
 {
-	if (Item && Items.Contains(Item))
+	for (UEISItemContainer* Container = this; Container; Container = Container->ParentContainer.Get())
 	{
-		Items.Remove(Item);
-		OnContainerChangeDelegate.Broadcast(FEISItemContainerChangeData({}, TArray{Item}));
-		OnContainerChange.Broadcast(FEISItemContainerChangeData({}, TArray{Item}));
+		Container->SubtreeCounts.ApplyDelta(Definition, Delta);
+		Container->SubtreeWeight += Definition->Weight * Delta;
+		Container->OnSubtreeCountChangeDelegate.Broadcast(Definition, Delta);
 	}
 }
 
-bool UEISItemContainer::StackItem(UEISItemInstance* SourceItem, UEISItemInstance* TargetItem)
+void UEISItemContainer::PropagateIndexedItem(UEISItemInstance* Item, bool bAdded)
 {
-	if (SourceItem && TargetItem)
+	const UEISItemDefinition* Definition = Item->GetDefinition();
+	for (UEISItemContainer* Container = this; Container; Container = Container->ParentContainer.Get())
 	{
-		if (TargetItem->CanStackItem(SourceItem))
+		if (bAdded)
 		{
-			TargetItem->AddAmount(SourceItem->GetAmount());
-			RemoveItem(SourceItem);
-			return true;
+			Container->SubtreeItems.FindOrAdd(Definition).Add(Item);
+		}
+		else if (TArray<UEISItemInstance*>* DefinitionItems = Container->SubtreeItems.Find(Definition))
+		{
+			DefinitionItems->RemoveSingleSwap(Item, false);
+			if (DefinitionItems->IsEmpty())
+			{
+				Container->SubtreeItems.Remove(Definition);
+			}
 		}
 	}
-	return false;
 }
 
-bool UEISItemContainer::SplitItem(UEISItemInstance* Item, int Amount)
+void UEISItemContainer::AttachChildContainer(UEISItemContainer* ChildContainer)
 {
-	if (Item && CanAddItem(Item))
+	if (!ChildContainer || ChildContainer->ParentContainer == this)
+	{
+		return;
+	}
+
+	// Materialized before linking, otherwise the starting items would reach this container twice.
+	ChildContainer->EnsureStartingData();
+	ChildContainer->ParentContainer = this;
+
+	for (const TPair<const UEISItemDefinition*, int32>& Count : ChildContainer->SubtreeCounts.DefinitionCounts)
+	{
+		PropagateCountDelta(Count.Key, Count.Value);
+	}
+
+	for (const TPair<const UEISItemDefinition*, TArray<UEISItemInstance*>>& Entry : ChildContainer->SubtreeItems)
 	{
-		if (Item->GetAmount() > 1 && Item->GetAmount() > Amount)
+		for (UEISItemInstance* Item : Entry.Value)
 		{
-			UEISItemInstance* SplitItem = UEISInventoryFunctionLibrary::GenerateItem(GetWorld(), Item);
-			if (SplitItem != nullptr)
-			{
-				Item->RemoveAmount(Amount);
-				SplitItem->SetAmount(Amount);
-				AddItem(SplitItem);
-			}
+			PropagateIndexedItem(Item, true);
 		}
 	}
-	return false;
+}
+
+void UEISItemContainer::DetachChildContainer(UEISItemContainer* ChildContainer)
+{
+	if (!ChildContainer || ChildContainer->ParentContainer != this)
+	{
+		return;
+	}
+
+	for (const TPair<const UEISItemDefinition*, int32>& Count : ChildContainer->SubtreeCounts.DefinitionCounts)
+	{
+		PropagateCountDelta(Count.Key, -Count.Value);
+	}
+
+	for (const TPair<const UEISItemDefinition*, TArray<UEISItemInstance*>>& Entry : ChildContainer->SubtreeItems)
+	{
+		for (UEISItemInstance* Item : Entry.Value)
+		{
+			PropagateIndexedItem(Item, false);
+		}
+	}
+
+	ChildContainer->ParentContainer = nullptr;
+}
+
+void UEISItemContainer::MarkSnapshotDirty()
+{
+	if (!bPublishSnapshots)
+	{
+		return;
+	}
+
+	if (ChangeBatchDepth > 0)
+	{
+		bSnapshotPending = true;
+		return;
+	}
+
+	PublishSnapshot();
+}
+
+void UEISItemContainer::PublishSnapshot()
+{
+	TSharedRef<FEISRepositorySnapshot, ESPMode::ThreadSafe> Snapshot = MakeShared<
+		FEISRepositorySnapshot, ESPMode::ThreadSafe>();
+	Snapshot->Version = ++SnapshotVersion;
+	Snapshot->Entries.Reserve(Items.Num() + CommodityStacks.Num());
+
+	for (const UEISItemInstance* Item : Items)
+	{
+		if (Item)
+		{
+			Snapshot->Entries.Add({Item->GetItemId(), Item->GetDefinitionIndex(), Item->GetDefinition(), Item->GetAmount()});
+		}
+	}
+
+	for (int32 Row = 0; Row < CommodityStacks.Num(); Row++)
+	{
+		// Rows whose class failed to load have no definition to report.
+		const UClass* RowClass = CommodityStacks.GetRowClass(Row);
+		if (!RowClass)
+		{
+			continue;
+		}
+
+		const UEISItemInstance* CommodityItem = RowClass->GetDefaultObject<UEISItemInstance>();
+		Snapshot->Entries.Add({CommodityStacks.ItemIds[Row], CommodityItem->GetDefinitionIndex(),
+		                       CommodityItem->GetDefinition(), CommodityStacks.Amounts[Row]});
+	}
+
+	SnapshotSource.Publish(Snapshot);
+}
+
+void UEISItemContainer::BroadcastCommodityChange()
+{
+	if (ChangeBatchDepth > 0)
+	{
+		bCommodityChangePending = true;
+		return;
+	}
+	
+	OnCommodityChangeDelegate.Broadcast();
+	OnCommodityChange.Broadcast();
 }
 
 void UEISItemContainer::OnRep_Items(TArray<UEISItemInstance*> PrevContainer)
@@ -219,7 +1803,7 @@ void UEISItemContainer::OnRep_Items(TArray<UEISItemInstance*> PrevContainer)
 
 		if (Item)
 		{
-			Item->AddToContainer(this);
+			TrackItem(Item);
 		}
 
 		AddedItems.AddUnique(Item);
@@ -231,9 +1815,56 @@ void UEISItemContainer::OnRep_Items(TArray<UEISItemInstance*> PrevContainer)
 		{
 			continue;
 		}
+
+		if (Item)
+		{
+			UntrackItem(Item);
+		}
+		
+		RemovedItems.AddUnique(Item);
+	}
+
+	BroadcastChange(FEISItemContainerChangeData(AddedItems, RemovedItems));
+}
+
+void UEISItemContainer::OnRep_CommodityStacks(const FEISCommodityStacks& PrevCommodityStacks)
+{
+	TMap<int32, int32> PrevRows;
+	PrevRows.Reserve(PrevCommodityStacks.Num());
+	
+	for (int32 Row = 0; Row < PrevCommodityStacks.Num(); Row++)
+	{
+		PrevRows.Add(PrevCommodityStacks.ItemIds[Row], Row);
+	}
+
+	for (int32 Row = 0; Row < CommodityStacks.Num(); Row++)
+	{
+		const UClass* RowClass = CommodityStacks.GetRowClass(Row);
+		if (!RowClass)
+		{
+			continue;
+		}
+		
+		const UEISItemInstance* CommodityItem = RowClass->GetDefaultObject<UEISItemInstance>();
+		const int32 ItemId = CommodityStacks.ItemIds[Row];
 		
-		RemovedItems.Remove(Item);
+		int32 PrevRow = INDEX_NONE;
+		const int PrevAmount = PrevRows.RemoveAndCopyValue(ItemId, PrevRow) ? PrevCommodityStacks.Amounts[PrevRow] : 0;
+		
+		if (PrevAmount != CommodityStacks.Amounts[Row])
+		{
+			OnCommodityAmountChange(CommodityItem, ItemId, CommodityStacks.Amounts[Row], PrevAmount);
+		}
+	}
+
+	for (const TPair<int32, int32>& PrevRow : PrevRows)
+	{
+		if (const UClass* RowClass = PrevCommodityStacks.GetRowClass(PrevRow.Value))
+		{
+			OnCommodityAmountChange(RowClass->GetDefaultObject<UEISItemInstance>(), PrevRow.Key, 0,
+			                        PrevCommodityStacks.Amounts[PrevRow.Value]);
+		}
 	}
 
-	OnContainerChange.Broadcast(FEISItemContainerChangeData(AddedItems, RemovedItems));
+	BroadcastCommodityChange();
 }
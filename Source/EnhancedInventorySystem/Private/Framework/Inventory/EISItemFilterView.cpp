@@ -0,0 +1,214 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EISItemFilterView.h"
+#include "EISItemInstance.h"
+
+void UEISItemFilterView::BeginDestroy()
+{
+	if (UEISItemContainer* OwnerContainer = Container.Get())
+	{
+		OwnerContainer->OnContainerChangeDelegate.Remove(ContainerChangeHandle);
+	}
+
+	Super::BeginDestroy();
+}
+
+void UEISItemFilterView::Initialize(UEISItemContainer* InContainer, const FGameplayTagContainer& InTagFilter,
+                                    const FString& InSearchText)
+{
+	check(InContainer);
+
+	Container = InContainer;
+	TagFilter = InTagFilter;
+	SearchText = InSearchText.ToLower();
+	ContainerChangeHandle = InContainer->OnContainerChangeDelegate.AddUObject(this, &ThisClass::OnContainerChange);
+
+	Refresh(false);
+}
+
+void UEISItemFilterView::SetTagFilter(const FGameplayTagContainer& InTagFilter)
+{
+	if (TagFilter == InTagFilter)
+	{
+		return;
+	}
+
+	TagFilter = InTagFilter;
+	Refresh(false);
+}
+
+void UEISItemFilterView::SetSearchText(const FString& InSearchText)
+{
+	FString NewSearchText = InSearchText.ToLower();
+	if (NewSearchText.Equals(SearchText, ESearchCase::CaseSensitive))
+	{
+		return;
+	}
+
+	const bool bNarrowing = !SearchText.IsEmpty() && NewSearchText.StartsWith(SearchText, ESearchCase::CaseSensitive);
+	SearchText = MoveTemp(NewSearchText);
+	Refresh(bNarrowing);
+}
+
+bool UEISItemFilterView::Matches(const UEISItemInstance* Item) const
+{
+	if (!Item)
+	{
+		return false;
+	}
+
+	if (!TagFilter.IsEmpty() && !FEISItemSearchIndex::GetSearchTags(Item).HasAnyExact(TagFilter))
+	{
+		return false;
+	}
+
+	if (SearchText.IsEmpty())
+	{
+		return true;
+	}
+
+	TArray<FString, TInlineAllocator<2>> Names;
+	FEISItemSearchIndex::GetSearchNames(Item, Names);
+	return Names.ContainsByPredicate([this](const FString& Name)
+	{
+		return Name.StartsWith(SearchText, ESearchCase::CaseSensitive);
+	});
+}
+
+void UEISItemFilterView::Refresh(bool bNarrowing)
+{
+	const UEISItemContainer* OwnerContainer = Container.Get();
+	if (!OwnerContainer)
+	{
+		SetMatchingItems({});
+		return;
+	}
+
+	TArray<UEISItemInstance*> Candidates;
+	if (bNarrowing)
+	{
+		Candidates = MatchingItems;
+	}
+	else if (!SearchText.IsEmpty())
+	{
+		OwnerContainer->GetSearchIndex().FindByPrefix(SearchText, Candidates);
+	}
+	else if (!TagFilter.IsEmpty())
+	{
+		const FEISItemSearchIndex& SearchIndex = OwnerContainer->GetSearchIndex();
+
+		TSet<UEISItemInstance*> FoundItems;
+		for (const FGameplayTag& Tag : TagFilter)
+		{
+			if (const TSet<UEISItemInstance*>* Bucket = SearchIndex.FindTagBucket(Tag))
+			{
+				for (UEISItemInstance* Item : *Bucket)
+				{
+					bool bAlreadyFound = false;
+					FoundItems.Add(Item, &bAlreadyFound);
+					if (!bAlreadyFound)
+					{
+						Candidates.Add(Item);
+					}
+				}
+			}
+		}
+	}
+	else
+	{
+		Candidates = OwnerContainer->GetItems();
+	}
+
+	Candidates.RemoveAllSwap([this](const UEISItemInstance* Item)
+	{
+		return !Matches(Item);
+	});
+	SetMatchingItems(MoveTemp(Candidates));
+}
+
+void UEISItemFilterView::SetMatchingItems(TArray<UEISItemInstance*>&& NewItems)
+{
+	FEISItemContainerChangeData ChangeData;
+
+	const TSet<UEISItemInstance*> NewItemSet(NewItems);
+	for (UEISItemInstance* Item : MatchingItems)
+	{
+		if (!NewItemSet.Contains(Item))
+		{
+			ChangeData.RemovedItems.Add(Item);
+		}
+	}
+
+	for (UEISItemInstance* Item : NewItems)
+	{
+		if (!ItemIndices.Contains(Item))
+		{
+			ChangeData.AddedItems.Add(Item);
+		}
+	}
+
+	MatchingItems = MoveTemp(NewItems);
+	ItemIndices.Reset();
+	for (int32 Index = 0; Index < MatchingItems.Num(); Index++)
+	{
+		ItemIndices.Add(MatchingItems[Index], Index);
+	}
+
+	BroadcastViewChange(ChangeData);
+}
+
+void UEISItemFilterView::AddMatchingItem(UEISItemInstance* Item)
+{
+	ItemIndices.Add(Item, MatchingItems.Add(Item));
+}
+
+bool UEISItemFilterView::RemoveMatchingItem(UEISItemInstance* Item)
+{
+	int32 Index;
+	if (!ItemIndices.RemoveAndCopyValue(Item, Index))
+	{
+		return false;
+	}
+
+	MatchingItems.RemoveAtSwap(Index);
+	if (MatchingItems.IsValidIndex(Index))
+	{
+		ItemIndices.Add(MatchingItems[Index], Index);
+	}
+	return true;
+}
+
+void UEISItemFilterView::OnContainerChange(const FEISItemContainerChangeData& ChangeData)
+{
+	FEISItemContainerChangeData ViewChangeData;
+
+	for (UEISItemInstance* Item : ChangeData.RemovedItems)
+	{
+		if (RemoveMatchingItem(Item))
+		{
+			ViewChangeData.RemovedItems.Add(Item);
+		}
+	}
+
+	for (UEISItemInstance* Item : ChangeData.AddedItems)
+	{
+		if (!ItemIndices.Contains(Item) && Matches(Item))
+		{
+			AddMatchingItem(Item);
+			ViewChangeData.AddedItems.Add(Item);
+		}
+	}
+
+	BroadcastViewChange(ViewChangeData);
+}
+
+void UEISItemFilterView::BroadcastViewChange(const FEISItemContainerChangeData& ChangeData)
+{
+	if (ChangeData.AddedItems.IsEmpty() && ChangeData.RemovedItems.IsEmpty())
+	{
+		return;
+	}
+
+	OnViewChangeDelegate.Broadcast(ChangeData);
+	OnViewChange.Broadcast(ChangeData);
+}
@@ -2,6 +2,19 @@
 
 #include "EISItemRepositoryInterface.h"
 
+int32 FEISRepositorySnapshot::GetAmount(const UEISItemDefinition* Definition) const
+{
+	int32 Amount = 0;
+	for (const FEntry& Entry : Entries)
+	{
+		if (Entry.Definition == Definition)
+		{
+			Amount += Entry.Amount;
+		}
+	}
+	return Amount;
+}
+
 void IEISItemRepositoryInterface::CallRemoveItem(UEISItemInstance* Item)
 {
 }
@@ -9,3 +22,23 @@ void IEISItemRepositoryInterface::CallRemoveItem(UEISItemInstance* Item)
 void IEISItemRepositoryInterface::CallSubtractOrRemoveItem(UEISItemInstance* Item, int Amount)
 {
 }
+
+uint32 IEISItemRepositoryInterface::GetContentsChecksum() const
+{
+	return 0;
+}
+
+TArray<UEISItemInstance*> IEISItemRepositoryInterface::GetRepositoryItems() const
+{
+	return {};
+}
+
+FEISRepositorySnapshotPtr IEISItemRepositoryInterface::GetContentsSnapshot() const
+{
+	return nullptr;
+}
+
+void IEISItemRepositoryInterface::CallResyncItems(const TArray<UEISItemInstance*>& InItems,
+                                                  const TArray<FEISItemInstanceData>& InItemsData)
+{
+}
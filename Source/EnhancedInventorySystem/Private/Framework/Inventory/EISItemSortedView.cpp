@@ -0,0 +1,194 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EISItemSortedView.h"
+#include "Algo/BinarySearch.h"
+#include "EISItemInstance.h"
+
+void UEISItemSortedView::BeginDestroy()
+{
+	if (UEISItemContainer* OwnerContainer = Container.Get())
+	{
+		OwnerContainer->OnContainerChangeDelegate.Remove(ContainerChangeHandle);
+	}
+
+	for (const FEISItemSortEntry& Entry : Entries)
+	{
+		if (Entry.Item)
+		{
+			Entry.Item->OnAmountChangeDelegate.RemoveAll(this);
+		}
+	}
+
+	Super::BeginDestroy();
+}
+
+void UEISItemSortedView::Initialize(UEISItemContainer* InContainer, EEISItemSortKey InSortKey, bool bInDescending)
+{
+	check(InContainer);
+
+	Container = InContainer;
+	SortKey = InSortKey;
+	bDescending = bInDescending;
+	ContainerChangeHandle = InContainer->OnContainerChangeDelegate.AddUObject(this, &ThisClass::OnContainerChange);
+
+	for (UEISItemInstance* Item : InContainer->GetItems())
+	{
+		if (Item)
+		{
+			TrackItem(Item);
+		}
+	}
+
+	Rebuild();
+}
+
+void UEISItemSortedView::SetSortKey(EEISItemSortKey InSortKey, bool bInDescending)
+{
+	if (SortKey == InSortKey && bDescending == bInDescending)
+	{
+		return;
+	}
+
+	SortKey = InSortKey;
+	bDescending = bInDescending;
+	Rebuild();
+
+	OnViewResetDelegate.Broadcast();
+	OnViewReset.Broadcast();
+}
+
+int UEISItemSortedView::IndexOf(const UEISItemInstance* Item) const
+{
+	const FEISItemSortEntry* SortedEntry = SortedEntries.Find(Item);
+	return SortedEntry ? FindEntry(*SortedEntry) : INDEX_NONE;
+}
+
+TArray<UEISItemInstance*> UEISItemSortedView::GetItems() const
+{
+	TArray<UEISItemInstance*> Items;
+	Items.Reserve(Entries.Num());
+
+	for (const FEISItemSortEntry& Entry : Entries)
+	{
+		Items.Add(Entry.Item);
+	}
+	return Items;
+}
+
+void UEISItemSortedView::Rebuild()
+{
+	Entries.Reset(SortedEntries.Num());
+	for (TPair<const UEISItemInstance*, FEISItemSortEntry>& Pair : SortedEntries)
+	{
+		Pair.Value = FEISItemSortEntry::Make(const_cast<UEISItemInstance*>(Pair.Key));
+		Entries.Add(Pair.Value);
+	}
+
+	Entries.Sort([this](const FEISItemSortEntry& A, const FEISItemSortEntry& B)
+	{
+		return IsLess(A, B);
+	});
+}
+
+int32 UEISItemSortedView::FindEntry(const FEISItemSortEntry& Entry) const
+{
+	const int32 FirstIndex = Algo::LowerBound(Entries, Entry, [this](const FEISItemSortEntry& A, const FEISItemSortEntry& B)
+	{
+		return IsLess(A, B);
+	});
+
+	// Item ids are not unique, so entries equal in every key are scanned for the item itself.
+	for (int32 Index = FirstIndex; Index < Entries.Num() && !IsLess(Entry, Entries[Index]); Index++)
+	{
+		if (Entries[Index].Item == Entry.Item)
+		{
+			return Index;
+		}
+	}
+	return INDEX_NONE;
+}
+
+int32 UEISItemSortedView::InsertEntry(const FEISItemSortEntry& Entry)
+{
+	const int32 Index = Algo::LowerBound(Entries, Entry, [this](const FEISItemSortEntry& A, const FEISItemSortEntry& B)
+	{
+		return IsLess(A, B);
+	});
+	Entries.Insert(Entry, Index);
+	return Index;
+}
+
+void UEISItemSortedView::TrackItem(UEISItemInstance* Item)
+{
+	SortedEntries.Add(Item, FEISItemSortEntry::Make(Item));
+	Item->OnAmountChangeDelegate.AddUObject(this, &ThisClass::OnItemAmountChange, Item);
+}
+
+void UEISItemSortedView::UntrackItem(UEISItemInstance* Item)
+{
+	SortedEntries.Remove(Item);
+	Item->OnAmountChangeDelegate.RemoveAll(this);
+}
+
+void UEISItemSortedView::OnContainerChange(const FEISItemContainerChangeData& ChangeData)
+{
+	TArray<FEISSortedViewChange> Changes;
+
+	for (UEISItemInstance* Item : ChangeData.RemovedItems)
+	{
+		const int32 Index = IndexOf(Item);
+		if (Index != INDEX_NONE)
+		{
+			Entries.RemoveAt(Index);
+			UntrackItem(Item);
+			Changes.Emplace(Item, Index, INDEX_NONE);
+		}
+	}
+
+	for (UEISItemInstance* Item : ChangeData.AddedItems)
+	{
+		if (Item && !SortedEntries.Contains(Item))
+		{
+			TrackItem(Item);
+			Changes.Emplace(Item, INDEX_NONE, InsertEntry(SortedEntries[Item]));
+		}
+	}
+
+	BroadcastViewChange(Changes);
+}
+
+void UEISItemSortedView::OnItemAmountChange(int NewAmount, int PrevAmount, UEISItemInstance* Item)
+{
+	// Only the amount key moves items; under the other keys the cached entry keeps the position it was sorted at.
+	FEISItemSortEntry* SortedEntry = SortedEntries.Find(Item);
+	if (!SortedEntry || SortKey != EEISItemSortKey::Amount)
+	{
+		return;
+	}
+
+	const int32 FromIndex = FindEntry(*SortedEntry);
+	if (FromIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	Entries.RemoveAt(FromIndex);
+	SortedEntry->Amount = NewAmount;
+
+	const int32 ToIndex = InsertEntry(*SortedEntry);
+	if (ToIndex != FromIndex)
+	{
+		BroadcastViewChange({FEISSortedViewChange(Item, FromIndex, ToIndex)});
+	}
+}
+
+void UEISItemSortedView::BroadcastViewChange(const TArray<FEISSortedViewChange>& Changes)
+{
+	if (Changes.IsEmpty())
+	{
+		return;
+	}
+
+	OnViewChangeDelegate.Broadcast(Changes);
+	OnViewChange.Broadcast(Changes);
+}
@@ -0,0 +1,250 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EISItemDefinitionRegistry.h"
+#include "EISItemInstance.h"
+#include "EnhancedInventorySystem.h"
+#include "Engine/AssetManager.h"
+#include "Engine/Engine.h"
+
+static UEISItemDefinitionRegistry* RegistryInstance = nullptr;
+
+FEISItemDefinitionHotData FEISItemDefinitionHotData::FromDefinition(const UEISItemDefinition* Definition)
+{
+	FEISItemDefinitionHotData Data;
+	if (!Definition)
+	{
+		return Data;
+	}
+
+	Data.TagMask = MakeTagMask(Definition->Tags.GetGameplayTagParents());
+	Data.NameHash = GetTypeHash(Definition->ScriptName.ToString());
+	Data.StackAmount = Definition->StackAmount;
+	Data.Weight = Definition->Weight;
+	Data.Volume = Definition->Volume;
+	Data.Flags = Valid;
+
+	if (Definition->bStackable)
+	{
+		Data.StackLimit = Definition->bHasStackMaximum ? Definition->StackMaximum : MAX_int32;
+		Data.Flags |= Stackable;
+
+		if (Definition->bCommodity)
+		{
+			Data.Flags |= Commodity;
+		}
+	}
+	return Data;
+}
+
+uint64 FEISItemDefinitionHotData::MakeTagMask(const FGameplayTagContainer& Tags)
+{
+	uint64 Mask = 0;
+	for (const FGameplayTag& Tag : Tags)
+	{
+		Mask |= 1ull << (GetTypeHash(Tag) % 64);
+	}
+	return Mask;
+}
+
+bool FEISItemDefinitionRef::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	UEISItemDefinitionRegistry* Registry = UEISItemDefinitionRegistry::Get();
+
+	uint16 Index = UEISItemDefinitionRegistry::InvalidIndex;
+	if (Ar.IsSaving() && Registry && Definition)
+	{
+		Index = Registry->FindAssetIndex(Definition);
+	}
+
+	Ar << Index;
+
+	if (Index == UEISItemDefinitionRegistry::InvalidIndex)
+	{
+		UObject* DefinitionObject = Definition;
+		bOutSuccess = Map->SerializeObject(Ar, UEISItemDefinition::StaticClass(), DefinitionObject);
+		Definition = Cast<UEISItemDefinition>(DefinitionObject);
+		return true;
+	}
+
+	if (Ar.IsLoading())
+	{
+		Definition = Registry ? Registry->LoadDefinition(Index) : nullptr;
+	}
+
+	bOutSuccess = true;
+	return true;
+}
+
+UEISItemDefinitionRegistry* UEISItemDefinitionRegistry::Get()
+{
+	return RegistryInstance;
+}
+
+void UEISItemDefinitionRegistry::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	RegistryInstance = this;
+
+	UAssetManager::CallOrRegister_OnCompletedInitialScan(
+		FSimpleMulticastDelegate::FDelegate::CreateUObject(this, &ThisClass::BuildRegistry));
+}
+
+void UEISItemDefinitionRegistry::Deinitialize()
+{
+	if (RegistryInstance == this)
+	{
+		RegistryInstance = nullptr;
+	}
+
+	Super::Deinitialize();
+}
+
+uint16 UEISItemDefinitionRegistry::FindIndex(const UEISItemDefinition* Definition) const
+{
+	if (!Definition)
+	{
+		return InvalidIndex;
+	}
+
+	const uint16 Index = FindAssetIndex(Definition);
+	if (Index != InvalidIndex)
+	{
+		return Index;
+	}
+
+	const uint16* RuntimeIndex = RuntimeDefinitionToIndex.Find(Definition);
+	return RuntimeIndex ? *RuntimeIndex : InvalidIndex;
+}
+
+uint16 UEISItemDefinitionRegistry::FindAssetIndex(const UEISItemDefinition* Definition) const
+{
+	const uint16* Index = Definition ? AssetNameToIndex.Find(Definition->GetFName()) : nullptr;
+	return Index ? *Index : InvalidIndex;
+}
+
+uint16 UEISItemDefinitionRegistry::FindIndexByName(FName ScriptName) const
+{
+	const uint16* Index = ScriptNameToIndex.Find(ScriptName);
+	return Index ? *Index : InvalidIndex;
+}
+
+uint16 UEISItemDefinitionRegistry::FindOrRegisterIndex(const UEISItemDefinition* Definition)
+{
+	if (!bBuilt || !Definition)
+	{
+		return InvalidIndex;
+	}
+
+	uint16 Index = FindIndex(Definition);
+	if (Index == InvalidIndex && Definitions.Num() < InvalidIndex)
+	{
+		Index = static_cast<uint16>(Definitions.Add(
+			TSoftObjectPtr<UEISItemDefinition>(const_cast<UEISItemDefinition*>(Definition))));
+		RuntimeDefinitionToIndex.Add(Definition, Index);
+	}
+
+	if (Index != InvalidIndex)
+	{
+		ScriptNameToIndex.FindOrAdd(Definition->ScriptName, Index);
+
+		if (!HotData.IsValidIndex(Index))
+		{
+			HotData.SetNum(Definitions.Num());
+		}
+		
+		if (!HotData[Index].IsValid())
+		{
+			HotData[Index] = FEISItemDefinitionHotData::FromDefinition(Definition);
+		}
+	}
+	return Index;
+}
+
+void UEISItemDefinitionRegistry::RefreshHotData(const UEISItemDefinition* Definition)
+{
+	const uint16 Index = FindIndex(Definition);
+	if (HotData.IsValidIndex(Index))
+	{
+		HotData[Index] = FEISItemDefinitionHotData::FromDefinition(Definition);
+	}
+
+	ExpandedTags.Remove(Definition);
+}
+
+const FGameplayTagContainer& UEISItemDefinitionRegistry::GetExpandedTags(const UEISItemDefinition* Definition)
+{
+	check(Definition);
+
+	if (const FGameplayTagContainer* Tags = ExpandedTags.Find(Definition))
+	{
+		return *Tags;
+	}
+	return ExpandedTags.Add(Definition, Definition->Tags.GetGameplayTagParents());
+}
+
+UEISItemDefinition* UEISItemDefinitionRegistry::GetDefinition(uint16 Index) const
+{
+	return Definitions.IsValidIndex(Index) ? Definitions[Index].Get() : nullptr;
+}
+
+UEISItemDefinition* UEISItemDefinitionRegistry::LoadDefinition(uint16 Index) const
+{
+	return Definitions.IsValidIndex(Index) ? Definitions[Index].LoadSynchronous() : nullptr;
+}
+
+UEISItemDefinition* UEISItemDefinitionRegistry::FindDefinitionByName(FName ScriptName) const
+{
+	return LoadDefinition(FindIndexByName(ScriptName));
+}
+
+void UEISItemDefinitionRegistry::BuildRegistry()
+{
+	UAssetManager& AssetManager = UAssetManager::Get();
+
+	TArray<FPrimaryAssetId> AssetIds;
+	AssetManager.GetPrimaryAssetIdList(FPrimaryAssetType(UEISItemDefinition::StaticClass()->GetFName()), AssetIds);
+
+	AssetIds.Sort([](const FPrimaryAssetId& A, const FPrimaryAssetId& B)
+	{
+		return A.PrimaryAssetName.LexicalLess(B.PrimaryAssetName);
+	});
+
+	if (AssetIds.Num() >= InvalidIndex)
+	{
+		UE_LOG(LogEnhancedInventorySystem, Error, TEXT("Item definition registry holds at most %d definitions, found %d."),
+		       InvalidIndex - 1, AssetIds.Num());
+		AssetIds.SetNum(InvalidIndex - 1);
+	}
+
+	Definitions.Reset(AssetIds.Num());
+	HotData.Reset();
+	AssetNameToIndex.Reset();
+	ScriptNameToIndex.Reset();
+	RuntimeDefinitionToIndex.Reset();
+
+	for (const FPrimaryAssetId& AssetId : AssetIds)
+	{
+		FAssetData AssetData;
+		AssetManager.GetPrimaryAssetData(AssetId, AssetData);
+
+		const uint16 Index = static_cast<uint16>(Definitions.Add(
+			TSoftObjectPtr<UEISItemDefinition>(AssetData.ToSoftObjectPath())));
+		AssetNameToIndex.Add(AssetId.PrimaryAssetName, Index);
+
+		FName ScriptName;
+		if (AssetData.GetTagValue(GET_MEMBER_NAME_CHECKED(UEISItemDefinition, ScriptName), ScriptName))
+		{
+			if (ScriptNameToIndex.Contains(ScriptName))
+			{
+				UE_LOG(LogEnhancedInventorySystem, Warning, TEXT("Item definition %s reuses script name %s."),
+				       *AssetId.ToString(), *ScriptName.ToString());
+				continue;
+			}
+			ScriptNameToIndex.Add(ScriptName, Index);
+		}
+	}
+
+	HotData.SetNum(Definitions.Num());
+	bBuilt = true;
+}
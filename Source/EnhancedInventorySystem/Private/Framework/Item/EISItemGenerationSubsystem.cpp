@@ -0,0 +1,164 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EISItemGenerationSubsystem.h"
+#include "Async/Async.h"
+#include "EISInventoryFunctionLibrary.h"
+#include "EISItemContainer.h"
+
+void UEISItemGenerationSubsystem::Deinitialize()
+{
+	for (const TSharedPtr<FRequest, ESPMode::ThreadSafe>& Request : ReadyRequests)
+	{
+		CompleteRequest(*Request);
+	}
+	ReadyRequests.Reset();
+
+	// Requests still on a worker complete unadded once they reach the game thread.
+	for (const TSharedPtr<FRequest, ESPMode::ThreadSafe>& Request : InFlightRequests)
+	{
+		Request->bCancelled = true;
+	}
+	
+	Super::Deinitialize();
+}
+
+TFuture<int32> UEISItemGenerationSubsystem::RequestItems(UEISItemContainer* Container,
+                                                         TArray<FEISItemGenerationEntry> Entries)
+{
+	TSharedPtr<FRequest, ESPMode::ThreadSafe> Request = MakeShared<FRequest, ESPMode::ThreadSafe>();
+	Request->Container = Container;
+	Request->Entries = MoveTemp(Entries);
+	
+	TFuture<int32> Future = Request->Promise.GetFuture();
+
+	// Stack limits go through the definition registry, which is only read on the game thread.
+	Request->StackLimits.Reserve(Request->Entries.Num());
+	for (const FEISItemGenerationEntry& Entry : Request->Entries)
+	{
+		const UEISItemInstance* ItemCDO = Entry.ItemClass ? Entry.ItemClass.GetDefaultObject() : nullptr;
+		Request->StackLimits.Add(ItemCDO ? FMath::Max(ItemCDO->GetStackLimit(), 1) : 0);
+	}
+
+	InFlightRequests.Add(Request);
+
+	TWeakObjectPtr<UEISItemGenerationSubsystem> WeakThis(this);
+	Async(EAsyncExecution::TaskGraph, [Request, WeakThis]()
+	{
+		for (int32 i = 0; i < Request->Entries.Num(); i++)
+		{
+			const FEISItemGenerationEntry& Entry = Request->Entries[i];
+			const int32 StackLimit = Request->StackLimits[i];
+			
+			if (StackLimit == 0)
+			{
+				Request->RemainingAmount += FMath::Max(Entry.Amount, 0);
+				continue;
+			}
+
+			for (int32 Amount = Entry.Amount; Amount > 0; Amount -= StackLimit)
+			{
+				FPendingItem& Item = Request->Items.AddDefaulted_GetRef();
+				Item.ItemClass = Entry.ItemClass;
+				Item.ItemData.ItemId = UEISInventoryFunctionLibrary::GenerateItemId();
+				Item.ItemData.Amount = FMath::Min(Amount, StackLimit);
+			}
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [Request, WeakThis]()
+		{
+			UEISItemGenerationSubsystem* This = WeakThis.Get();
+			if (This && !Request->bCancelled)
+			{
+				This->InFlightRequests.Remove(Request);
+				This->ReadyRequests.Add(Request);
+			}
+			else if (This)
+			{
+				This->InFlightRequests.Remove(Request);
+				This->CompleteRequest(*Request);
+			}
+			else
+			{
+				Request->Promise.SetValue(Request->RemainingAmount);
+			}
+		});
+	});
+	
+	return Future;
+}
+
+void UEISItemGenerationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	
+	int32 Budget = MaxItemsPerFrame;
+	int32 CompletedRequests = 0;
+	
+	for (; CompletedRequests < ReadyRequests.Num() && Budget > 0; CompletedRequests++)
+	{
+		FRequest& Request = *ReadyRequests[CompletedRequests];
+		UEISItemContainer* Container = Request.Container.Get();
+		
+		if (Container && !Request.bCancelled)
+		{
+			FEISItemContainerChangeBatch ChangeBatch(Container);
+			
+			for (; Request.NextItem < Request.Items.Num() && Budget > 0; Request.NextItem++, Budget--)
+			{
+				const FPendingItem& PendingItem = Request.Items[Request.NextItem];
+				const UEISItemInstance* ItemCDO = PendingItem.ItemClass.GetDefaultObject();
+				
+				// The pending amount may differ from the default one, so only the generated item tells whether it fits.
+				UEISItemInstance* Item = Container->GetMaxAddableAmount(ItemCDO) > 0
+					                         ? UEISInventoryFunctionLibrary::GenerateItemWithData(
+						                         GetWorld(), ItemCDO, PendingItem.ItemData)
+					                         : nullptr;
+				if (!Item)
+				{
+					Request.RemainingAmount += PendingItem.ItemData.Amount;
+				}
+				else if (!UEISInventoryFunctionLibrary::Container_AddItem(Container, Item))
+				{
+					Request.RemainingAmount += Item->GetAmount();
+				}
+			}
+			
+			if (Request.NextItem < Request.Items.Num())
+			{
+				break;
+			}
+		}
+		
+		CompleteRequest(Request);
+	}
+
+	ReadyRequests.RemoveAt(0, CompletedRequests);
+}
+
+void UEISItemGenerationSubsystem::CancelRequests(const UEISItemContainer* Container)
+{
+	// Ready requests are only flagged, so a cancel from within Tick does not pull requests out from under it.
+	for (const TSharedPtr<FRequest, ESPMode::ThreadSafe>& Request : InFlightRequests)
+	{
+		Request->bCancelled |= Request->Container.Get() == Container;
+	}
+
+	for (const TSharedPtr<FRequest, ESPMode::ThreadSafe>& Request : ReadyRequests)
+	{
+		Request->bCancelled |= Request->Container.Get() == Container;
+	}
+}
+
+TStatId UEISItemGenerationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UEISItemGenerationSubsystem, STATGROUP_Tickables);
+}
+
+void UEISItemGenerationSubsystem::CompleteRequest(FRequest& Request)
+{
+	for (; Request.NextItem < Request.Items.Num(); Request.NextItem++)
+	{
+		Request.RemainingAmount += Request.Items[Request.NextItem].ItemData.Amount;
+	}
+	Request.Promise.SetValue(Request.RemainingAmount);
+}
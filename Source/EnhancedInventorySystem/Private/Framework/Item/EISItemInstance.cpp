@@ -1,8 +1,24 @@
 ﻿// Fill out your copyright notice in the Description page of Project Settings.
 
 #include "EISItemInstance.h"
+#include "EISChildContainerComponent.h"
+#include "EISItemContainer.h"
+#include "Engine/ActorChannel.h"
+#include "Engine/World.h"
 #include "Net/UnrealNetwork.h"
 
+#if WITH_EDITOR
+void UEISItemDefinition::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	if (UEISItemDefinitionRegistry* Registry = UEISItemDefinitionRegistry::Get())
+	{
+		Registry->RefreshHotData(this);
+	}
+}
+#endif
+
 UEISItemInstance* UEISItemInstanceComponent::GetOwner() const
 {
 	return GetTypedOuter<UEISItemInstance>();
@@ -12,16 +28,49 @@ UEISItemInstance::UEISItemInstance(const FObjectInitializer& ObjectInitializer)
 {
 }
 
+void UEISItemInstance::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	FallbackHotData = FEISItemDefinitionHotData::FromDefinition(ItemDefinition);
+}
+
+void UEISItemInstance::PostLoad()
+{
+	Super::PostLoad();
+
+	// Blueprint defaults are only serialized in after PostInitProperties.
+	FallbackHotData = FEISItemDefinitionHotData::FromDefinition(ItemDefinition);
+}
+
+void UEISItemInstance::BeginDestroy()
+{
+	if (UEISItemRegistrySubsystem* Registry = ItemRegistry.Get())
+	{
+		Registry->UnregisterItem(ItemHandle);
+	}
+
+	Super::BeginDestroy();
+}
+
 void UEISItemInstance::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	UObject::GetLifetimeReplicatedProps(OutLifetimeProps);
 
 	DOREPLIFETIME(ThisClass, ItemInstanceData);
+	DOREPLIFETIME_CONDITION(ThisClass, ItemHandle, COND_InitialOnly);
+	DOREPLIFETIME(ThisClass, ChildContainer);
 }
 
 bool UEISItemInstance::ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags)
 {
 	bool bReplicateSomething = false;
+	if (ChildContainer)
+	{
+		bReplicateSomething |= Channel->ReplicateSubobject(ChildContainer, *Bunch, *RepFlags);
+		bReplicateSomething |= ChildContainer->ReplicateSubobjects(Channel, Bunch, RepFlags);
+	}
+	
 	return bReplicateSomething;
 }
 
@@ -30,6 +79,30 @@ const UEISItemDefinition* UEISItemInstance::GetDefinition() const
 	return ItemDefinition.Get();
 }
 
+uint16 UEISItemInstance::GetDefinitionIndex() const
+{
+	if (DefinitionIndex == UEISItemDefinitionRegistry::InvalidIndex)
+	{
+		if (UEISItemDefinitionRegistry* Registry = UEISItemDefinitionRegistry::Get())
+		{
+			DefinitionIndex = Registry->FindOrRegisterIndex(ItemDefinition);
+		}
+	}
+	return DefinitionIndex;
+}
+
+const FEISItemDefinitionHotData& UEISItemInstance::GetHotData() const
+{
+	if (const UEISItemDefinitionRegistry* Registry = UEISItemDefinitionRegistry::Get())
+	{
+		if (const FEISItemDefinitionHotData* HotData = Registry->GetHotData(GetDefinitionIndex()))
+		{
+			return *HotData;
+		}
+	}
+	return FallbackHotData;
+}
+
 FName UEISItemInstance::GetScriptName() const
 {
 	return ItemDefinition->ScriptName;
@@ -42,13 +115,23 @@ const FGameplayTagContainer& UEISItemInstance::GetTags() const
 
 bool UEISItemInstance::IsStackable() const
 {
-	return (ItemDefinition->bStackable && (ItemDefinition->bHasStackMaximum && ItemDefinition->StackMaximum > ItemInstanceData.
-		Amount)) || ItemDefinition->bStackable;
+	const FEISItemDefinitionHotData& HotData = GetHotData();
+	return HotData.IsStackable() && HotData.StackLimit > ItemInstanceData.Amount;
 }
 
 int UEISItemInstance::GetStackAmount() const
 {
-	return ItemDefinition->StackAmount;
+	return GetHotData().StackAmount;
+}
+
+int UEISItemInstance::GetStackLimit() const
+{
+	return GetHotData().StackLimit;
+}
+
+int UEISItemInstance::GetStackCapacity() const
+{
+	return FMath::Max(GetHotData().StackLimit - ItemInstanceData.Amount, 0);
 }
 
 void UEISItemInstance::SetAmount(int InAmount)
@@ -56,11 +139,7 @@ void UEISItemInstance::SetAmount(int InAmount)
 	int PrevAmount = ItemInstanceData.Amount;
 	int NewAmount = ItemInstanceData.Amount = InAmount;
 	
-	OnAmountChangeDelegate.Broadcast(NewAmount, PrevAmount);
-	OnAmountChange.Broadcast(this, NewAmount, PrevAmount);
-	
-	OnUpdateAmount(NewAmount, PrevAmount);
-	K2_OnUpdateAmount(NewAmount, PrevAmount);
+	BroadcastAmountChange(NewAmount, PrevAmount);
 }
 
 int UEISItemInstance::AddAmount(int InAmount)
@@ -68,11 +147,7 @@ int UEISItemInstance::AddAmount(int InAmount)
 	int PrevAmount = ItemInstanceData.Amount;
 	int NewAmount = ItemInstanceData.Amount += InAmount;
 	
-	OnAmountChangeDelegate.Broadcast(NewAmount, PrevAmount);
-	OnAmountChange.Broadcast(this, NewAmount, PrevAmount);
-	
-	OnUpdateAmount(NewAmount, PrevAmount);
-	K2_OnUpdateAmount(NewAmount, PrevAmount);
+	BroadcastAmountChange(NewAmount, PrevAmount);
 	return NewAmount;
 }
 
@@ -81,11 +156,7 @@ int UEISItemInstance::RemoveAmount(int InAmount)
 	int PrevAmount = ItemInstanceData.Amount;
 	int NewAmount = ItemInstanceData.Amount -= InAmount;
 	
-	OnAmountChangeDelegate.Broadcast(NewAmount, PrevAmount);
-	OnAmountChange.Broadcast(this, NewAmount, PrevAmount);
-	
-	OnUpdateAmount(NewAmount, PrevAmount);
-	K2_OnUpdateAmount(NewAmount, PrevAmount);
+	BroadcastAmountChange(NewAmount, PrevAmount);
 	return NewAmount;
 }
 
@@ -116,6 +187,17 @@ TArray<UEISItemInstanceComponent*> UEISItemInstance::GetComponents() const
 void UEISItemInstance::Initialize(int InItemId, const UEISItemInstance* SourceItem)
 {
 	ItemInstanceData.ItemId = InItemId;
+
+	if (GetDefinition())
+	{
+		const UEISChildContainerComponent* ChildContainerComponent = GetComponentByClass<UEISChildContainerComponent>(
+			UEISChildContainerComponent::StaticClass());
+		if (ChildContainerComponent && ChildContainerComponent->GetContainerClass())
+		{
+			ChildContainer = NewObject<UEISItemContainer>(this, ChildContainerComponent->GetContainerClass());
+			ChildContainer->AddStartingData();
+		}
+	}
 	
 	OnInitialize(SourceItem);
 	K2_OnInitialize(SourceItem);
@@ -163,10 +245,73 @@ bool UEISItemInstance::CanStackItem(const UEISItemInstance* OtherItem) const
 bool UEISItemInstance::IsMatchItem(const UEISItemInstance* OtherItem) const
 {
 	check(OtherItem);
+	
+	const uint16 Index = GetDefinitionIndex();
+	if (Index != UEISItemDefinitionRegistry::InvalidIndex)
+	{
+		return Index == OtherItem->GetDefinitionIndex();
+	}
 	return GetDefinition() == OtherItem->GetDefinition();
 }
 
+void UEISItemInstance::ApplyItemInstanceData(const FEISItemInstanceData& InItemInstanceData)
+{
+	ItemInstanceData.ItemId = InItemInstanceData.ItemId;
+	
+	if (ItemInstanceData.Amount != InItemInstanceData.Amount)
+	{
+		SetAmount(InItemInstanceData.Amount);
+	}
+}
+
+uint32 UEISItemInstance::GetContentsHash() const
+{
+	return MakeContentsHash(ItemInstanceData.ItemId, GetHotData().NameHash, ItemInstanceData.Amount);
+}
+
+uint32 UEISItemInstance::MakeContentsHash(int InItemId, uint32 InNameHash, int InAmount)
+{
+	// The name hash is taken from the script name string, so server and client produce the same value.
+	uint32 Hash = HashCombine(GetTypeHash(InItemId), InNameHash);
+	return HashCombine(Hash, GetTypeHash(InAmount));
+}
+
+void UEISItemInstance::OnRep_ItemInstanceData(const FEISItemInstanceData& PrevItemInstanceData)
+{
+	if (ItemInstanceData.Amount != PrevItemInstanceData.Amount)
+	{
+		BroadcastAmountChange(ItemInstanceData.Amount, PrevItemInstanceData.Amount);
+	}
+}
+
+void UEISItemInstance::OnRep_ItemHandle()
+{
+	if (UEISItemRegistrySubsystem* Registry = UWorld::GetSubsystem<UEISItemRegistrySubsystem>(GetWorld()))
+	{
+		Registry->RegisterReplicatedItem(this, ItemHandle);
+	}
+}
+
+void UEISItemInstance::OnRep_ChildContainer()
+{
+	// The container holding the item may have replicated first and tracked it without its child container.
+	UEISItemContainer* OwnerContainer = Cast<UEISItemContainer>(GetOwner());
+	if (ChildContainer && OwnerContainer && OwnerContainer->Contains(this))
+	{
+		OwnerContainer->AttachChildContainer(ChildContainer);
+	}
+}
+
 void UEISItemInstance::SetOwner(UObject* Owner)
 {
 	OwnerPrivate = Owner;
 }
+
+void UEISItemInstance::BroadcastAmountChange(int NewAmount, int PrevAmount)
+{
+	OnAmountChangeDelegate.Broadcast(NewAmount, PrevAmount);
+	OnAmountChange.Broadcast(this, NewAmount, PrevAmount);
+	
+	OnUpdateAmount(NewAmount, PrevAmount);
+	K2_OnUpdateAmount(NewAmount, PrevAmount);
+}
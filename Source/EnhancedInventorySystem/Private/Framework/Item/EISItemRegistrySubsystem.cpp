@@ -0,0 +1,95 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EISItemRegistrySubsystem.h"
+#include "EISItemInstance.h"
+#include "Engine/World.h"
+
+bool FEISItemHandle::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	// Shifted by one so the invalid index packs into a single byte.
+	uint32 PackedIndex = static_cast<uint32>(Index + 1);
+	Ar.SerializeIntPacked(PackedIndex);
+	Ar.SerializeIntPacked(Generation);
+
+	if (Ar.IsLoading())
+	{
+		Index = static_cast<int32>(PackedIndex) - 1;
+	}
+
+	bOutSuccess = true;
+	return true;
+}
+
+FEISItemHandle UEISItemRegistrySubsystem::RegisterItem(UEISItemInstance* Item)
+{
+	check(Item);
+
+	if (GetWorld()->GetNetMode() == NM_Client)
+	{
+		return FEISItemHandle();
+	}
+
+	const int32 Index = FreeIndices.IsEmpty() ? Slots.AddDefaulted() : FreeIndices.Pop(false);
+	FSlot& Slot = Slots[Index];
+	Slot.Item = Item;
+
+	const FEISItemHandle Handle(Index, Slot.Generation);
+	Item->ItemHandle = Handle;
+	Item->ItemRegistry = this;
+	return Handle;
+}
+
+void UEISItemRegistrySubsystem::RegisterReplicatedItem(UEISItemInstance* Item, const FEISItemHandle& Handle)
+{
+	check(Item);
+
+	if (!Handle.IsValid())
+	{
+		return;
+	}
+
+	if (!Slots.IsValidIndex(Handle.Index))
+	{
+		Slots.SetNum(Handle.Index + 1);
+	}
+
+	FSlot& Slot = Slots[Handle.Index];
+	Slot.Item = Item;
+	Slot.Generation = Handle.Generation;
+	Item->ItemRegistry = this;
+}
+
+void UEISItemRegistrySubsystem::UnregisterItem(const FEISItemHandle& Handle)
+{
+	if (!Handle.IsValid() || !Slots.IsValidIndex(Handle.Index) || Slots[Handle.Index].Generation != Handle.Generation)
+	{
+		return;
+	}
+
+	FSlot& Slot = Slots[Handle.Index];
+	Slot.Item.Reset();
+
+	// Clients mirror the server slots, so only the server recycles them.
+	if (GetWorld()->GetNetMode() != NM_Client)
+	{
+		Slot.Generation++;
+		FreeIndices.Add(Handle.Index);
+	}
+}
+
+UEISItemInstance* UEISItemRegistrySubsystem::ResolveItem(const FEISItemHandle& Handle) const
+{
+	if (!Handle.IsValid() || !Slots.IsValidIndex(Handle.Index))
+	{
+		return nullptr;
+	}
+
+	const FSlot& Slot = Slots[Handle.Index];
+	return Slot.Generation == Handle.Generation ? Slot.Item.Get() : nullptr;
+}
+
+UObject* UEISItemRegistrySubsystem::ResolveOwner(const FEISItemHandle& Handle) const
+{
+	const UEISItemInstance* Item = ResolveItem(Handle);
+	return Item ? Item->GetOwner() : nullptr;
+}
@@ -0,0 +1,73 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EISLootSubsystem.h"
+#include "Async/Async.h"
+#include "EISInventoryFunctionLibrary.h"
+#include "EISItemContainer.h"
+#include "EISLootTable.h"
+
+int UEISLootSubsystem::FillContainer(UEISItemContainer* Container, UEISLootTable* LootTable, int32 Seed,
+                                     int32 NumRolls)
+{
+	if (!Container || !LootTable)
+	{
+		return 0;
+	}
+
+	const TSharedRef<const FEISLootSampler, ESPMode::ThreadSafe> Sampler = LootTable->GetSampler();
+	
+	FRandomStream Stream(Seed);
+	TArray<int32> Amounts;
+	Sampler->Roll(Stream, NumRolls, Amounts);
+	
+	return CommitLoot(Container, *Sampler, Amounts);
+}
+
+void UEISLootSubsystem::FillContainerAsync(UEISItemContainer* Container, UEISLootTable* LootTable, int32 Seed,
+                                           int32 NumRolls, TFunction<void(int32)> OnComplete)
+{
+	if (!Container || !LootTable)
+	{
+		return;
+	}
+
+	TSharedRef<const FEISLootSampler, ESPMode::ThreadSafe> Sampler = LootTable->GetSampler();
+	TWeakObjectPtr<UEISItemContainer> WeakContainer(Container);
+
+	Async(EAsyncExecution::TaskGraph, [Sampler, Seed, NumRolls, WeakContainer, OnComplete = MoveTemp(OnComplete)]() mutable
+	{
+		FRandomStream Stream(Seed);
+		TArray<int32> Amounts;
+		Sampler->Roll(Stream, NumRolls, Amounts);
+
+		auto Commit = [Sampler, Amounts = MoveTemp(Amounts), WeakContainer, OnComplete = MoveTemp(OnComplete)]()
+		{
+			if (UEISItemContainer* Container = WeakContainer.Get())
+			{
+				const int32 RemainingAmount = CommitLoot(Container, *Sampler, Amounts);
+				if (OnComplete)
+				{
+					OnComplete(RemainingAmount);
+				}
+			}
+		};
+		AsyncTask(ENamedThreads::GameThread, MoveTemp(Commit));
+	});
+}
+
+int32 UEISLootSubsystem::CommitLoot(UEISItemContainer* Container, const FEISLootSampler& Sampler,
+                                    const TArray<int32>& Amounts)
+{
+	FEISItemContainerChangeBatch ChangeBatch(Container);
+	
+	int32 RemainingAmount = 0;
+	for (int32 Entry = 0; Entry < Amounts.Num(); Entry++)
+	{
+		if (Amounts[Entry] > 0 && Sampler.ItemClasses[Entry])
+		{
+			RemainingAmount += UEISInventoryFunctionLibrary::Container_InsertItemAmount(
+				Container, Sampler.ItemClasses[Entry], Amounts[Entry]);
+		}
+	}
+	return RemainingAmount;
+}
@@ -0,0 +1,129 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EISLootTable.h"
+#include "EISItemInstance.h"
+
+void FEISLootSampler::Build(const UEISLootTable& LootTable)
+{
+	const int32 NumEntries = LootTable.Entries.Num();
+	
+	ItemClasses.Reset(NumEntries);
+	MinAmounts.Reset(NumEntries);
+	MaxAmounts.Reset(NumEntries);
+	Probabilities.Reset();
+	Aliases.Reset();
+	
+	MinRolls = FMath::Max(LootTable.MinRolls, 0);
+	MaxRolls = FMath::Max(LootTable.MaxRolls, MinRolls);
+
+	double TotalWeight = 0.0;
+	for (const FEISLootEntry& Entry : LootTable.Entries)
+	{
+		ItemClasses.Add(Entry.ItemClass);
+		MinAmounts.Add(FMath::Max(Entry.MinAmount, 1));
+		MaxAmounts.Add(FMath::Max(Entry.MaxAmount, MinAmounts.Last()));
+		TotalWeight += FMath::Max(Entry.Weight, 0.f);
+	}
+
+	if (NumEntries == 0 || TotalWeight <= 0.0)
+	{
+		return;
+	}
+
+	Probabilities.SetNumUninitialized(NumEntries);
+	Aliases.SetNumUninitialized(NumEntries);
+
+	TArray<double> ScaledWeights;
+	TArray<int32> Small;
+	TArray<int32> Large;
+	ScaledWeights.SetNumUninitialized(NumEntries);
+	
+	for (int32 i = 0; i < NumEntries; i++)
+	{
+		ScaledWeights[i] = FMath::Max(LootTable.Entries[i].Weight, 0.f) * NumEntries / TotalWeight;
+		(ScaledWeights[i] < 1.0 ? Small : Large).Add(i);
+	}
+
+	while (!Small.IsEmpty() && !Large.IsEmpty())
+	{
+		const int32 Less = Small.Pop(false);
+		const int32 More = Large.Pop(false);
+		
+		Probabilities[Less] = ScaledWeights[Less];
+		Aliases[Less] = More;
+		
+		ScaledWeights[More] += ScaledWeights[Less] - 1.0;
+		(ScaledWeights[More] < 1.0 ? Small : Large).Add(More);
+	}
+
+	// Whatever is left holds a full column, rounding errors included.
+	for (const int32 i : Large)
+	{
+		Probabilities[i] = 1.f;
+		Aliases[i] = i;
+	}
+	
+	for (const int32 i : Small)
+	{
+		Probabilities[i] = 1.f;
+		Aliases[i] = i;
+	}
+}
+
+int32 FEISLootSampler::SampleEntry(FRandomStream& Stream) const
+{
+	check(IsValid());
+
+	const int32 Column = Stream.RandHelper(Probabilities.Num());
+	return Stream.GetFraction() < Probabilities[Column] ? Column : Aliases[Column];
+}
+
+void FEISLootSampler::Roll(FRandomStream& Stream, int32 NumRolls, TArray<int32>& OutAmounts) const
+{
+	OutAmounts.SetNumZeroed(ItemClasses.Num());
+	
+	if (!IsValid())
+	{
+		return;
+	}
+
+	if (NumRolls <= 0)
+	{
+		NumRolls = Stream.RandRange(MinRolls, MaxRolls);
+	}
+
+	for (int32 i = 0; i < NumRolls; i++)
+	{
+		const int32 Entry = SampleEntry(Stream);
+		OutAmounts[Entry] += Stream.RandRange(MinAmounts[Entry], MaxAmounts[Entry]);
+	}
+}
+
+TSharedRef<const FEISLootSampler, ESPMode::ThreadSafe> UEISLootTable::GetSampler() const
+{
+	check(IsInGameThread());
+	
+	if (!Sampler.IsValid())
+	{
+		TSharedRef<FEISLootSampler, ESPMode::ThreadSafe> NewSampler = MakeShared<FEISLootSampler, ESPMode::ThreadSafe>();
+		NewSampler->Build(*this);
+		Sampler = NewSampler;
+	}
+	return Sampler.ToSharedRef();
+}
+
+void UEISLootTable::PostLoad()
+{
+	Super::PostLoad();
+
+	Sampler.Reset();
+}
+
+#if WITH_EDITOR
+void UEISLootTable::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	Sampler.Reset();
+}
+#endif
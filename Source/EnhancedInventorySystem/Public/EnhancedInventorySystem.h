@@ -5,6 +5,8 @@
 #include "CoreMinimal.h"
 #include "Modules/ModuleManager.h"
 
+ENHANCEDINVENTORYSYSTEM_API DECLARE_LOG_CATEGORY_EXTERN(LogEnhancedInventorySystem, Log, All);
+
 class FEnhancedInventorySystemModule : public IModuleInterface
 {
 public:
@@ -0,0 +1,47 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "EISCraftingRecipe.generated.h"
+
+class UEISItemDefinition;
+class UEISItemInstance;
+
+USTRUCT(BlueprintType)
+struct FEISRecipeIngredient
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Recipe")
+	TObjectPtr<UEISItemDefinition> Definition;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Recipe", meta = (ClampMin = "1"))
+	int Amount = 1;
+};
+
+USTRUCT(BlueprintType)
+struct FEISRecipeOutput
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Recipe")
+	TSubclassOf<UEISItemInstance> ItemClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Recipe", meta = (ClampMin = "1"))
+	int Amount = 1;
+};
+
+UCLASS(DisplayName = "Crafting Recipe")
+class ENHANCEDINVENTORYSYSTEM_API UEISCraftingRecipe : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Recipe")
+	TArray<FEISRecipeIngredient> Ingredients;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Recipe")
+	TArray<FEISRecipeOutput> Outputs;
+};
@@ -0,0 +1,78 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EISCraftingSubsystem.generated.h"
+
+class UEISCraftingRecipe;
+class UEISItemContainer;
+class UEISItemDefinition;
+
+/**
+ * Keeps the set of craftable recipes for every tracked container. Recipes are indexed by ingredient, so a count change
+ * in a container only re-evaluates the recipes that use the changed definition.
+ */
+UCLASS(DisplayName = "Crafting Subsystem")
+class ENHANCEDINVENTORYSYSTEM_API UEISCraftingSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	TMulticastDelegate<void(UEISItemContainer*)> OnCraftableRecipesChangeDelegate;
+	
+	virtual void Deinitialize() override;
+
+	UFUNCTION(BlueprintCallable, Category = "Crafting Subsystem")
+	void RegisterRecipe(UEISCraftingRecipe* Recipe);
+
+	UFUNCTION(BlueprintCallable, Category = "Crafting Subsystem")
+	void TrackContainer(UEISItemContainer* Container);
+
+	UFUNCTION(BlueprintCallable, Category = "Crafting Subsystem")
+	void UntrackContainer(UEISItemContainer* Container);
+
+	UFUNCTION(BlueprintPure, Category = "Crafting Subsystem")
+	bool CanCraftRecipe(const UEISItemContainer* Container, const UEISCraftingRecipe* Recipe, int Times = 1) const;
+
+	UFUNCTION(BlueprintPure, Category = "Crafting Subsystem")
+	bool IsRecipeCraftable(const UEISItemContainer* Container, const UEISCraftingRecipe* Recipe) const;
+
+	UFUNCTION(BlueprintPure, Category = "Crafting Subsystem")
+	TArray<UEISCraftingRecipe*> GetCraftableRecipes(const UEISItemContainer* Container) const;
+
+	/** Whether the container has room for the full outputs, before the ingredients free any. */
+	UFUNCTION(BlueprintPure, Category = "Crafting Subsystem")
+	bool CanStoreRecipeOutputs(const UEISItemContainer* Container, const UEISCraftingRecipe* Recipe, int Times = 1) const;
+
+	/**
+	 * Consumes the ingredients and adds the outputs to the container, sending one container change. Nothing is consumed
+	 * unless the container has room for all outputs.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Crafting Subsystem")
+	bool CraftRecipe(UEISItemContainer* Container, UEISCraftingRecipe* Recipe, int Times = 1);
+
+private:
+	struct FRecipeRequirement
+	{
+		const UEISItemDefinition* Definition;
+		int32 Amount;
+	};
+
+	bool IsRecipeSatisfied(const UEISItemContainer* Container, int32 RecipeIndex, int32 Times) const;
+	bool EvaluateRecipe(const UEISItemContainer* Container, TBitArray<>& Craftable, int32 RecipeIndex) const;
+	void OnItemCountChange(const UEISItemDefinition* Definition, int32 Delta, UEISItemContainer* Container);
+
+	UPROPERTY()
+	TArray<TObjectPtr<UEISCraftingRecipe>> Recipes;
+
+	/** Ingredients of each registered recipe with the amounts of repeated definitions merged. */
+	TArray<TArray<FRecipeRequirement>> RecipeRequirements;
+
+	TMap<TObjectKey<UEISCraftingRecipe>, int32> RecipeIndices;
+
+	TMap<const UEISItemDefinition*, TArray<int32>> IngredientRecipes;
+
+	TMap<TObjectKey<UEISItemContainer>, TBitArray<>> CraftableRecipes;
+};
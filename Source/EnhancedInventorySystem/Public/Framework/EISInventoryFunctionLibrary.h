@@ -3,12 +3,17 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "EISItemContainer.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
+#include <atomic>
 #include "EISInventoryFunctionLibrary.generated.h"
 
 class UEISItemContainer;
+class UEISEquipmentComponent;
 class UEISEquipmentSlot;
+class UEISGridItemContainer;
 class UEISItemInstance;
+struct FEISItemInstanceData;
 
 UCLASS()
 class ENHANCEDINVENTORYSYSTEM_API UEISInventoryFunctionLibrary : public UBlueprintFunctionLibrary
@@ -19,11 +24,23 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Inventory Function Library")
 	static UEISItemInstance* GenerateItem(UWorld* World, const UEISItemInstance* SourceItem);
 
+	static UEISItemInstance* GenerateItemWithData(UWorld* World, const UEISItemInstance* SourceItem,
+	                                              const FEISItemInstanceData& ItemData);
+
+	/** Safe to call from any thread. */
+	static int GenerateItemId();
+
+	/** Makes sure generated ids stay above the given one, e.g. after loading items. Safe to call from any thread. */
+	static void ReserveItemIds(int ItemId);
+
+	UFUNCTION(BlueprintCallable, Category = "Inventory Function Library|Container")
+	static void Container_EnsureStartingData(UEISItemContainer* Container);
+
 	UFUNCTION(BlueprintCallable, Category = "Inventory Function Library|Container")
 	static bool Container_FindAvailablePlace(UEISItemContainer* Container, UEISItemInstance* Item);
 	
 	UFUNCTION(BlueprintCallable, Category = "Inventory Function Library|Container")
-	static void Container_AddItem(UEISItemContainer* Container, UEISItemInstance* Item);
+	static bool Container_AddItem(UEISItemContainer* Container, UEISItemInstance* Item);
 
 	UFUNCTION(BlueprintCallable, Category = "Inventory Function Library|Container")
 	static void Container_RemoveItem(UEISItemContainer* Container, UEISItemInstance* Item);
@@ -34,17 +51,49 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Inventory Function Library|Container")
 	static void Container_SplitItem(UEISItemContainer* Container, UEISItemInstance* Item, int Amount);
 
+	UFUNCTION(BlueprintCallable, Category = "Inventory Function Library|Container")
+	static void Container_ConsolidateStacks(UEISItemContainer* Container);
+
+	UFUNCTION(BlueprintCallable, Category = "Inventory Function Library|Container")
+	static void Container_SortItems(UEISItemContainer* Container, EEISItemSortKey SortKey, bool bDescending = false);
+
+	UFUNCTION(BlueprintCallable, Category = "Inventory Function Library|Container")
+	static int Container_InsertItemAmount(UEISItemContainer* Container, TSubclassOf<UEISItemInstance> ItemClass,
+	                                      int Amount);
+
+	UFUNCTION(BlueprintCallable, Category = "Inventory Function Library|Container")
+	static int Container_ConsumeItemAmount(UEISItemContainer* Container, const UEISItemDefinition* Definition,
+	                                       int Amount);
+
+	UFUNCTION(BlueprintCallable, Category = "Inventory Function Library|Container")
+	static UEISItemInstance* Container_MaterializeCommodity(UEISItemContainer* Container,
+	                                                        TSubclassOf<UEISItemInstance> ItemClass, int Amount);
+
+	UFUNCTION(BlueprintCallable, Category = "Inventory Function Library|Container")
+	static bool Container_MoveGridItem(UEISGridItemContainer* Container, UEISItemInstance* Item, FIntPoint Position,
+	                                   bool bRotated);
+
 	UFUNCTION(BlueprintCallable, Category = "Inventory Function Library|Slot")
 	static void Slot_EquipItem(UEISEquipmentSlot* EquipmentSlot, UEISItemInstance* Item);
 
 	UFUNCTION(BlueprintCallable, Category = "Inventory Function Library|Slot")
 	static void Slot_UnequipItem(UEISEquipmentSlot* EquipmentSlot);
 
+	UFUNCTION(BlueprintCallable, Category = "Inventory Function Library|Slot")
+	static bool Equipment_ApplyLoadout(UEISEquipmentComponent* EquipmentComponent, FName LoadoutName,
+	                                   UEISItemContainer* Container);
+
 	UFUNCTION(BlueprintCallable, Category = "Inventory Function Library|Container")
 	static void MoveItemFromContainerToContainer(UEISItemContainer* SourceContainer,
 	                                             UEISItemContainer* TargetContainer, UEISItemInstance* Item,
 	                                             bool bFullStack = false);
 
+	UFUNCTION(BlueprintCallable, Category = "Inventory Function Library|Container")
+	static bool MoveAllItemsFromContainerToContainer(UEISItemContainer* SourceContainer,
+	                                                 UEISItemContainer* TargetContainer,
+	                                                 const FGameplayTagContainer& Filter,
+	                                                 TArray<UEISItemInstance*>& OutRemainingItems);
+
 	UFUNCTION(BlueprintCallable, Category = "Inventory Function Library|Container")
 	static void MoveItemFromContainerToSlot(UEISItemContainer* SourceContainer,
 	                                        UEISEquipmentSlot* TargetSlot, UEISItemInstance* Item);
@@ -62,5 +111,5 @@ public:
 	static void SubtractOrRemoveItemFromSource(UObject* Source, UEISItemInstance* Item, int Amount);
 	
 private:
-	static int LastItemId;
+	static std::atomic<int> LastItemId;
 };
@@ -4,19 +4,64 @@
 
 #include "CoreMinimal.h"
 #include "Components/GameFrameworkComponent.h"
+#include "EISItemStatsComponent.h"
+#include "GameplayTagContainer.h"
 #include "EISEquipmentComponent.generated.h"
 
+class UEISInventoryFunctionLibrary;
 class UEISEquipmentSlot;
+class UEISItemContainer;
 class UEISItemInstance;
+struct FEISEquipmentSlotChangeData;
+
+USTRUCT(BlueprintType)
+struct FEISEquipmentLoadoutEntry
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FString SlotName;
+
+	/** Item equipped at the slot, 0 keeps the slot empty. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int ItemId = 0;
+};
+
+USTRUCT(BlueprintType)
+struct FEISEquipmentLoadout
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FName LoadoutName;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TArray<FEISEquipmentLoadoutEntry> Entries;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnLoadoutAppliedSignature, FName, LoadoutName);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnStatTotalsChangeSignature);
 
 UCLASS(DisplayName = "Equipment Component", Abstract)
 class ENHANCEDINVENTORYSYSTEM_API UEISEquipmentComponent : public UGameFrameworkComponent
 {
 	GENERATED_BODY()
 
+	friend UEISInventoryFunctionLibrary;
+
 public:
 	UEISEquipmentComponent(const FObjectInitializer& ObjectInitializer);
 
+	TMulticastDelegate<void(FName)> OnLoadoutAppliedDelegate;
+
+	UPROPERTY(BlueprintAssignable)
+	FOnLoadoutAppliedSignature OnLoadoutApplied;
+
+	TMulticastDelegate<void()> OnStatTotalsChangeDelegate;
+
+	UPROPERTY(BlueprintAssignable)
+	FOnStatTotalsChangeSignature OnStatTotalsChange;
+
 	UFUNCTION(BlueprintCallable, Category = "Equipment Component")
 	void AddEquipmentSlot(UEISEquipmentSlot* NewEquipmentSlot);
 	
@@ -40,10 +85,55 @@ public:
 	
 	UFUNCTION(BlueprintPure, Category = "Equipment Component")
 	TArray<UEISEquipmentSlot*> GetEquipmentSlots() const { return EquipmentSlots; }
+
+	/** Records the items currently equipped at every slot under the loadout name, replacing an older record. */
+	UFUNCTION(BlueprintCallable, Category = "Equipment Component|Loadout")
+	void SaveLoadout(FName LoadoutName);
+
+	UFUNCTION(BlueprintCallable, Category = "Equipment Component|Loadout")
+	void RemoveLoadout(FName LoadoutName);
+
+	UFUNCTION(BlueprintPure, Category = "Equipment Component|Loadout")
+	bool HasLoadout(FName LoadoutName) const { return FindLoadout(LoadoutName) != nullptr; }
+
+	const FEISEquipmentLoadout* FindLoadout(FName LoadoutName) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Equipment Component|Loadout")
+	bool ApplyLoadout(FName LoadoutName, UEISItemContainer* Container);
+
+	/** Sum of the stat over the stats components of all equipped items. */
+	UFUNCTION(BlueprintPure, Category = "Equipment Component|Stats")
+	float GetStatTotal(FGameplayTag StatTag) const
+	{
+		const float* StatTotal = StatTotals.Find(StatTag);
+		return StatTotal ? *StatTotal : 0.f;
+	}
+
+	UFUNCTION(BlueprintPure, Category = "Equipment Component|Stats")
+	const TMap<FGameplayTag, float>& GetStatTotals() const { return StatTotals; }
 	
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Takes loadout items from other slots or the container and returns displaced items to the container. Nothing
+	 * changes unless every slot of the loadout can be satisfied. */
+	bool ApplyLoadoutInternal(FName LoadoutName, UEISItemContainer* Container);
 	
 	UPROPERTY(EditAnywhere, Instanced, Category = "Equipment Component")
 	TArray<UEISEquipmentSlot*> EquipmentSlots;
+
+	UPROPERTY(EditAnywhere, Category = "Equipment Component|Loadout")
+	TArray<FEISEquipmentLoadout> Loadouts;
+
+private:
+	void BindEquipmentSlot(UEISEquipmentSlot* EquipmentSlot);
+	void UnbindEquipmentSlot(UEISEquipmentSlot* EquipmentSlot);
+	void OnEquipmentSlotChange(const FEISEquipmentSlotChangeData& ChangeData, UEISEquipmentSlot* EquipmentSlot);
+	bool UpdateSlotStats(UEISEquipmentSlot* EquipmentSlot);
+	
+	TMap<FGameplayTag, float> StatTotals;
+
+	/** Stats each slot currently adds to the totals, kept so they can be taken back when the slot changes. */
+	TMap<TObjectKey<UEISEquipmentSlot>, TArray<FEISItemStatModifier>> SlotStats;
 };
@@ -79,8 +79,17 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Equipment Slot")
 	UEISItemInstance* GetItemInstance() const { return ItemInstance; }
 
+	virtual uint32 GetContentsChecksum() const override;
+
+	virtual TArray<UEISItemInstance*> GetRepositoryItems() const override;
+
+	virtual FEISRepositorySnapshotPtr GetContentsSnapshot() const override { return SnapshotSource.Get(); }
+
 protected:
 	virtual void CallRemoveItem(UEISItemInstance* Item) override;
+
+	virtual void CallResyncItems(const TArray<UEISItemInstance*>& InItems,
+	                             const TArray<FEISItemInstanceData>& InItemsData) override;
 	
 	UFUNCTION(BlueprintCallable, Category = "Equipment Slot")
 	void EquipSlot(UEISItemInstance* InItemInstance);
@@ -92,6 +101,9 @@ protected:
 	void SetAvailability(bool bInAvailability);
 
 private:
+	void PublishSnapshot();
+	void OnItemAmountChange(int NewAmount, int PrevAmount);
+
 	UPROPERTY(EditAnywhere, Category = "Equipment Slot")
 	FString SlotName = "Default";
 	
@@ -109,4 +121,8 @@ private:
 
 	UFUNCTION()
 	void OnRep_Availability();
+
+	uint32 SnapshotVersion = 0;
+
+	FEISRepositorySnapshotSource SnapshotSource;
 };
@@ -0,0 +1,149 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EISItemContainer.h"
+#include "EISGridItemContainer.generated.h"
+
+/** Area an item covers in a grid container. Size is the footprint after rotation. */
+USTRUCT(BlueprintType)
+struct ENHANCEDINVENTORYSYSTEM_API FEISGridPlacement
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Grid Placement")
+	int32 ItemId = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Grid Placement")
+	FIntPoint Position = FIntPoint::ZeroValue;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Grid Placement")
+	FIntPoint Size = FIntPoint(1, 1);
+
+	UPROPERTY(BlueprintReadOnly, Category = "Grid Placement")
+	bool bRotated = false;
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template <>
+struct TStructOpsTypeTraits<FEISGridPlacement> : TStructOpsTypeTraitsBase2<FEISGridPlacement>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnGridLayoutChangeSignature);
+
+/**
+ * Container that lays its items out on a grid, each covering the GridSize of its definition. Occupancy is kept as one
+ * 64-bit mask per row, so testing an area is one AND per row and the first fit search shifts masks instead of
+ * visiting cells. Placements replicate next to the items, keyed by item id.
+ */
+UCLASS(DisplayName = "Grid Item Container", Abstract, EditInlineNew, DefaultToInstanced)
+class ENHANCEDINVENTORYSYSTEM_API UEISGridItemContainer : public UEISItemContainer
+{
+	GENERATED_BODY()
+
+	friend UEISInventoryFunctionLibrary;
+
+public:
+	TMulticastDelegate<void()> OnLayoutChangeDelegate;
+
+	UPROPERTY(BlueprintAssignable)
+	FOnGridLayoutChangeSignature OnLayoutChange;
+
+	virtual void PostInitProperties() override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	UFUNCTION(BlueprintPure, Category = "Item Container|Grid")
+	FIntPoint GetGridSize() const { return FIntPoint(GridWidth, GridHeight); }
+
+	UFUNCTION(BlueprintPure, Category = "Item Container|Grid")
+	static FIntPoint GetItemFootprint(const UEISItemInstance* Item, bool bRotated);
+
+	UFUNCTION(BlueprintPure, Category = "Item Container|Grid")
+	bool FindItemPlacement(const UEISItemInstance* Item, FEISGridPlacement& OutPlacement) const;
+
+	UFUNCTION(BlueprintPure, Category = "Item Container|Grid")
+	UEISItemInstance* GetItemAtCell(FIntPoint Cell) const;
+
+	UFUNCTION(BlueprintPure, Category = "Item Container|Grid")
+	bool IsAreaFree(FIntPoint Position, FIntPoint Size) const;
+
+	/** First free position in row-major order. The rotated footprint is tried when the upright one does not fit. */
+	UFUNCTION(BlueprintPure, Category = "Item Container|Grid")
+	bool FindFirstFit(FIntPoint Size, FIntPoint& OutPosition, bool& bOutRotated) const;
+
+	const TArray<FEISGridPlacement>& GetPlacements() const
+	{
+		EnsureStartingData();
+		return Placements;
+	}
+
+protected:
+	/** Moves an item of this container to another position, rotated or not. Fails when the area is taken. */
+	UFUNCTION(BlueprintCallable, Category = "Item Container|Grid")
+	bool MoveItemTo(UEISItemInstance* Item, FIntPoint Position, bool bRotated);
+
+	virtual void OnItemAdded(UEISItemInstance* Item) override;
+	virtual void OnItemRemoved(UEISItemInstance* Item) override;
+
+	virtual bool CanPlaceItem(const UEISItemInstance* Item) const override;
+
+	/** Places the entries first fit on a scratch occupancy, in order, the way insertion would. */
+	virtual bool CanPlaceItems(TConstArrayView<TPair<const UEISItemInstance*, int32>> ItemEntries) const override;
+
+	/** Copies of the item that first fit placement still finds room for. */
+	virtual int32 GetFreeEntryCount(const UEISItemInstance* Item) const override;
+
+	virtual void SaveLayout(FArchive& Ar) const override;
+	virtual void LoadLayout(FArchive& Ar) override;
+
+private:
+	bool FindFirstFitIn(const TArray<uint64>& Occupancy, FIntPoint Size, FIntPoint& OutPosition,
+	                    bool& bOutRotated) const;
+	bool FindFirstFitUpright(const TArray<uint64>& Occupancy, FIntPoint Size, FIntPoint& OutPosition) const;
+	bool PlaceItem(const UEISItemInstance* Item);
+	void SetAreaOccupied(FIntPoint Position, FIntPoint Size, bool bOccupied);
+
+	/** Finds a first fit for the footprint in the occupancy and marks it taken. */
+	bool OccupyFirstFit(TArray<uint64>& Occupancy, FIntPoint Size) const;
+	void AddPlacement(const FEISGridPlacement& Placement);
+	void RemovePlacement(int32 ItemId);
+	void RebuildOccupancy();
+	void BroadcastLayoutChange();
+
+	/** Clients take placements from replication only, since items may replicate before them. */
+	bool HasLayoutAuthority() const;
+
+	static uint64 MakeRowMask(int32 X, int32 Width)
+	{
+		return (Width >= 64 ? MAX_uint64 : (1ull << Width) - 1) << X;
+	}
+
+	UPROPERTY(EditDefaultsOnly, Category = "Item Container|Grid", meta = (ClampMin = "1", ClampMax = "64"))
+	int32 GridWidth = 10;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Item Container|Grid", meta = (ClampMin = "1"))
+	int32 GridHeight = 10;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Item Container|Grid")
+	bool bAllowRotation = true;
+
+	UPROPERTY(ReplicatedUsing = "OnRep_Placements")
+	TArray<FEISGridPlacement> Placements;
+
+	UFUNCTION()
+	void OnRep_Placements();
+
+	/** One mask per row, bit X set when cell X of the row is taken. */
+	TArray<uint64> RowOccupancy;
+
+	int32 OccupiedCells = 0;
+
+	TMap<int32, int32> PlacementIndices;
+};
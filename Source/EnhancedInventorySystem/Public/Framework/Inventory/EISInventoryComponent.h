@@ -49,4 +49,8 @@ protected:
 	
 	UPROPERTY(EditAnywhere, Instanced, Category = "Inventory Component")
 	TObjectPtr<UEISItemContainer> ItemContainer;
+
+	/** Generates the starting data through the item generation subsystem instead of in BeginPlay. */
+	UPROPERTY(EditAnywhere, Category = "Inventory Component")
+	bool bGenerateStartingDataAsync = false;
 };
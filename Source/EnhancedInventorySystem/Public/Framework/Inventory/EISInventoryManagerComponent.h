@@ -3,15 +3,21 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Async/Future.h"
 #include "Components/ControllerComponent.h"
+#include "EISItemContainer.h"
+#include "EISItemInstance.h"
 #include "Net/Serialization/FastArraySerializer.h"
 #include "EISInventoryManagerComponent.generated.h"
 
 struct FEISAppliedItemContainers;
+class UEISCraftingRecipe;
 class UEISInventoryManagerComponent;
 class UEISItemContainer;
+class UEISEquipmentComponent;
 class UEISEquipmentSlot;
 class UEISItemInstance;
+struct FEISEquipmentSlotChangeData;
 
 USTRUCT()
 struct FEISAppliedItemContainerEntry : public FFastArraySerializerItem
@@ -22,6 +28,10 @@ struct FEISAppliedItemContainerEntry : public FFastArraySerializerItem
 	{
 	}
 
+	void PreReplicatedRemove(const FEISAppliedItemContainers& InArraySerializer);
+	void PostReplicatedAdd(const FEISAppliedItemContainers& InArraySerializer);
+	void PostReplicatedChange(const FEISAppliedItemContainers& InArraySerializer);
+
 private:
 	friend UEISInventoryManagerComponent;
 	friend FEISAppliedItemContainers;
@@ -54,6 +64,7 @@ struct FEISAppliedItemContainers : public FFastArraySerializer
 
 private:
 	friend UEISInventoryManagerComponent;
+	friend FEISAppliedItemContainerEntry;
 	
 	UPROPERTY()
 	TArray<FEISAppliedItemContainerEntry> Entries;
@@ -62,6 +73,17 @@ private:
 	UEISInventoryManagerComponent* InventoryManagerComponent = nullptr;
 };
 
+UENUM(BlueprintType)
+enum class EEISInventoryOperationResult : uint8
+{
+	Succeeded,
+	Rejected,
+	Cancelled
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnInventoryOperationCompleteSignature, int32, RequestId,
+                                             EEISInventoryOperationResult, Result);
+
 UCLASS(DisplayName = "Inventory Manager Component", Abstract)
 class ENHANCEDINVENTORYSYSTEM_API UEISInventoryManagerComponent : public UControllerComponent
 {
@@ -70,6 +92,14 @@ class ENHANCEDINVENTORYSYSTEM_API UEISInventoryManagerComponent : public UContro
 public:
 	UEISInventoryManagerComponent(const FObjectInitializer& ObjectInitializer);
 
+	TMulticastDelegate<void(int32, EEISInventoryOperationResult)> OnOperationCompleteDelegate;
+
+	UPROPERTY(BlueprintAssignable)
+	FOnInventoryOperationCompleteSignature OnOperationComplete;
+
+	/** Broadcast after a container or slot was added to or removed from replication. */
+	TMulticastDelegate<void()> OnRepositoriesChangeDelegate;
+
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 	virtual bool ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags) override;
 
@@ -97,27 +127,83 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Inventory Manager")
 	void RemoveReplicatedSlot(UEISEquipmentSlot* EquipmentSlot);
 
+	UFUNCTION(BlueprintPure, Category = "Inventory Manager")
+	TArray<UEISItemContainer*> GetReplicatedContainers() const;
+
+	UFUNCTION(BlueprintPure, Category = "Inventory Manager")
+	const TArray<UEISEquipmentSlot*>& GetReplicatedSlots() const { return ReplicatedSlots; }
+
+	/** Total amount of the definition over all replicated containers and slots, nested containers included. */
+	UFUNCTION(BlueprintPure, Category = "Inventory Manager|Count")
+	int GetItemCount(const UEISItemDefinition* Definition) const { return ItemCounts.GetDefinitionCount(Definition); }
+
+	UFUNCTION(BlueprintPure, Category = "Inventory Manager|Count")
+	int GetTagItemCount(FGameplayTag Tag) const { return ItemCounts.GetTagCount(Tag); }
+
+	/** Items of the definition anywhere in the replicated containers, equipped items and their nested containers. */
+	UFUNCTION(BlueprintPure, Category = "Inventory Manager|Count")
+	TArray<UEISItemInstance*> FindItemsAnywhere(const UEISItemDefinition* Definition) const;
+
+	/** Writes the replicated containers and slots in the binary inventory format. */
+	UFUNCTION(BlueprintCallable, Category = "Inventory Manager|Save")
+	void SaveInventory(TArray<uint8>& OutData) const;
+
+	/** Replaces the contents of the replicated containers and slots with saved data, matching containers by order and
+	 * slots by name. Nothing changes unless all of the data reads cleanly. Server only. */
+	UFUNCTION(BlueprintCallable, Category = "Inventory Manager|Save")
+	bool LoadInventory(const TArray<uint8>& Data);
+
 	virtual void BeginPlay() override;
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
+	/** Every operation below returns a request id; the future completes once the server applied or rejected it. A
+	 * pending operation hands out any number of futures, a completed one only while it is among the recent ones. */
+	TFuture<EEISInventoryOperationResult> GetOperationFuture(int32 RequestId);
+
+	UFUNCTION(BlueprintPure, Category = "Inventory Manager|Operation")
+	bool IsOperationPending(int32 RequestId) const { return PendingOperations.Contains(RequestId); }
+
+	UFUNCTION(BlueprintPure, Category = "Inventory Manager|Operation")
+	bool FindOperationResult(int32 RequestId, EEISInventoryOperationResult& OutResult) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Inventory Manager|Container")
+	virtual int32 Container_AddItem(UObject* FromSource, UEISItemContainer* ToContainer, UEISItemInstance* Item);
+
+	UFUNCTION(BlueprintCallable, Category = "Inventory Manager|Container")
+	virtual int32 Container_RemoveItem(UEISItemContainer* Container, UEISItemInstance* Item);
+
+	UFUNCTION(BlueprintCallable, Category = "Inventory Manager|Container")
+	virtual int32 Container_StackItem(UObject* FromSource, UEISItemContainer* InContainer, UEISItemInstance* SourceItem,
+	                                  UEISItemInstance* TargetItem);
+
+	UFUNCTION(BlueprintCallable, Category = "Inventory Manager|Container")
+	virtual int32 Container_SplitItem(UEISItemContainer* Container, UEISItemInstance* Item, int Amount);
+
 	UFUNCTION(BlueprintCallable, Category = "Inventory Manager|Container")
-	virtual void Container_AddItem(UObject* FromSource, UEISItemContainer* ToContainer, UEISItemInstance* Item);
+	virtual int32 Container_ConsolidateStacks(UEISItemContainer* Container);
 
 	UFUNCTION(BlueprintCallable, Category = "Inventory Manager|Container")
-	virtual void Container_RemoveItem(UEISItemContainer* Container, UEISItemInstance* Item);
+	virtual int32 Container_SortItems(UEISItemContainer* Container, EEISItemSortKey SortKey, bool bDescending = false);
 
 	UFUNCTION(BlueprintCallable, Category = "Inventory Manager|Container")
-	virtual void Container_StackItem(UObject* FromSource, UEISItemContainer* InContainer, UEISItemInstance* SourceItem,
-	                                 UEISItemInstance* TargetItem);
+	virtual int32 Container_MoveAllItems(UEISItemContainer* SourceContainer, UEISItemContainer* TargetContainer,
+	                                     FGameplayTagContainer Filter);
 
 	UFUNCTION(BlueprintCallable, Category = "Inventory Manager|Container")
-	virtual void Container_SplitItem(UEISItemContainer* Container, UEISItemInstance* Item, int Amount);
+	virtual int32 Container_CraftRecipe(UEISItemContainer* Container, UEISCraftingRecipe* Recipe, int Times = 1);
+
+	UFUNCTION(BlueprintCallable, Category = "Inventory Manager|Slot")
+	virtual int32 EquipSlot(UObject* FromSource, UEISEquipmentSlot* AtEquipmentSlot, UEISItemInstance* Item);
+
+	UFUNCTION(BlueprintCallable, Category = "Inventory Manager|Slot")
+	virtual int32 UnequipSlot(UEISEquipmentSlot* EquipmentSlot);
 
 	UFUNCTION(BlueprintCallable, Category = "Inventory Manager|Slot")
-	virtual void EquipSlot(UObject* FromSource, UEISEquipmentSlot* AtEquipmentSlot, UEISItemInstance* Item);
+	virtual int32 SaveLoadout(UEISEquipmentComponent* EquipmentComponent, FName LoadoutName);
 
 	UFUNCTION(BlueprintCallable, Category = "Inventory Manager|Slot")
-	virtual void UnequipSlot(UEISEquipmentSlot* EquipmentSlot);
+	virtual int32 ApplyLoadout(UEISEquipmentComponent* EquipmentComponent, FName LoadoutName,
+	                           UEISItemContainer* Container);
 
 	UFUNCTION(BlueprintCallable, Category = "Inventory Manager|Container")
 	virtual void RemoveItemFromSource(UObject* Source, UEISItemInstance* Item);
@@ -127,27 +213,123 @@ public:
 	
 protected:
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerContainerAddItem(UObject* FromSource, UEISItemContainer* ToContainer, UEISItemInstance* Item);
+	void ServerContainerAddItem(int32 RequestId, UObject* FromSource, UEISItemContainer* ToContainer,
+	                            FEISItemHandle ItemHandle);
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerContainerRemoveItem(int32 RequestId, UEISItemContainer* Container, FEISItemHandle ItemHandle);
+	
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerContainerStackItem(int32 RequestId, UObject* FromSource, UEISItemContainer* InContainer,
+	                              FEISItemHandle SourceItemHandle, FEISItemHandle TargetItemHandle);
 
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerContainerRemoveItem(UEISItemContainer* Container, UEISItemInstance* Item);
+	void ServerContainerSplitItem(int32 RequestId, UEISItemContainer* Container, FEISItemHandle ItemHandle, int Amount);
 	
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerContainerStackItem(UObject* FromSource, UEISItemContainer* InContainer, UEISItemInstance* SourceItem, UEISItemInstance* TargetItem);
+	void ServerContainerConsolidateStacks(int32 RequestId, UEISItemContainer* Container);
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerContainerSortItems(int32 RequestId, UEISItemContainer* Container, EEISItemSortKey SortKey,
+	                              bool bDescending);
 
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerContainerSplitItem(UEISItemContainer* Container, UEISItemInstance* Item, int Amount);
+	void ServerContainerMoveAllItems(int32 RequestId, UEISItemContainer* SourceContainer,
+	                                 UEISItemContainer* TargetContainer, const FGameplayTagContainer& Filter);
+	
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerContainerCraftRecipe(int32 RequestId, UEISItemContainer* Container, UEISCraftingRecipe* Recipe,
+	                                int Times);
 	
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerSlotEquipItem(UObject* FromSource, UEISEquipmentSlot* AtEquipmentSlot, UEISItemInstance* Item);
+	void ServerSlotEquipItem(int32 RequestId, UObject* FromSource, UEISEquipmentSlot* AtEquipmentSlot,
+	                         FEISItemHandle ItemHandle);
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerSlotUnequipItem(int32 RequestId, UEISEquipmentSlot* EquipmentSlot);
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerSaveLoadout(int32 RequestId, UEISEquipmentComponent* EquipmentComponent, FName LoadoutName);
 
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerSlotUnequipItem(UEISEquipmentSlot* EquipmentSlot);
+	void ServerApplyLoadout(int32 RequestId, UEISEquipmentComponent* EquipmentComponent, FName LoadoutName,
+	                        UEISItemContainer* Container);
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerVerifyChecksum(UObject* Repository, uint32 Checksum);
+
+	UFUNCTION(Client, Reliable)
+	void ClientAcknowledgeOperation(int32 RequestId, EEISInventoryOperationResult Result);
+
+	/** Completes server-started operations locally and reports client-started ones back to the owning client. */
+	void AcknowledgeOperation(int32 RequestId, EEISInventoryOperationResult Result);
+
+	UFUNCTION(Client, Reliable)
+	void ClientResyncRepository(UObject* Repository, const TArray<UEISItemInstance*>& RepositoryItems,
+	                            const TArray<FEISItemInstanceData>& RepositoryItemsData);
+
+	void VerifyRepositoryChecksum(UObject* Repository);
+
+	UEISItemInstance* ResolveItemHandle(const FEISItemHandle& ItemHandle) const;
+
+	/** Whether Repository is a container or slot replicated by this manager, i.e. one its owning client may act on. */
+	bool IsManagedRepository(const UObject* Repository) const;
 
 private:
+	friend FEISAppliedItemContainerEntry;
+	
+	void AddCountedContainer(UEISItemContainer* Container);
+	void RemoveCountedContainer(UEISItemContainer* Container);
+	void AddCountedSlot(UEISEquipmentSlot* EquipmentSlot);
+	void RemoveCountedSlot(UEISEquipmentSlot* EquipmentSlot);
+	void UpdateSlotCount(UEISEquipmentSlot* EquipmentSlot);
+	void OnContainerItemCountChange(const UEISItemDefinition* Definition, int32 Delta);
+	void OnEquipmentSlotChange(const FEISEquipmentSlotChangeData& ChangeData, UEISEquipmentSlot* EquipmentSlot);
+	void OnEquippedItemAmountChange(int NewAmount, int PrevAmount, UEISEquipmentSlot* EquipmentSlot);
+	int32 BeginOperation();
+	int32 RejectOperation(int32 RequestId);
+	void CompleteOperation(int32 RequestId, EEISInventoryOperationResult Result);
+	
 	UPROPERTY(EditDefaultsOnly, Category = "Inventory Manager")
 	bool bInitializeOnBeginPlay = false;
 	
 	UPROPERTY(Replicated)
 	FEISAppliedItemContainers ReplicatedContainers;
+
+	UPROPERTY(ReplicatedUsing = "OnRep_ReplicatedSlots")
+	TArray<UEISEquipmentSlot*> ReplicatedSlots;
+
+	UFUNCTION()
+	void OnRep_ReplicatedSlots(const TArray<UEISEquipmentSlot*>& PrevSlots);
+
+	FEISItemCounts ItemCounts;
+
+	TSet<TObjectKey<UEISItemContainer>> CountedContainers;
+
+	struct FSlotCount
+	{
+		const UEISItemDefinition* Definition = nullptr;
+		int32 Amount = 0;
+
+		/** Equipped item, whose amount changes are followed while it stays in the slot. */
+		TWeakObjectPtr<UEISItemInstance> Item;
+
+		/** Child container of the equipped item, counted like a replicated container while equipped. */
+		TWeakObjectPtr<UEISItemContainer> ChildContainer;
+	};
+
+	/** What each slot currently adds to the counts. */
+	TMap<TObjectKey<UEISEquipmentSlot>, FSlotCount> SlotCounts;
+
+	int32 LastRequestId = 0;
+
+	/** Promises handed out by GetOperationFuture, per operation still waiting for the server. */
+	TMap<int32, TArray<TPromise<EEISInventoryOperationResult>>> PendingOperations;
+
+	static constexpr int32 CompletedOperationsCapacity = 32;
+
+	/** Ring of recently completed operations, so a future requested after completion resolves right away. */
+	TArray<TPair<int32, EEISInventoryOperationResult>> CompletedOperations;
+
+	int32 NextCompletedOperation = 0;
 };
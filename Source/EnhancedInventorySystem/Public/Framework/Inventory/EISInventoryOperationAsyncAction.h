@@ -0,0 +1,43 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EISInventoryManagerComponent.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
+#include "EISInventoryOperationAsyncAction.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FInventoryOperationAsyncActionSignature, EEISInventoryOperationResult,
+                                            Result);
+
+UCLASS()
+class ENHANCEDINVENTORYSYSTEM_API UEISInventoryOperationAsyncAction : public UBlueprintAsyncActionBase
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(BlueprintAssignable)
+	FInventoryOperationAsyncActionSignature OnSucceeded;
+
+	UPROPERTY(BlueprintAssignable)
+	FInventoryOperationAsyncActionSignature OnFailed;
+
+	/** Waits until the server applies or rejects the operation with the request id. */
+	UFUNCTION(BlueprintCallable, Category = "Inventory Manager|Operation",
+		meta = (BlueprintInternalUseOnly = "true", DisplayName = "Wait For Inventory Operation"))
+	static UEISInventoryOperationAsyncAction* WaitForInventoryOperation(UEISInventoryManagerComponent* InventoryManager,
+	                                                                    int32 RequestId);
+
+	virtual void Activate() override;
+
+private:
+	void OnOperationComplete(int32 InRequestId, EEISInventoryOperationResult Result);
+	void Finish(EEISInventoryOperationResult Result);
+
+	UPROPERTY()
+	TObjectPtr<UEISInventoryManagerComponent> InventoryManager;
+
+	int32 RequestId = 0;
+
+	FDelegateHandle OperationCompleteHandle;
+};
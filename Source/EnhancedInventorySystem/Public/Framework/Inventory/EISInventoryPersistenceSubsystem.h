@@ -0,0 +1,100 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EISInventoryPersistenceSubsystem.generated.h"
+
+class FEISInventoryJournal;
+class UEISEquipmentSlot;
+class UEISInventoryManagerComponent;
+class UEISItemDefinition;
+struct FEISEquipmentSlotChangeData;
+struct FEISItemContainerChangeData;
+
+/** One saved container or slot of an inventory, in the binary inventory format. A part without data removes the saved
+ * part of that name. */
+struct FEISInventoryJournalPart
+{
+	FString PartName;
+	TArray<uint8> Data;
+};
+
+/**
+ * Keeps registered inventories in local files without any file access on the game thread. Mutations mark containers
+ * and slots dirty, and every flush interval the dirty ones are written to memory and handed to a journal thread. That
+ * thread appends them to a journal, and once the journal passes the compaction threshold it writes the latest state
+ * of every part to a snapshot and starts the journal over. On start the thread recovers from the snapshot and the
+ * intact part of the journal, so a crash loses only changes that were not flushed or not yet written.
+ */
+UCLASS(DisplayName = "Inventory Persistence Subsystem")
+class ENHANCEDINVENTORYSYSTEM_API UEISInventoryPersistenceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Flushes every dirty part and waits until the journal thread has written them. */
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return !DirtyRepositories.IsEmpty(); }
+	virtual TStatId GetStatId() const override;
+
+	/**
+	 * Tracks the inventory under the key and replaces its contents with the saved ones once the journal thread loaded
+	 * them. Changes are only persisted after that restore, so an inventory never overwrites its own save. Server only.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Inventory Persistence Subsystem")
+	void RegisterInventory(UEISInventoryManagerComponent* InventoryManager, const FString& InventoryKey);
+
+	/** Persists pending changes of the inventory and stops tracking it. */
+	UFUNCTION(BlueprintCallable, Category = "Inventory Persistence Subsystem")
+	void UnregisterInventory(UEISInventoryManagerComponent* InventoryManager);
+
+	UFUNCTION(BlueprintPure, Category = "Inventory Persistence Subsystem")
+	bool IsInventoryRestored(const UEISInventoryManagerComponent* InventoryManager) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Inventory Persistence Subsystem")
+	void SetFlushInterval(float InFlushInterval) { FlushInterval = FMath::Max(InFlushInterval, 0.f); }
+
+	/** Journal size in bytes above which the journal thread compacts it into a snapshot. */
+	UFUNCTION(BlueprintCallable, Category = "Inventory Persistence Subsystem")
+	void SetCompactionThreshold(int64 InCompactionThreshold);
+
+private:
+	struct FTrackedInventory
+	{
+		TWeakObjectPtr<UEISInventoryManagerComponent> InventoryManager;
+		FString InventoryKey;
+		TArray<TWeakObjectPtr<UObject>> BoundObjects;
+		int32 NumSavedContainers = 0;
+		bool bRestored = false;
+	};
+
+	FTrackedInventory* FindInventory(const UEISInventoryManagerComponent* InventoryManager);
+	FTrackedInventory* FindInventory(const FString& InventoryKey);
+	void BindRepositories(FTrackedInventory& Inventory);
+	void UnbindRepositories(FTrackedInventory& Inventory);
+	void MarkAllDirty(const FTrackedInventory& Inventory);
+	void MarkDirty(UObject* Repository);
+	void Flush();
+	void FlushInventory(FTrackedInventory& Inventory);
+	void RestoreInventory(const FString& InventoryKey, TArray<FEISInventoryJournalPart>&& Parts);
+	void OnRepositoriesChange(UEISInventoryManagerComponent* InventoryManager);
+	void OnContainerChange(const FEISItemContainerChangeData& ChangeData, UObject* Repository);
+	void OnCountChange(const UEISItemDefinition* Definition, int32 Delta, UObject* Repository);
+	void OnItemAmountChange(int NewAmount, int PrevAmount, UObject* Repository);
+	void OnEquipmentSlotChange(const FEISEquipmentSlotChangeData& ChangeData, UEISEquipmentSlot* EquipmentSlot);
+
+	TSharedPtr<FEISInventoryJournal, ESPMode::ThreadSafe> Journal;
+
+	TArray<FTrackedInventory> TrackedInventories;
+
+	TSet<TObjectKey<UObject>> DirtyRepositories;
+
+	float FlushInterval = 2.f;
+
+	int64 CompactionThreshold = 4 * 1024 * 1024;
+
+	float TimeSinceFlush = 0.f;
+};
@@ -0,0 +1,127 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EISItemContainer.h"
+
+class FEISInventoryReader;
+class UEISEquipmentSlot;
+class UEISItemInstance;
+
+/**
+ * Binary inventory format. A stream starts with a header, followed by container and slot records. Integers are
+ * packed, and item classes enter a palette the first time they appear, so later items refer to them by palette index.
+ * A record holds each item's class, id and amount. It holds commodity rows and the items of nested containers, and
+ * ends with the container layout.
+ */
+namespace EISInventorySerializer
+{
+	static constexpr uint32 Magic = 0x49534945;
+
+	enum class EVersion : uint16
+	{
+		Initial = 1,
+
+		Latest = Initial
+	};
+}
+
+/** Writes records to an archive, front to back without seeking. The palette lives as long as the writer, so one writer
+ * covers one stream. */
+class ENHANCEDINVENTORYSYSTEM_API FEISInventoryWriter
+{
+public:
+	explicit FEISInventoryWriter(FArchive& InAr) : Ar(InAr)
+	{
+	}
+
+	void WriteHeader();
+	void WriteCount(int32 Count);
+
+	/** A null container is written as an empty one. */
+	void WriteContainer(const UEISItemContainer* Container);
+	void WriteSlot(const UEISEquipmentSlot* EquipmentSlot);
+
+private:
+	void WriteClass(const UClass* ItemClass);
+	void WriteItem(const UEISItemInstance* Item);
+
+	FArchive& Ar;
+
+	TMap<const UClass*, uint32> Palette;
+};
+
+/** Records parsed by readers, applied only once every stream read cleanly so damaged data changes nothing. */
+class ENHANCEDINVENTORYSYSTEM_API FEISInventoryRestore
+{
+public:
+	/** Replaces the contents of every read container in one batch with a single change broadcast, then equips the
+	 * read slots. */
+	void Commit();
+
+private:
+	friend FEISInventoryReader;
+
+	struct FContainerRecord
+	{
+		UEISItemContainer* Container = nullptr;
+
+		TArray<UEISItemInstance*> Items;
+
+		FEISCommodityStacks CommodityStacks;
+
+		TArray<uint8> Layout;
+	};
+
+	struct FSlotRecord
+	{
+		UEISEquipmentSlot* EquipmentSlot = nullptr;
+
+		UEISItemInstance* Item = nullptr;
+	};
+
+	TArray<FContainerRecord> Containers;
+
+	TArray<FSlotRecord> Slots;
+};
+
+/**
+ * Reads records written by FEISInventoryWriter into a restore, which applies them on commit. A null container skips
+ * its record. Item ids of read items are reserved so new items never reuse them. Every read fails once the archive
+ * reports an error.
+ */
+class ENHANCEDINVENTORYSYSTEM_API FEISInventoryReader
+{
+public:
+	FEISInventoryReader(FArchive& InAr, UWorld* InWorld, FEISInventoryRestore& InRestore)
+		: Ar(InAr), World(InWorld), Restore(InRestore)
+	{
+	}
+
+	bool ReadHeader();
+	bool ReadCount(int32& OutCount);
+	bool ReadContainer(UEISItemContainer* Container);
+
+	/** Equips the recorded item at the slot of the same name; records of unknown slots are skipped. */
+	bool ReadSlot(TConstArrayView<UEISEquipmentSlot*> EquipmentSlots);
+
+	EISInventorySerializer::EVersion GetVersion() const { return Version; }
+
+private:
+	bool ReadClass(UClass*& OutItemClass);
+	bool ReadItem(UEISItemInstance*& OutItem, bool bCreate);
+
+	/** Bytes left in the archive, unbounded for archives that do not know their size. */
+	int64 GetRemainingSize() const;
+
+	FArchive& Ar;
+
+	UWorld* World = nullptr;
+
+	FEISInventoryRestore& Restore;
+
+	EISInventorySerializer::EVersion Version = EISInventorySerializer::EVersion::Latest;
+
+	TArray<UClass*> Palette;
+};
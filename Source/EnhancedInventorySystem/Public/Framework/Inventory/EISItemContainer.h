@@ -3,14 +3,29 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Async/Future.h"
 #include "EISItemInstance.h"
 #include "EISItemRepositoryInterface.h"
 #include "GameplayTagContainer.h"
 #include "UObject/Object.h"
 #include "EISItemContainer.generated.h"
 
+class FEISInventoryRestore;
+class FEISInventoryWriter;
 class UEISInventoryFunctionLibrary;
+class UEISItemContainer;
+class UEISItemFilterView;
 class UEISItemInstance;
+class UEISItemSortedView;
+
+UENUM(BlueprintType)
+enum class EEISItemSortKey : uint8
+{
+	Name,
+	Amount,
+	Category,
+	Id
+};
 
 USTRUCT(BlueprintType)
 struct FEISItemContainerChangeData
@@ -23,6 +38,9 @@ struct FEISItemContainerChangeData
 	UPROPERTY(BlueprintReadOnly)
 	TArray<UEISItemInstance*> RemovedItems;
 
+	UPROPERTY(BlueprintReadOnly)
+	bool bOrderChanged = false;
+
 	FEISItemContainerChangeData()
 	{
 	}
@@ -34,8 +52,126 @@ struct FEISItemContainerChangeData
 	}
 };
 
+/** Sort keys of one item. Item ids break ties, so every item has a distinct position in any order. */
+USTRUCT()
+struct ENHANCEDINVENTORYSYSTEM_API FEISItemSortEntry
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	TObjectPtr<UEISItemInstance> Item;
+
+	FName Name;
+
+	FName Category;
+
+	int Amount = 0;
+
+	int ItemId = 0;
+
+	static FEISItemSortEntry Make(UEISItemInstance* InItem);
+
+	static int32 Compare(const FEISItemSortEntry& A, const FEISItemSortEntry& B, EEISItemSortKey SortKey);
+};
+
+/** Commodity stacks packed as parallel rows; each row is a stack of one item class from the class palette. */
+USTRUCT()
+struct FEISCommodityStacks
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	TArray<TSubclassOf<UEISItemInstance>> ItemClasses;
+
+	UPROPERTY()
+	TArray<uint16> ClassIndices;
+
+	UPROPERTY()
+	TArray<int32> ItemIds;
+
+	UPROPERTY()
+	TArray<int32> Amounts;
+
+	int32 Num() const { return ClassIndices.Num(); }
+
+	int32 FindClass(const UClass* ItemClass) const;
+	int32 FindOrAddClass(UClass* ItemClass);
+	
+	UClass* GetRowClass(int32 Row) const { return ItemClasses[ClassIndices[Row]]; }
+
+	int32 AddRow(int32 ClassIndex, int32 ItemId, int32 Amount);
+	void RemoveRow(int32 Row);
+};
+
+/** Running item amounts per definition and per tag, tags counting for every parent as well. */
+struct ENHANCEDINVENTORYSYSTEM_API FEISItemCounts
+{
+	TMap<const UEISItemDefinition*, int32> DefinitionCounts;
+
+	TMap<FGameplayTag, int32> TagCounts;
+
+	void ApplyDelta(const UEISItemDefinition* Definition, int32 Delta);
+
+	int32 GetDefinitionCount(const UEISItemDefinition* Definition) const
+	{
+		const int32* Count = DefinitionCounts.Find(Definition);
+		return Count ? *Count : 0;
+	}
+
+	int32 GetTagCount(const FGameplayTag& Tag) const
+	{
+		const int32* Count = TagCounts.Find(Tag);
+		return Count ? *Count : 0;
+	}
+
+	void Reset()
+	{
+		DefinitionCounts.Reset();
+		TagCounts.Reset();
+	}
+};
+
+/** Items by tag, parents included, and by lowercase script and display name, sorted so a prefix is one range. */
+struct ENHANCEDINVENTORYSYSTEM_API FEISItemSearchIndex
+{
+	TMap<FGameplayTag, TSet<UEISItemInstance*>> TagBuckets;
+
+	TArray<TPair<FString, UEISItemInstance*>> SortedNames;
+
+	void Build(const TArray<UEISItemInstance*>& Items);
+	void AddItem(UEISItemInstance* Item);
+	void RemoveItem(UEISItemInstance* Item);
+
+	const TSet<UEISItemInstance*>* FindTagBucket(const FGameplayTag& Tag) const { return TagBuckets.Find(Tag); }
+
+	/** Items with a name starting with the lowercase prefix; an item matching by both names is listed once. */
+	void FindByPrefix(const FString& Prefix, TArray<UEISItemInstance*>& OutItems) const;
+
+	void Reset()
+	{
+		TagBuckets.Reset();
+		SortedNames.Reset();
+	}
+
+	/** Lowercase names the item is found under. */
+	static void GetSearchNames(const UEISItemInstance* Item, TArray<FString, TInlineAllocator<2>>& OutNames);
+
+	static const FGameplayTagContainer& GetSearchTags(const UEISItemInstance* Item);
+};
+
+/** Holds back container change broadcasts until the outermost batch on the container ends, then sends one. */
+struct ENHANCEDINVENTORYSYSTEM_API FEISItemContainerChangeBatch
+{
+	explicit FEISItemContainerChangeBatch(UEISItemContainer* InContainer);
+	~FEISItemContainerChangeBatch();
+
+private:
+	UEISItemContainer* Container = nullptr;
+};
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnContainerChangeSignature, const FEISItemContainerChangeData&,
                                             ContainerChangeData);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnCommodityChangeSignature);
 
 UCLASS(DisplayName = "Item Container", Abstract, EditInlineNew, DefaultToInstanced)
 class ENHANCEDINVENTORYSYSTEM_API UEISItemContainer : public UObject, public IEISItemRepositoryInterface
@@ -43,12 +179,26 @@ class ENHANCEDINVENTORYSYSTEM_API UEISItemContainer : public UObject, public IEI
 	GENERATED_BODY()
 
 	friend UEISInventoryFunctionLibrary;
+	friend FEISItemContainerChangeBatch;
+	friend FEISInventoryRestore;
+	friend FEISInventoryWriter;
+	friend UEISItemInstance;
 	
 public:
 	TMulticastDelegate<void(const FEISItemContainerChangeData&)> OnContainerChangeDelegate;
 	
 	UPROPERTY(BlueprintAssignable)
 	FOnContainerChangeSignature OnContainerChange;
+
+	TMulticastDelegate<void()> OnCommodityChangeDelegate;
+
+	TMulticastDelegate<void(const UEISItemDefinition*, int32)> OnItemCountChangeDelegate;
+
+	/** Count changes anywhere in the subtree: this container and every container nested in its items. */
+	TMulticastDelegate<void(const UEISItemDefinition*, int32)> OnSubtreeCountChangeDelegate;
+
+	UPROPERTY(BlueprintAssignable)
+	FOnCommodityChangeSignature OnCommodityChange;
 	
 	virtual bool IsSupportedForNetworking() const override { return true; }
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
@@ -59,9 +209,29 @@ public:
 	
 	void AddStartingData();
 
+	/** Hands the starting data to the item generation subsystem; the items arrive over the following frames. The
+	 * future receives the amount that did not fit. Lazy containers defer their starting data as usual instead. */
+	TFuture<int32> AddStartingDataAsync();
+
+	/** Creates the starting items that lazy mode deferred. Every access to the contents goes through it. */
+	void EnsureStartingData() const
+	{
+		if (bStartingDataPending)
+		{
+			const_cast<UEISItemContainer*>(this)->MaterializeStartingData();
+		}
+	}
+
+	UFUNCTION(BlueprintPure, Category = "Item Container")
+	bool HasPendingStartingData() const { return bStartingDataPending; }
+
 	UFUNCTION(BlueprintPure, Category = "Item Container")
 	bool CanAddItem(const UEISItemInstance* Item) const;
 
+	/** Splitting moves amount within the container, so only the new entry counts against the budgets. */
+	UFUNCTION(BlueprintPure, Category = "Item Container")
+	bool CanSplitItem(const UEISItemInstance* Item, int Amount) const;
+
 	UFUNCTION(BlueprintPure, Category = "Item Container")
 	bool Contains(const UEISItemInstance* Item) const;
 
@@ -78,16 +248,155 @@ public:
 	UEISItemInstance* FindItemById(int ItemId) const;
 
 	UFUNCTION(BlueprintPure, Category = "Item Container")
-	TArray<UEISItemInstance*> GetItems() const { return Items; }
+	TArray<UEISItemInstance*> GetItems() const
+	{
+		EnsureStartingData();
+		return Items;
+	}
+
+	virtual uint32 GetContentsChecksum() const override
+	{
+		EnsureStartingData();
+		return ContentsChecksum;
+	}
+
+	virtual TArray<UEISItemInstance*> GetRepositoryItems() const override { return GetItems(); }
+
+	virtual FEISRepositorySnapshotPtr GetContentsSnapshot() const override { return SnapshotSource.Get(); }
+
+	/** Starts or stops publishing contents snapshots. Enabling publishes the current contents right away. */
+	UFUNCTION(BlueprintCallable, Category = "Item Container")
+	void SetPublishSnapshots(bool bInPublishSnapshots);
+
+	UFUNCTION(BlueprintPure, Category = "Item Container")
+	bool IsPublishingSnapshots() const { return bPublishSnapshots; }
+
+	UFUNCTION(BlueprintPure, Category = "Item Container|Commodity")
+	bool IsCommodityItem(const UEISItemInstance* Item) const;
+
+	UFUNCTION(BlueprintPure, Category = "Item Container|Commodity")
+	int GetCommodityAmount(TSubclassOf<UEISItemInstance> ItemClass) const;
+
+	const FEISCommodityStacks& GetCommodityStacks() const
+	{
+		EnsureStartingData();
+		return CommodityStacks;
+	}
+
+	/** Total amount of the definition over items and commodity stacks. */
+	UFUNCTION(BlueprintPure, Category = "Item Container|Count")
+	int GetItemCount(const UEISItemDefinition* Definition) const { return GetItemCounts().GetDefinitionCount(Definition); }
+
+	UFUNCTION(BlueprintPure, Category = "Item Container|Count")
+	int GetTagItemCount(FGameplayTag Tag) const { return GetItemCounts().GetTagCount(Tag); }
+
+	const FEISItemCounts& GetItemCounts() const
+	{
+		EnsureStartingData();
+		return ItemCounts;
+	}
+
+	/** Total amount of the definition in this container and all nested containers. */
+	UFUNCTION(BlueprintPure, Category = "Item Container|Subtree")
+	int GetSubtreeItemCount(const UEISItemDefinition* Definition) const
+	{
+		return GetSubtreeCounts().GetDefinitionCount(Definition);
+	}
+
+	UFUNCTION(BlueprintPure, Category = "Item Container|Subtree")
+	int GetSubtreeTagItemCount(FGameplayTag Tag) const { return GetSubtreeCounts().GetTagCount(Tag); }
+
+	UFUNCTION(BlueprintPure, Category = "Item Container|Subtree")
+	float GetSubtreeWeight() const
+	{
+		EnsureStartingData();
+		return SubtreeWeight;
+	}
+
+	/** Items of the definition in this container and all nested containers. Commodity stacks are not included. */
+	UFUNCTION(BlueprintPure, Category = "Item Container|Subtree")
+	TArray<UEISItemInstance*> FindItemsInSubtree(const UEISItemDefinition* Definition) const;
+
+	const FEISItemCounts& GetSubtreeCounts() const
+	{
+		EnsureStartingData();
+		return SubtreeCounts;
+	}
+
+	/** Largest amount of the item that still fits the category and the capacity budgets, open stacks included.
+	 * Weight budgets of the containers this one is nested in apply as well. */
+	UFUNCTION(BlueprintPure, Category = "Item Container|Capacity")
+	int GetMaxAddableAmount(const UEISItemInstance* Item) const;
+
+	/** Whether all amounts fit at once; unlike separate GetMaxAddableAmount calls, they compete for the same entries,
+	 * weight, volume and layout. */
+	bool CanAddItemAmounts(TConstArrayView<TPair<const UEISItemInstance*, int>> ItemAmounts) const;
+
+	/** Amount a stack of the source onto the target moves; budgets apply when the source comes from elsewhere. */
+	UFUNCTION(BlueprintPure, Category = "Item Container|Capacity")
+	int GetStackableAmount(const UEISItemInstance* SourceItem, const UEISItemInstance* TargetItem) const;
+
+	/** Items plus commodity rows, the unit the entry budget counts in. */
+	UFUNCTION(BlueprintPure, Category = "Item Container|Capacity")
+	int GetEntryCount() const
+	{
+		EnsureStartingData();
+		return Items.Num() + CommodityStacks.Num();
+	}
+
+	UFUNCTION(BlueprintPure, Category = "Item Container|Capacity")
+	int32 GetMaxEntries() const { return MaxEntries; }
+
+	UFUNCTION(BlueprintPure, Category = "Item Container|Capacity")
+	float GetMaxWeight() const { return MaxWeight; }
+
+	UFUNCTION(BlueprintPure, Category = "Item Container|Capacity")
+	float GetMaxVolume() const { return MaxVolume; }
+
+	UFUNCTION(BlueprintPure, Category = "Item Container|Capacity")
+	float GetContentsVolume() const
+	{
+		EnsureStartingData();
+		return ContentsVolume;
+	}
+
+	/** Weight that can still be added here before this or an enclosing container reaches its weight budget. */
+	UFUNCTION(BlueprintPure, Category = "Item Container|Capacity")
+	float GetRemainingWeight() const;
+
+	/** Live subset of the items matching the tag filter and the name prefix. Commodity stacks are not included. */
+	UFUNCTION(BlueprintCallable, Category = "Item Container|View")
+	UEISItemFilterView* CreateFilterView(const FGameplayTagContainer& TagFilter, const FString& SearchText);
+
+	/** Items in the order of the sort key, kept up to date from container and amount changes. Commodity stacks are not
+	 * included. */
+	UFUNCTION(BlueprintCallable, Category = "Item Container|View")
+	UEISItemSortedView* CreateSortedView(EEISItemSortKey SortKey, bool bDescending = false);
+
+	/** Built on first use, then kept up to date with the items. */
+	const FEISItemSearchIndex& GetSearchIndex() const;
+
+	/** Container holding the item that carries this container. */
+	UFUNCTION(BlueprintPure, Category = "Item Container|Subtree")
+	UEISItemContainer* GetParentContainer() const { return ParentContainer.Get(); }
+
+	UFUNCTION(BlueprintPure, Category = "Item Container|Subtree")
+	UEISItemInstance* GetOwningItem() const { return GetTypedOuter<UEISItemInstance>(); }
 
 protected:
 	virtual void CallRemoveItem(UEISItemInstance* Item) override;
+
+	virtual void CallResyncItems(const TArray<UEISItemInstance*>& InItems,
+	                             const TArray<FEISItemInstanceData>& InItemsData) override;
 	
+	/** Returns false when not all of the item fit; the amount left over stays on the item. */
 	UFUNCTION(BlueprintCallable, Category = "Item Container")
 	bool FindAvailablePlace(UEISItemInstance* Item);
 	
+	/** Returns false when the container refused the item, which then still belongs to the caller. Commodity items
+	 * keep the amount the budgets left over. */
 	UFUNCTION(BlueprintCallable, Category = "Item Container")
-	void AddItem(UEISItemInstance* Item);
+	bool AddItem(UEISItemInstance* Item);
 
 	UFUNCTION(BlueprintCallable, Category = "Item Container")
 	void RemoveItem(UEISItemInstance* Item);
@@ -98,17 +407,171 @@ protected:
 	UFUNCTION(BlueprintCallable, Category = "Item Container")
 	bool SplitItem(UEISItemInstance* Item, int Amount);
 
+	/** Spreads the amount over existing stacks in one pass, then adds as few new items as the stack limit allows.
+	 * Returns the amount that did not fit. */
+	UFUNCTION(BlueprintCallable, Category = "Item Container")
+	int InsertItemAmount(TSubclassOf<UEISItemInstance> ItemClass, int Amount);
+
+	int InsertItemAmountFrom(const UEISItemInstance* SourceItem, int Amount);
+
+	/** Takes the amount of the definition from items and commodity stacks, newest first. Returns the amount taken. */
+	int ConsumeItemAmount(const UEISItemDefinition* Definition, int Amount);
+
+	/** Merges partial stacks of the same definition in one pass and removes the emptied items. */
+	UFUNCTION(BlueprintCallable, Category = "Item Container")
+	void ConsolidateStacks();
+
+	UFUNCTION(BlueprintCallable, Category = "Item Container")
+	void SortItems(EEISItemSortKey SortKey, bool bDescending = false);
+
+	/** Moves every item of the source container whose tags match the filter (all items when the filter is empty).
+	 * Items that did not fit stay in the source and are returned in OutRemainingItems. */
+	UFUNCTION(BlueprintCallable, Category = "Item Container")
+	bool MoveAllItemsFrom(UEISItemContainer* SourceContainer, const FGameplayTagContainer& Filter,
+	                      TArray<UEISItemInstance*>& OutRemainingItems);
+
+	UFUNCTION(BlueprintCallable, Category = "Item Container|Commodity")
+	int AddCommodityAmount(TSubclassOf<UEISItemInstance> ItemClass, int Amount);
+
+	UFUNCTION(BlueprintCallable, Category = "Item Container|Commodity")
+	int RemoveCommodityAmount(TSubclassOf<UEISItemInstance> ItemClass, int Amount);
+
+	UFUNCTION(BlueprintCallable, Category = "Item Container|Commodity")
+	UEISItemInstance* MaterializeCommodity(TSubclassOf<UEISItemInstance> ItemClass, int Amount);
+
+	virtual void OnItemAdded(UEISItemInstance* Item);
+	virtual void OnItemRemoved(UEISItemInstance* Item);
+	virtual void OnItemAmountChange(int NewAmount, int PrevAmount, UEISItemInstance* Item);
+	virtual void OnCommodityAmountChange(const UEISItemInstance* CommodityItem, int ItemId, int NewAmount,
+	                                     int PrevAmount);
+
+	/** Layout check for one more item entry, on top of the category and the budgets. */
+	virtual bool CanPlaceItem(const UEISItemInstance* Item) const { return true; }
+
+	/** Layout check for the given number of new entries of each item together. */
+	virtual bool CanPlaceItems(TConstArrayView<TPair<const UEISItemInstance*, int32>> ItemEntries) const
+	{
+		return true;
+	}
+
+	/** How many more entries of the item the container takes; MAX_int32 when there is no limit. */
+	virtual int32 GetFreeEntryCount(const UEISItemInstance* Item) const;
+
+	/** Arrangement of the items beyond their order, saved after the contents and loaded after they are restored. */
+	virtual void SaveLayout(FArchive& Ar) const
+	{
+	}
+
+	virtual void LoadLayout(FArchive& Ar)
+	{
+	}
+
 private:
+	void MaterializeStartingData();
+
+	/** Swaps in loaded contents in one batch, without admission checks, and drops pending starting data. */
+	void RestoreContents(TArray<UEISItemInstance*>&& NewItems, FEISCommodityStacks&& NewCommodityStacks);
+
+	bool MatchesCategory(const UEISItemInstance* Item) const;
+	bool FitsCapacity(const UEISItemInstance* Item) const;
+	void UpdateOpenStackCapacity(const UEISItemInstance* Item, int NewAmount, int PrevAmount);
+	
+	int FillExistingStacks(const UEISItemInstance* ForItem, int Amount);
+	int GenerateStacks(const UEISItemInstance* SourceItem, int Amount, TArray<UEISItemInstance*>& OutAddedItems);
+
+	/** Adds the amount of a commodity item; what the budgets refuse stays on the item and returns false. */
+	bool AddCommodityAmountFrom(UEISItemInstance* Item);
+	
+	void InsertItemInternal(UEISItemInstance* Item);
+	void RemoveItemInternal(UEISItemInstance* Item);
+	void TrackItem(UEISItemInstance* Item);
+	void UntrackItem(UEISItemInstance* Item);
+	void BroadcastChange(const FEISItemContainerChangeData& ChangeData);
+	void BroadcastCommodityChange();
+	void ApplyItemCountDelta(const UEISItemDefinition* Definition, int32 Delta);
+	void PropagateCountDelta(const UEISItemDefinition* Definition, int32 Delta);
+	void PropagateIndexedItem(UEISItemInstance* Item, bool bAdded);
+	void AttachChildContainer(UEISItemContainer* ChildContainer);
+	void DetachChildContainer(UEISItemContainer* ChildContainer);
+	void MarkSnapshotDirty();
+	void PublishSnapshot();
+
 	UPROPERTY(EditDefaultsOnly, Category = "Item Container")
 	FGameplayTagContainer CategoryTags;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Item Container")
 	TArray<TSubclassOf<UEISItemInstance>> StartingData;
 
+	UPROPERTY(EditDefaultsOnly, Category = "Item Container")
+	bool bStoreCommodityStacks = false;
+
+	/** Most items and commodity rows the container holds; zero for no limit. */
+	UPROPERTY(EditDefaultsOnly, Category = "Item Container|Capacity", meta = (ClampMin = "0"))
+	int32 MaxEntries = 0;
+
+	/** Most weight the container holds, nested containers included; zero for no limit. */
+	UPROPERTY(EditDefaultsOnly, Category = "Item Container|Capacity", meta = (ClampMin = "0"))
+	float MaxWeight = 0.f;
+
+	/** Most volume the container holds; zero for no limit. Items inside nested containers take no extra space. */
+	UPROPERTY(EditDefaultsOnly, Category = "Item Container|Capacity", meta = (ClampMin = "0"))
+	float MaxVolume = 0.f;
+
+	/** Keeps only the starting data classes until the contents are first read, replicated or requested. */
+	UPROPERTY(EditDefaultsOnly, Category = "Item Container")
+	bool bLazyStartingData = false;
+
+	bool bStartingDataPending = false;
+
+	/** Publishes an immutable copy of the contents after every change so worker threads can read them. */
+	UPROPERTY(EditDefaultsOnly, Category = "Item Container")
+	bool bPublishSnapshots = false;
+
+	UPROPERTY(ReplicatedUsing = "OnRep_CommodityStacks")
+	FEISCommodityStacks CommodityStacks;
+
 	UPROPERTY(EditInstanceOnly, ReplicatedUsing = "OnRep_Items", Category = "Item Container")
 	TArray<UEISItemInstance*> Items;
 
 	UFUNCTION()
 	void OnRep_Items(TArray<UEISItemInstance*> PrevContainer);
+
+	UFUNCTION()
+	void OnRep_CommodityStacks(const FEISCommodityStacks& PrevCommodityStacks);
+
+	uint32 ContentsChecksum = 0;
+
+	FEISItemCounts ItemCounts;
+
+	FEISItemCounts SubtreeCounts;
+
+	float SubtreeWeight = 0.f;
+
+	float ContentsVolume = 0.f;
+
+	/** Amount per definition that still fits into existing stacks. */
+	TMap<const UEISItemDefinition*, int64> OpenStackCapacity;
+
+	TMap<const UEISItemDefinition*, TArray<UEISItemInstance*>> SubtreeItems;
+
+	TWeakObjectPtr<UEISItemContainer> ParentContainer;
+
+	mutable FEISItemSearchIndex SearchIndex;
+
+	mutable bool bSearchIndexBuilt = false;
+
+	int32 ChangeBatchDepth = 0;
+
+	FEISItemContainerChangeData PendingChangeData;
+
+	bool bCommodityChangePending = false;
+
+	bool bSnapshotPending = false;
+
+	uint32 SnapshotVersion = 0;
+
+	FEISRepositorySnapshotSource SnapshotSource;
+
+	mutable uint64 CategoryTagMask = 0;
 };
 
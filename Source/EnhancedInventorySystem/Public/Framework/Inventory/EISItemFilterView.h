@@ -0,0 +1,91 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EISItemContainer.h"
+#include "GameplayTagContainer.h"
+#include "UObject/Object.h"
+#include "EISItemFilterView.generated.h"
+
+/**
+ * Items of a container that carry any of the filter tags and have a script or display name starting with the search
+ * text. Filter changes query the container search index and container changes only test the added items, so the view
+ * never rescans the container.
+ */
+UCLASS(DisplayName = "Item Filter View", BlueprintType)
+class ENHANCEDINVENTORYSYSTEM_API UEISItemFilterView : public UObject
+{
+	GENERATED_BODY()
+
+	friend UEISItemContainer;
+
+public:
+	/** Items entering and leaving the view, whether the container or the filter changed. */
+	TMulticastDelegate<void(const FEISItemContainerChangeData&)> OnViewChangeDelegate;
+
+	UPROPERTY(BlueprintAssignable)
+	FOnContainerChangeSignature OnViewChange;
+
+	virtual void BeginDestroy() override;
+
+	/** An empty filter matches every tag. */
+	UFUNCTION(BlueprintCallable, Category = "Item Filter View")
+	void SetTagFilter(const FGameplayTagContainer& InTagFilter);
+
+	/** Case-insensitive name prefix; an empty text matches every name. */
+	UFUNCTION(BlueprintCallable, Category = "Item Filter View")
+	void SetSearchText(const FString& InSearchText);
+
+	UFUNCTION(BlueprintPure, Category = "Item Filter View")
+	const FGameplayTagContainer& GetTagFilter() const { return TagFilter; }
+
+	UFUNCTION(BlueprintPure, Category = "Item Filter View")
+	FString GetSearchText() const { return SearchText; }
+
+	/** Matching items in no particular order. */
+	UFUNCTION(BlueprintPure, Category = "Item Filter View")
+	TArray<UEISItemInstance*> GetItems() const { return MatchingItems; }
+
+	const TArray<UEISItemInstance*>& GetMatchingItems() const { return MatchingItems; }
+
+	UFUNCTION(BlueprintPure, Category = "Item Filter View")
+	int GetNum() const { return MatchingItems.Num(); }
+
+	UFUNCTION(BlueprintPure, Category = "Item Filter View")
+	bool Contains(const UEISItemInstance* Item) const { return ItemIndices.Contains(Item); }
+
+	UFUNCTION(BlueprintPure, Category = "Item Filter View")
+	bool Matches(const UEISItemInstance* Item) const;
+
+	UFUNCTION(BlueprintPure, Category = "Item Filter View")
+	UEISItemContainer* GetContainer() const { return Container.Get(); }
+
+private:
+	void Initialize(UEISItemContainer* InContainer, const FGameplayTagContainer& InTagFilter,
+	                const FString& InSearchText);
+
+	/** Narrowing only re-tests the current matches, which holds when the search text grew by a suffix. */
+	void Refresh(bool bNarrowing);
+
+	void SetMatchingItems(TArray<UEISItemInstance*>&& NewItems);
+	void AddMatchingItem(UEISItemInstance* Item);
+	bool RemoveMatchingItem(UEISItemInstance* Item);
+	void OnContainerChange(const FEISItemContainerChangeData& ChangeData);
+	void BroadcastViewChange(const FEISItemContainerChangeData& ChangeData);
+
+	TWeakObjectPtr<UEISItemContainer> Container;
+
+	FDelegateHandle ContainerChangeHandle;
+
+	UPROPERTY()
+	FGameplayTagContainer TagFilter;
+
+	/** Lowercase. */
+	FString SearchText;
+
+	UPROPERTY()
+	TArray<UEISItemInstance*> MatchingItems;
+
+	TMap<const UEISItemInstance*, int32> ItemIndices;
+};
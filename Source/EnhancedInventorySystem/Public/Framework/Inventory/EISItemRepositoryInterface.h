@@ -3,10 +3,59 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Misc/ScopeRWLock.h"
 #include "UObject/Interface.h"
 #include "EISItemRepositoryInterface.generated.h"
 
+class UEISItemDefinition;
 class UEISItemInstance;
+struct FEISItemInstanceData;
+
+/** Immutable copy of repository contents that worker threads may read while the game thread keeps mutating. */
+struct ENHANCEDINVENTORYSYSTEM_API FEISRepositorySnapshot
+{
+	struct FEntry
+	{
+		int32 ItemId = 0;
+		uint16 DefinitionIndex = MAX_uint16;
+
+		/** Only for identity comparisons; the definition object itself must not be read off the game thread. */
+		const UEISItemDefinition* Definition = nullptr;
+
+		int32 Amount = 0;
+	};
+
+	TArray<FEntry> Entries;
+
+	/** Grows by one with every publish of the same repository. */
+	uint32 Version = 0;
+
+	int32 GetAmount(const UEISItemDefinition* Definition) const;
+};
+
+using FEISRepositorySnapshotPtr = TSharedPtr<const FEISRepositorySnapshot, ESPMode::ThreadSafe>;
+
+/** Latest published snapshot. Readers hold the lock only while copying the pointer, never while a snapshot is built. */
+class ENHANCEDINVENTORYSYSTEM_API FEISRepositorySnapshotSource
+{
+public:
+	FEISRepositorySnapshotPtr Get() const
+	{
+		FReadScopeLock ReadLock(Lock);
+		return Snapshot;
+	}
+
+	void Publish(FEISRepositorySnapshotPtr NewSnapshot)
+	{
+		FWriteScopeLock WriteLock(Lock);
+		Snapshot = MoveTemp(NewSnapshot);
+	}
+
+private:
+	mutable FRWLock Lock;
+
+	FEISRepositorySnapshotPtr Snapshot;
+};
 
 UINTERFACE()
 class UEISItemRepositoryInterface : public UInterface
@@ -22,4 +71,13 @@ public:
 	virtual void CallRemoveItem(UEISItemInstance* Item);
 
 	virtual void CallSubtractOrRemoveItem(UEISItemInstance* Item, int Amount);
+
+	virtual uint32 GetContentsChecksum() const;
+
+	virtual TArray<UEISItemInstance*> GetRepositoryItems() const;
+
+	/** Safe to call from any thread. Null until the repository publishes its first snapshot. */
+	virtual FEISRepositorySnapshotPtr GetContentsSnapshot() const;
+
+	virtual void CallResyncItems(const TArray<UEISItemInstance*>& InItems, const TArray<FEISItemInstanceData>& InItemsData);
 };
@@ -0,0 +1,129 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EISItemContainer.h"
+#include "UObject/Object.h"
+#include "EISItemSortedView.generated.h"
+
+/**
+ * One positional step of a sorted view update. Applying the steps of an update in order to a copy of the previous list
+ * reproduces the new one: FromIndex is the position before the step, ToIndex the position after it.
+ */
+USTRUCT(BlueprintType)
+struct ENHANCEDINVENTORYSYSTEM_API FEISSortedViewChange
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Sorted View Change")
+	TObjectPtr<UEISItemInstance> Item;
+
+	/** INDEX_NONE for an inserted item. */
+	UPROPERTY(BlueprintReadOnly, Category = "Sorted View Change")
+	int32 FromIndex = INDEX_NONE;
+
+	/** INDEX_NONE for a removed item. */
+	UPROPERTY(BlueprintReadOnly, Category = "Sorted View Change")
+	int32 ToIndex = INDEX_NONE;
+
+	FEISSortedViewChange()
+	{
+	}
+
+	FEISSortedViewChange(UEISItemInstance* InItem, int32 InFromIndex, int32 InToIndex)
+		: Item(InItem), FromIndex(InFromIndex), ToIndex(InToIndex)
+	{
+	}
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnSortedViewChangeSignature, const TArray<FEISSortedViewChange>&,
+                                            Changes);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnSortedViewResetSignature);
+
+/**
+ * Items of a container kept in the order of a sort key, the same order SortItems produces. Inserts, removals and amount
+ * changes find their position by binary search on the cached sort keys instead of sorting again, and every update is
+ * reported as insert, remove and move steps so virtualized lists only touch the affected rows.
+ */
+UCLASS(DisplayName = "Item Sorted View", BlueprintType)
+class ENHANCEDINVENTORYSYSTEM_API UEISItemSortedView : public UObject
+{
+	GENERATED_BODY()
+
+	friend UEISItemContainer;
+
+public:
+	TMulticastDelegate<void(const TArray<FEISSortedViewChange>&)> OnViewChangeDelegate;
+
+	UPROPERTY(BlueprintAssignable)
+	FOnSortedViewChangeSignature OnViewChange;
+
+	/** The whole order changed; lists should read the view again. */
+	TMulticastDelegate<void()> OnViewResetDelegate;
+
+	UPROPERTY(BlueprintAssignable)
+	FOnSortedViewResetSignature OnViewReset;
+
+	virtual void BeginDestroy() override;
+
+	UFUNCTION(BlueprintCallable, Category = "Item Sorted View")
+	void SetSortKey(EEISItemSortKey InSortKey, bool bInDescending = false);
+
+	UFUNCTION(BlueprintPure, Category = "Item Sorted View")
+	EEISItemSortKey GetSortKey() const { return SortKey; }
+
+	UFUNCTION(BlueprintPure, Category = "Item Sorted View")
+	bool IsDescending() const { return bDescending; }
+
+	UFUNCTION(BlueprintPure, Category = "Item Sorted View")
+	int GetNum() const { return Entries.Num(); }
+
+	UFUNCTION(BlueprintPure, Category = "Item Sorted View")
+	UEISItemInstance* GetItemAt(int Index) const
+	{
+		return Entries.IsValidIndex(Index) ? Entries[Index].Item.Get() : nullptr;
+	}
+
+	/** Position of the item, INDEX_NONE when it is not in the view. */
+	UFUNCTION(BlueprintPure, Category = "Item Sorted View")
+	int IndexOf(const UEISItemInstance* Item) const;
+
+	UFUNCTION(BlueprintPure, Category = "Item Sorted View")
+	TArray<UEISItemInstance*> GetItems() const;
+
+	UFUNCTION(BlueprintPure, Category = "Item Sorted View")
+	UEISItemContainer* GetContainer() const { return Container.Get(); }
+
+private:
+	void Initialize(UEISItemContainer* InContainer, EEISItemSortKey InSortKey, bool bInDescending);
+	void Rebuild();
+
+	bool IsLess(const FEISItemSortEntry& A, const FEISItemSortEntry& B) const
+	{
+		const int32 Order = FEISItemSortEntry::Compare(A, B, SortKey);
+		return bDescending ? Order > 0 : Order < 0;
+	}
+
+	int32 FindEntry(const FEISItemSortEntry& Entry) const;
+	int32 InsertEntry(const FEISItemSortEntry& Entry);
+	void TrackItem(UEISItemInstance* Item);
+	void UntrackItem(UEISItemInstance* Item);
+	void OnContainerChange(const FEISItemContainerChangeData& ChangeData);
+	void OnItemAmountChange(int NewAmount, int PrevAmount, UEISItemInstance* Item);
+	void BroadcastViewChange(const TArray<FEISSortedViewChange>& Changes);
+
+	TWeakObjectPtr<UEISItemContainer> Container;
+
+	FDelegateHandle ContainerChangeHandle;
+
+	EEISItemSortKey SortKey = EEISItemSortKey::Name;
+
+	bool bDescending = false;
+
+	UPROPERTY()
+	TArray<FEISItemSortEntry> Entries;
+
+	/** Entries as they were sorted, needed to find an entry again once its item data has moved on. */
+	TMap<const UEISItemInstance*, FEISItemSortEntry> SortedEntries;
+};
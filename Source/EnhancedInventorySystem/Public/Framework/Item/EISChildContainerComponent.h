@@ -0,0 +1,24 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EISItemInstance.h"
+#include "EISChildContainerComponent.generated.h"
+
+class UEISItemContainer;
+
+/** Gives every instance of the item its own container, such as a bag, pouch or backpack. */
+UCLASS(DisplayName = "Child Container Component")
+class ENHANCEDINVENTORYSYSTEM_API UEISChildContainerComponent : public UEISItemInstanceComponent
+{
+	GENERATED_BODY()
+
+public:
+	UFUNCTION(BlueprintPure, Category = "Item Component|Container")
+	TSubclassOf<UEISItemContainer> GetContainerClass() const { return ContainerClass; }
+
+private:
+	UPROPERTY(EditAnywhere, Category = "Item Component|Container")
+	TSubclassOf<UEISItemContainer> ContainerClass;
+};
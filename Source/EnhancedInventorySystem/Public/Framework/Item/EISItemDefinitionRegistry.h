@@ -0,0 +1,142 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "EISItemDefinitionRegistry.generated.h"
+
+class UEISItemDefinition;
+
+/** Definition fields read by stack searches, packed into one dense row per registry index. */
+struct ENHANCEDINVENTORYSYSTEM_API FEISItemDefinitionHotData
+{
+	enum EFlags : uint8
+	{
+		Valid = 1 << 0,
+		Stackable = 1 << 1,
+		Commodity = 1 << 2
+	};
+
+	/** Bloom mask of the definition tags and their parents; a zero overlap with a category mask means no match. */
+	uint64 TagMask = 0;
+
+	/** Hash of the script name string, identical across processes. */
+	uint32 NameHash = 0;
+
+	int32 StackAmount = 1;
+
+	/** Largest amount a single stack may hold: 1 when not stackable, StackMaximum when limited. */
+	int32 StackLimit = 1;
+
+	float Weight = 0.f;
+
+	float Volume = 0.f;
+
+	uint8 Flags = 0;
+
+	bool IsValid() const { return (Flags & Valid) != 0; }
+	bool IsStackable() const { return (Flags & Stackable) != 0; }
+	bool IsCommodity() const { return (Flags & Commodity) != 0; }
+
+	static FEISItemDefinitionHotData FromDefinition(const UEISItemDefinition* Definition);
+
+	static uint64 MakeTagMask(const FGameplayTagContainer& Tags);
+};
+
+/** Definition reference that goes over the network as its registry index instead of an object path. */
+USTRUCT(BlueprintType)
+struct ENHANCEDINVENTORYSYSTEM_API FEISItemDefinitionRef
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item Definition")
+	TObjectPtr<UEISItemDefinition> Definition;
+
+	FEISItemDefinitionRef()
+	{
+	}
+
+	FEISItemDefinitionRef(UEISItemDefinition* InDefinition) : Definition(InDefinition)
+	{
+	}
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template <>
+struct TStructOpsTypeTraits<FEISItemDefinitionRef> : TStructOpsTypeTraitsBase2<FEISItemDefinitionRef>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
+/**
+ * Assigns every item definition known to the asset manager a 16-bit index. Indices follow the sorted primary asset
+ * names, so server and client builds with the same content agree on them without any exchange.
+ */
+UCLASS(DisplayName = "Item Definition Registry")
+class ENHANCEDINVENTORYSYSTEM_API UEISItemDefinitionRegistry : public UEngineSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static constexpr uint16 InvalidIndex = MAX_uint16;
+
+	static UEISItemDefinitionRegistry* Get();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	bool IsBuilt() const { return bBuilt; }
+
+	int32 Num() const { return Definitions.Num(); }
+
+	uint16 FindIndex(const UEISItemDefinition* Definition) const;
+
+	/** Index from the asset scan only; these are the same on every machine, so they can be sent over the network. */
+	uint16 FindAssetIndex(const UEISItemDefinition* Definition) const;
+
+	uint16 FindIndexByName(FName ScriptName) const;
+
+	/** Definitions missing from the asset registry get an index appended at runtime; it is only valid locally. */
+	uint16 FindOrRegisterIndex(const UEISItemDefinition* Definition);
+
+	UEISItemDefinition* GetDefinition(uint16 Index) const;
+
+	UEISItemDefinition* LoadDefinition(uint16 Index) const;
+
+	const FEISItemDefinitionHotData* GetHotData(uint16 Index) const
+	{
+		return HotData.IsValidIndex(Index) && HotData[Index].IsValid() ? &HotData[Index] : nullptr;
+	}
+
+	void RefreshHotData(const UEISItemDefinition* Definition);
+
+	/** Definition tags together with all their parents, built on first use. */
+	const FGameplayTagContainer& GetExpandedTags(const UEISItemDefinition* Definition);
+
+	UFUNCTION(BlueprintPure, Category = "Item Definition Registry")
+	UEISItemDefinition* FindDefinitionByName(FName ScriptName) const;
+
+private:
+	void BuildRegistry();
+
+	bool bBuilt = false;
+
+	TArray<TSoftObjectPtr<UEISItemDefinition>> Definitions;
+
+	TArray<FEISItemDefinitionHotData> HotData;
+
+	TMap<FName, uint16> AssetNameToIndex;
+
+	TMap<FName, uint16> ScriptNameToIndex;
+
+	TMap<FObjectKey, uint16> RuntimeDefinitionToIndex;
+
+	TMap<FObjectKey, FGameplayTagContainer> ExpandedTags;
+};
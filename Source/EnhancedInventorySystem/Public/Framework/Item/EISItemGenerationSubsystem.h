@@ -0,0 +1,70 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "EISItemInstance.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EISItemGenerationSubsystem.generated.h"
+
+class UEISItemContainer;
+
+struct FEISItemGenerationEntry
+{
+	TSubclassOf<UEISItemInstance> ItemClass;
+	int32 Amount = 1;
+};
+
+/**
+ * Generates items for containers in two steps. Worker tasks split the requested amounts into stacks and assign item
+ * ids, then the game thread creates and adds the items, spending at most MaxItemsPerFrame items per tick.
+ */
+UCLASS(DisplayName = "Item Generation Subsystem")
+class ENHANCEDINVENTORYSYSTEM_API UEISItemGenerationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return !ReadyRequests.IsEmpty(); }
+	virtual TStatId GetStatId() const override;
+
+	/** The future receives the amount that could not be added to the container. */
+	TFuture<int32> RequestItems(UEISItemContainer* Container, TArray<FEISItemGenerationEntry> Entries);
+
+	/** Stops adding items for the container's requests; their futures receive the amounts never added. */
+	void CancelRequests(const UEISItemContainer* Container);
+
+	UFUNCTION(BlueprintCallable, Category = "Item Generation Subsystem")
+	void SetMaxItemsPerFrame(int32 InMaxItemsPerFrame) { MaxItemsPerFrame = FMath::Max(InMaxItemsPerFrame, 1); }
+
+private:
+	struct FPendingItem
+	{
+		TSubclassOf<UEISItemInstance> ItemClass;
+		FEISItemInstanceData ItemData;
+	};
+	
+	struct FRequest
+	{
+		TWeakObjectPtr<UEISItemContainer> Container;
+		TArray<FEISItemGenerationEntry> Entries;
+		TArray<int32> StackLimits;
+		TArray<FPendingItem> Items;
+		int32 NextItem = 0;
+		int32 RemainingAmount = 0;
+		bool bCancelled = false;
+		TPromise<int32> Promise;
+	};
+
+	void CompleteRequest(FRequest& Request);
+	
+	/** Requests still being split on a worker, kept so they can be cancelled before they are ready. */
+	TArray<TSharedPtr<FRequest, ESPMode::ThreadSafe>> InFlightRequests;
+	
+	TArray<TSharedPtr<FRequest, ESPMode::ThreadSafe>> ReadyRequests;
+
+	int32 MaxItemsPerFrame = 64;
+};
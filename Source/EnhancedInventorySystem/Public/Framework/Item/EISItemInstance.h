@@ -3,10 +3,13 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "EISItemDefinitionRegistry.h"
+#include "EISItemRegistrySubsystem.h"
 #include "GameplayTagContainer.h"
 #include "UObject/Object.h"
 #include "EISItemInstance.generated.h"
 
+class UEISItemContainer;
 class UEISItemInstanceComponent;
 class UEISItemInstance;
 
@@ -34,11 +37,14 @@ class ENHANCEDINVENTORYSYSTEM_API UEISItemDefinition : public UPrimaryDataAsset
 	GENERATED_BODY()
 
 public:
-	UPROPERTY(EditAnywhere, Category = "Class")
+	UPROPERTY(EditAnywhere, AssetRegistrySearchable, Category = "Class")
 	FName ScriptName;
 
 	UPROPERTY(EditAnywhere, Category = "Class")
 	FGameplayTagContainer Tags;
+
+	UPROPERTY(EditAnywhere, Category = "Class")
+	FText DisplayName;
 	
 	UPROPERTY(EditAnywhere, Instanced, Category = "Components")
 	TArray<UEISItemInstanceComponent*> Components;
@@ -55,6 +61,26 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Properties|Stacking",
 		meta = (EditCondition = "bStackable && bHasStackMaximum", ClampMin = "1"))
 	int StackMaximum = 1;
+
+	/** Stored as a packed row instead of an item object in containers that keep commodity stacks. */
+	UPROPERTY(EditAnywhere, Category = "Properties|Stacking", meta = (EditCondition = "bStackable"))
+	bool bCommodity = false;
+
+	/** Weight of a single unit; containers sum it over their contents and nested containers. */
+	UPROPERTY(EditAnywhere, Category = "Properties", meta = (ClampMin = "0"))
+	float Weight = 0.f;
+
+	/** Space a single unit takes up in containers with a volume budget. */
+	UPROPERTY(EditAnywhere, Category = "Properties", meta = (ClampMin = "0"))
+	float Volume = 0.f;
+
+	/** Cells the item covers in grid containers, before rotation. */
+	UPROPERTY(EditAnywhere, Category = "Properties", meta = (ClampMin = "1", ClampMax = "64"))
+	FIntPoint GridSize = FIntPoint(1, 1);
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
 };
 
 UCLASS(Abstract, BlueprintType, Blueprintable, EditInlineNew, DefaultToInstanced, Within = "EISItemDefinition")
@@ -78,9 +104,15 @@ class ENHANCEDINVENTORYSYSTEM_API UEISItemInstance : public UObject
 {
 	GENERATED_BODY()
 
+	friend UEISItemRegistrySubsystem;
+
 public:
 	UEISItemInstance(const FObjectInitializer& ObjectInitializer);
 
+	virtual void PostInitProperties() override;
+	virtual void PostLoad() override;
+	virtual void BeginDestroy() override;
+
 	TMulticastDelegate<void(UEISItemInstance*)> OnItemCreateDelegate;
 	
 	UPROPERTY(BlueprintAssignable)
@@ -110,6 +142,11 @@ public:
 		return Cast<const T>(GetDefinition());
 	}
 	
+	uint16 GetDefinitionIndex() const;
+
+	/** Registry row of the definition, or a row built from the definition once when the registry has none. */
+	const FEISItemDefinitionHotData& GetHotData() const;
+	
 	UFUNCTION(BlueprintPure, Category = "Item|Definition")
 	FORCEINLINE FName GetScriptName() const;
 	
@@ -122,6 +159,12 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Item|Definition")
 	FORCEINLINE int GetStackAmount() const;
 
+	UFUNCTION(BlueprintPure, Category = "Item|Definition")
+	int GetStackLimit() const;
+
+	UFUNCTION(BlueprintPure, Category = "Item|Amount")
+	int GetStackCapacity() const;
+
 #pragma endregion Definition
 
 #pragma region Amount
@@ -193,19 +236,63 @@ public:
 	
 	UFUNCTION(BlueprintPure, Category = "Item")
 	UObject* GetOwner() const { return OwnerPrivate; }
+
+	UFUNCTION(BlueprintPure, Category = "Item")
+	const FEISItemHandle& GetItemHandle() const { return ItemHandle; }
+
+	/** Container the item carries when its definition has a child container component. */
+	UFUNCTION(BlueprintPure, Category = "Item")
+	UEISItemContainer* GetChildContainer() const { return ChildContainer; }
+
+	const FEISItemInstanceData& GetItemInstanceData() const { return ItemInstanceData; }
+
+	void ApplyItemInstanceData(const FEISItemInstanceData& InItemInstanceData);
 	
 #pragma endregion Item Interface
 
+#pragma region Checksum
+
+	uint32 GetContentsHash() const;
+
+	static uint32 MakeContentsHash(int InItemId, uint32 InNameHash, int InAmount);
+
+#pragma endregion Checksum
+
 protected:
-	UPROPERTY(EditInstanceOnly, Replicated, Category = "Item")
+	UPROPERTY(EditInstanceOnly, ReplicatedUsing = "OnRep_ItemInstanceData", Category = "Item")
 	FEISItemInstanceData ItemInstanceData;
+
+	UFUNCTION()
+	void OnRep_ItemInstanceData(const FEISItemInstanceData& PrevItemInstanceData);
 	
 private:
 	void SetOwner(UObject* Owner);
+
+	void BroadcastAmountChange(int NewAmount, int PrevAmount);
 	
 	UPROPERTY(EditAnywhere, Category = "Item")
 	TObjectPtr<UEISItemDefinition> ItemDefinition;
 
 	UPROPERTY()
 	TObjectPtr<UObject> OwnerPrivate;
+
+	UPROPERTY(ReplicatedUsing = "OnRep_ItemHandle")
+	FEISItemHandle ItemHandle;
+
+	UFUNCTION()
+	void OnRep_ItemHandle();
+
+	/** Registry the handle belongs to; BeginDestroy runs during garbage collection and cannot look it up through the
+	 * world. */
+	TWeakObjectPtr<UEISItemRegistrySubsystem> ItemRegistry;
+
+	UPROPERTY(ReplicatedUsing = "OnRep_ChildContainer")
+	TObjectPtr<UEISItemContainer> ChildContainer;
+
+	UFUNCTION()
+	void OnRep_ChildContainer();
+
+	mutable uint16 DefinitionIndex = UEISItemDefinitionRegistry::InvalidIndex;
+
+	FEISItemDefinitionHotData FallbackHotData;
 };
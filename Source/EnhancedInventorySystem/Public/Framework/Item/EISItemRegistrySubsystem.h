@@ -0,0 +1,93 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EISItemRegistrySubsystem.generated.h"
+
+class UEISItemInstance;
+
+/** Index and generation of an item registry slot. A handle goes stale once its item is unregistered. */
+USTRUCT(BlueprintType)
+struct ENHANCEDINVENTORYSYSTEM_API FEISItemHandle
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	int32 Index = INDEX_NONE;
+
+	UPROPERTY()
+	uint32 Generation = 0;
+
+	FEISItemHandle()
+	{
+	}
+
+	FEISItemHandle(int32 InIndex, uint32 InGeneration) : Index(InIndex), Generation(InGeneration)
+	{
+	}
+
+	bool IsValid() const { return Index != INDEX_NONE && Generation != 0; }
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FEISItemHandle& Other) const
+	{
+		return Index == Other.Index && Generation == Other.Generation;
+	}
+
+	bool operator!=(const FEISItemHandle& Other) const { return !(*this == Other); }
+
+	friend uint32 GetTypeHash(const FEISItemHandle& Handle)
+	{
+		return HashCombine(GetTypeHash(Handle.Index), GetTypeHash(Handle.Generation));
+	}
+};
+
+template <>
+struct TStructOpsTypeTraits<FEISItemHandle> : TStructOpsTypeTraitsBase2<FEISItemHandle>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true
+	};
+};
+
+/**
+ * Hands out a handle to every item generated on the server. Handles replicate with their items, and clients register
+ * replicated items under the same handle, so both sides resolve a handle to the item and its owner in constant time.
+ */
+UCLASS(DisplayName = "Item Registry Subsystem")
+class ENHANCEDINVENTORYSYSTEM_API UEISItemRegistrySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Assigns the item a new handle. Only the server assigns handles; clients return an invalid one. */
+	FEISItemHandle RegisterItem(UEISItemInstance* Item);
+
+	/** Registers a replicated item under the handle the server assigned. */
+	void RegisterReplicatedItem(UEISItemInstance* Item, const FEISItemHandle& Handle);
+
+	void UnregisterItem(const FEISItemHandle& Handle);
+
+	UFUNCTION(BlueprintPure, Category = "Item Registry")
+	UEISItemInstance* ResolveItem(const FEISItemHandle& Handle) const;
+
+	/** Container or equipment slot currently holding the item. */
+	UFUNCTION(BlueprintPure, Category = "Item Registry")
+	UObject* ResolveOwner(const FEISItemHandle& Handle) const;
+
+private:
+	struct FSlot
+	{
+		TWeakObjectPtr<UEISItemInstance> Item;
+		uint32 Generation = 1;
+	};
+
+	TArray<FSlot> Slots;
+
+	TArray<int32> FreeIndices;
+};
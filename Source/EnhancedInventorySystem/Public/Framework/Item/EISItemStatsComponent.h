@@ -0,0 +1,35 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EISItemInstance.h"
+#include "GameplayTagContainer.h"
+#include "EISItemStatsComponent.generated.h"
+
+USTRUCT(BlueprintType)
+struct FEISItemStatModifier
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Item Stat")
+	FGameplayTag StatTag;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Item Stat")
+	float Value = 0.f;
+};
+
+/** Stat values an item adds to the totals of the equipment component it is equipped in. */
+UCLASS(DisplayName = "Item Stats Component")
+class ENHANCEDINVENTORYSYSTEM_API UEISItemStatsComponent : public UEISItemInstanceComponent
+{
+	GENERATED_BODY()
+
+public:
+	UFUNCTION(BlueprintPure, Category = "Item Component|Stats")
+	const TArray<FEISItemStatModifier>& GetStats() const { return Stats; }
+
+private:
+	UPROPERTY(EditAnywhere, Category = "Item Component|Stats")
+	TArray<FEISItemStatModifier> Stats;
+};
@@ -0,0 +1,36 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EISLootSubsystem.generated.h"
+
+class UEISItemContainer;
+class UEISLootTable;
+struct FEISLootSampler;
+
+/** Rolls loot tables and fills item containers with the result in one change batch. */
+UCLASS(DisplayName = "Loot Subsystem")
+class ENHANCEDINVENTORYSYSTEM_API UEISLootSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Returns the amount that did not fit into the container. NumRolls 0 uses the table roll range. */
+	UFUNCTION(BlueprintCallable, Category = "Loot Subsystem")
+	int FillContainer(UEISItemContainer* Container, UEISLootTable* LootTable, int32 Seed, int32 NumRolls = 0);
+
+	/** Rolls on a worker thread and fills the container on the game thread once the rolls are done. */
+	void FillContainerAsync(UEISItemContainer* Container, UEISLootTable* LootTable, int32 Seed, int32 NumRolls = 0,
+	                        TFunction<void(int32)> OnComplete = nullptr);
+
+	UFUNCTION(BlueprintCallable, Category = "Loot Subsystem", DisplayName = "FillContainerAsync")
+	void K2_FillContainerAsync(UEISItemContainer* Container, UEISLootTable* LootTable, int32 Seed, int32 NumRolls = 0)
+	{
+		FillContainerAsync(Container, LootTable, Seed, NumRolls);
+	}
+
+private:
+	static int32 CommitLoot(UEISItemContainer* Container, const FEISLootSampler& Sampler, const TArray<int32>& Amounts);
+};
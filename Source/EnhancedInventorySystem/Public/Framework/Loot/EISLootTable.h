@@ -0,0 +1,82 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "EISLootTable.generated.h"
+
+class UEISItemInstance;
+class UEISLootTable;
+
+USTRUCT(BlueprintType)
+struct FEISLootEntry
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot")
+	TSubclassOf<UEISItemInstance> ItemClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = "0"))
+	float Weight = 1.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = "1"))
+	int MinAmount = 1;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = "1"))
+	int MaxAmount = 1;
+};
+
+/**
+ * Immutable snapshot of a loot table with a precomputed alias table, so every roll picks an entry in constant time.
+ * Once built it may be read from any thread.
+ */
+struct ENHANCEDINVENTORYSYSTEM_API FEISLootSampler
+{
+	TArray<float> Probabilities;
+	TArray<int32> Aliases;
+	
+	TArray<TSubclassOf<UEISItemInstance>> ItemClasses;
+	TArray<int32> MinAmounts;
+	TArray<int32> MaxAmounts;
+	
+	int32 MinRolls = 1;
+	int32 MaxRolls = 1;
+
+	void Build(const UEISLootTable& LootTable);
+
+	bool IsValid() const { return !Probabilities.IsEmpty(); }
+
+	int32 SampleEntry(FRandomStream& Stream) const;
+
+	/** Adds the amounts of NumRolls rolls to OutAmounts, indexed by entry. NumRolls 0 uses the table roll range. */
+	void Roll(FRandomStream& Stream, int32 NumRolls, TArray<int32>& OutAmounts) const;
+};
+
+UCLASS(DisplayName = "Loot Table")
+class ENHANCEDINVENTORYSYSTEM_API UEISLootTable : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot")
+	TArray<FEISLootEntry> Entries;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = "0"))
+	int MinRolls = 1;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = "0"))
+	int MaxRolls = 1;
+
+	/** Built on the game thread on first use; the returned snapshot can be handed to worker threads. */
+	TSharedRef<const FEISLootSampler, ESPMode::ThreadSafe> GetSampler() const;
+
+	virtual void PostLoad() override;
+	
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+private:
+	mutable TSharedPtr<const FEISLootSampler, ESPMode::ThreadSafe> Sampler;
+};
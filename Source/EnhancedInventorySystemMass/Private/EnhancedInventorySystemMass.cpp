@@ -0,0 +1,5 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "EnhancedInventorySystemMass.h"
+
+IMPLEMENT_MODULE(FEnhancedInventorySystemMassModule, EnhancedInventorySystemMass)
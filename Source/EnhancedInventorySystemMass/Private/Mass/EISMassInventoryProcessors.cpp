@@ -0,0 +1,46 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EISMassInventoryProcessors.h"
+#include "EISItemInstance.h"
+#include "EISMassInventoryFragments.h"
+#include "EISMassInventorySubsystem.h"
+#include "MassExecutionContext.h"
+
+UEISMassInventoryInitializer::UEISMassInventoryInitializer() : EntityQuery(*this)
+{
+	ObservedType = FEISMassInventoryFragment::StaticStruct();
+	Operation = EMassObservedOperation::Add;
+
+	// Acceptance rules read the container class defaults, which are not thread safe.
+	bRequiresGameThreadExecution = true;
+}
+
+void UEISMassInventoryInitializer::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FEISMassInventoryFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddConstSharedRequirement<FEISMassInventoryConfigFragment>();
+	EntityQuery.AddSubsystemRequirement<UEISMassInventorySubsystem>(EMassFragmentAccess::ReadWrite);
+}
+
+void UEISMassInventoryInitializer::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	EntityQuery.ForEachEntityChunk(EntityManager, Context, [](FMassExecutionContext& Context)
+	{
+		UEISMassInventorySubsystem& Subsystem = Context.GetMutableSubsystemChecked<UEISMassInventorySubsystem>();
+		const FEISMassInventoryConfigFragment& Config = Context.GetConstSharedFragment<FEISMassInventoryConfigFragment>();
+		const TArrayView<FEISMassInventoryFragment> Inventories = Context.GetMutableFragmentView<
+			FEISMassInventoryFragment>();
+
+		for (FEISMassInventoryFragment& Inventory : Inventories)
+		{
+			for (const TSubclassOf<UEISItemInstance>& ItemClass : Config.StartingData)
+			{
+				if (ItemClass)
+				{
+					Subsystem.InsertItemAmount(Inventory, Config, ItemClass,
+					                           ItemClass->GetDefaultObject<UEISItemInstance>()->GetAmount());
+				}
+			}
+		}
+	});
+}
@@ -0,0 +1,236 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EISMassInventorySubsystem.h"
+#include "EISInventoryFunctionLibrary.h"
+#include "EISItemContainer.h"
+#include "EISItemInstance.h"
+#include "EISMassInventoryFragments.h"
+
+uint16 UEISMassInventorySubsystem::FindOrAddItemClass(TSubclassOf<UEISItemInstance> ItemClass)
+{
+	check(ItemClass);
+
+	if (const uint16* Index = ClassToIndex.Find(ItemClass.Get()))
+	{
+		return *Index;
+	}
+
+	checkf(ItemClasses.Num() < MAX_uint16, TEXT("Mass inventory class palette is full."));
+
+	const UEISItemInstance* ItemCDO = ItemClass->GetDefaultObject<UEISItemInstance>();
+	const uint16 Index = static_cast<uint16>(ItemClasses.Add(ItemClass));
+	ClassDefinitions.Add(ItemCDO->GetDefinition());
+	ClassStackLimits.Add(FMath::Max(ItemCDO->GetHotData().StackLimit, 1));
+	ClassToIndex.Add(ItemClass.Get(), Index);
+	return Index;
+}
+
+int UEISMassInventorySubsystem::GetMaxAddableAmount(const FEISMassInventoryFragment& Inventory,
+                                                    const FEISMassInventoryConfigFragment& Config,
+                                                    TSubclassOf<UEISItemInstance> ItemClass)
+{
+	check(ItemClass);
+
+	if (!Config.ContainerClass)
+	{
+		return MAX_int32;
+	}
+
+	// The empty container default object answers the category and per item limits; the budgets are measured against
+	// the rows.
+	const UEISItemContainer* ContainerCDO = Config.ContainerClass->GetDefaultObject<UEISItemContainer>();
+	const UEISItemInstance* ItemCDO = ItemClass->GetDefaultObject<UEISItemInstance>();
+	int64 MaxAmount = ContainerCDO->GetMaxAddableAmount(ItemCDO);
+	if (MaxAmount <= 0)
+	{
+		return 0;
+	}
+
+	const uint16 ClassIndex = FindOrAddItemClass(ItemClass);
+	const FEISItemDefinitionHotData& HotData = ItemCDO->GetHotData();
+
+	int64 OpenCapacity = 0;
+	float UsedWeight = 0.f;
+	float UsedVolume = 0.f;
+	for (int32 Row = 0; Row < Inventory.Num(); Row++)
+	{
+		const uint16 RowClassIndex = Inventory.ClassIndices[Row];
+		if (RowClassIndex == ClassIndex)
+		{
+			OpenCapacity += FMath::Max(ClassStackLimits[RowClassIndex] - Inventory.Amounts[Row], 0);
+		}
+
+		const FEISItemDefinitionHotData& RowHotData = ItemClasses[RowClassIndex]->GetDefaultObject<UEISItemInstance>()->
+			GetHotData();
+		UsedWeight += RowHotData.Weight * Inventory.Amounts[Row];
+		UsedVolume += RowHotData.Volume * Inventory.Amounts[Row];
+	}
+
+	if (ContainerCDO->GetMaxEntries() > 0)
+	{
+		const int64 FreeEntries = FMath::Max(ContainerCDO->GetMaxEntries() - Inventory.Num(), 0);
+		MaxAmount = FMath::Min<int64>(MaxAmount, OpenCapacity + FreeEntries * ClassStackLimits[ClassIndex]);
+	}
+
+	if (ContainerCDO->GetMaxWeight() > 0.f && HotData.Weight > 0.f)
+	{
+		MaxAmount = FMath::Min<int64>(MaxAmount, FMath::FloorToInt64(
+			                              (ContainerCDO->GetMaxWeight() - UsedWeight + KINDA_SMALL_NUMBER) / HotData.Weight));
+	}
+
+	if (ContainerCDO->GetMaxVolume() > 0.f && HotData.Volume > 0.f)
+	{
+		MaxAmount = FMath::Min<int64>(MaxAmount, FMath::FloorToInt64(
+			                              (ContainerCDO->GetMaxVolume() - UsedVolume + KINDA_SMALL_NUMBER) / HotData.Volume));
+	}
+
+	return static_cast<int>(FMath::Clamp<int64>(MaxAmount, 0, MAX_int32));
+}
+
+int UEISMassInventorySubsystem::InsertItemAmount(FEISMassInventoryFragment& Inventory,
+                                                 const FEISMassInventoryConfigFragment& Config,
+                                                 TSubclassOf<UEISItemInstance> ItemClass, int Amount)
+{
+	if (!ItemClass || Amount <= 0)
+	{
+		return FMath::Max(Amount, 0);
+	}
+
+	const int FittingAmount = FMath::Min(Amount, GetMaxAddableAmount(Inventory, Config, ItemClass));
+	if (FittingAmount <= 0)
+	{
+		return Amount;
+	}
+
+	const uint16 ClassIndex = FindOrAddItemClass(ItemClass);
+	const int32 StackLimit = ClassStackLimits[ClassIndex];
+
+	int RemainingAmount = FittingAmount;
+	for (int32 Row = 0; Row < Inventory.Num() && RemainingAmount > 0; Row++)
+	{
+		if (Inventory.ClassIndices[Row] == ClassIndex && Inventory.Amounts[Row] < StackLimit)
+		{
+			const int32 Added = FMath::Min(StackLimit - Inventory.Amounts[Row], RemainingAmount);
+			Inventory.Amounts[Row] += Added;
+			RemainingAmount -= Added;
+		}
+	}
+
+	while (RemainingAmount > 0)
+	{
+		const int32 Added = FMath::Min(StackLimit, RemainingAmount);
+		Inventory.AddRow(ClassIndex, UEISInventoryFunctionLibrary::GenerateItemId(), Added);
+		RemainingAmount -= Added;
+	}
+	return Amount - FittingAmount;
+}
+
+int UEISMassInventorySubsystem::ConsumeItemAmount(FEISMassInventoryFragment& Inventory,
+                                                  const UEISItemDefinition* Definition, int Amount)
+{
+	if (!Definition || Amount <= 0)
+	{
+		return 0;
+	}
+
+	int ConsumedAmount = 0;
+	for (int32 Row = Inventory.Num() - 1; Row >= 0 && ConsumedAmount < Amount; Row--)
+	{
+		if (ClassDefinitions[Inventory.ClassIndices[Row]] != Definition)
+		{
+			continue;
+		}
+
+		const int32 Taken = FMath::Min(Inventory.Amounts[Row], Amount - ConsumedAmount);
+		ConsumedAmount += Taken;
+
+		Inventory.Amounts[Row] -= Taken;
+		if (Inventory.Amounts[Row] == 0)
+		{
+			Inventory.RemoveRow(Row);
+		}
+	}
+	return ConsumedAmount;
+}
+
+int UEISMassInventorySubsystem::GetItemCount(const FEISMassInventoryFragment& Inventory,
+                                             const UEISItemDefinition* Definition) const
+{
+	int Count = 0;
+	for (int32 Row = 0; Row < Inventory.Num(); Row++)
+	{
+		if (ClassDefinitions[Inventory.ClassIndices[Row]] == Definition)
+		{
+			Count += Inventory.Amounts[Row];
+		}
+	}
+	return Count;
+}
+
+void UEISMassInventorySubsystem::WriteToContainer(FEISMassInventoryFragment& Inventory, UEISItemContainer* Container)
+{
+	check(Container);
+
+	FEISItemContainerChangeBatch ChangeBatch(Container);
+
+	// Backwards so the swap removal only moves rows already written.
+	for (int32 Row = Inventory.Num() - 1; Row >= 0; Row--)
+	{
+		const TSubclassOf<UEISItemInstance> ItemClass = GetItemClass(Inventory.ClassIndices[Row]);
+		if (!ItemClass)
+		{
+			Inventory.RemoveRow(Row);
+			continue;
+		}
+
+		const UEISItemInstance* ItemCDO = ItemClass->GetDefaultObject<UEISItemInstance>();
+		if (Container->IsCommodityItem(ItemCDO))
+		{
+			Inventory.Amounts[Row] = UEISInventoryFunctionLibrary::Container_InsertItemAmount(
+				Container, ItemClass, Inventory.Amounts[Row]);
+		}
+		else
+		{
+			FEISItemInstanceData ItemData;
+			ItemData.ItemId = Inventory.ItemIds[Row];
+			ItemData.Amount = Inventory.Amounts[Row];
+
+			UEISItemInstance* Item = UEISInventoryFunctionLibrary::GenerateItemWithData(Container->GetWorld(), ItemCDO,
+				ItemData);
+			if (Item && UEISInventoryFunctionLibrary::Container_AddItem(Container, Item))
+			{
+				Inventory.Amounts[Row] = 0;
+			}
+		}
+
+		if (Inventory.Amounts[Row] == 0)
+		{
+			Inventory.RemoveRow(Row);
+		}
+	}
+}
+
+void UEISMassInventorySubsystem::ReadFromContainer(const UEISItemContainer* Container,
+                                                   FEISMassInventoryFragment& Inventory)
+{
+	check(Container);
+
+	Inventory.Reset();
+
+	for (const UEISItemInstance* Item : Container->GetItems())
+	{
+		if (Item)
+		{
+			Inventory.AddRow(FindOrAddItemClass(Item->GetClass()), Item->GetItemId(), Item->GetAmount());
+		}
+	}
+
+	const FEISCommodityStacks& CommodityStacks = Container->GetCommodityStacks();
+	for (int32 Row = 0; Row < CommodityStacks.Num(); Row++)
+	{
+		if (const TSubclassOf<UEISItemInstance> RowClass = CommodityStacks.GetRowClass(Row))
+		{
+			Inventory.AddRow(FindOrAddItemClass(RowClass), CommodityStacks.ItemIds[Row], CommodityStacks.Amounts[Row]);
+		}
+	}
+}
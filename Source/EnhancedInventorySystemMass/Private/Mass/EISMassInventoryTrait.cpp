@@ -0,0 +1,13 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EISMassInventoryTrait.h"
+#include "MassEntityTemplateRegistry.h"
+#include "MassEntityUtils.h"
+
+void UEISMassInventoryTrait::BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const
+{
+	FMassEntityManager& EntityManager = UE::Mass::Utils::GetEntityManagerChecked(World);
+
+	BuildContext.AddFragment<FEISMassInventoryFragment>();
+	BuildContext.AddConstSharedFragment(EntityManager.GetOrCreateConstSharedFragment(Config));
+}
@@ -0,0 +1,11 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Modules/ModuleManager.h"
+
+/** Mass entity inventories. Kept apart from the core module so projects without MassGameplay can leave it out. */
+class FEnhancedInventorySystemMassModule : public IModuleInterface
+{
+};
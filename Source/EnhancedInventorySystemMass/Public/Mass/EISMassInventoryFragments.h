@@ -0,0 +1,63 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTypes.h"
+#include "EISMassInventoryFragments.generated.h"
+
+class UEISItemContainer;
+class UEISItemInstance;
+
+/** Container contents of a Mass entity packed as parallel rows; class indices point into the Mass inventory
+ * subsystem class palette. */
+USTRUCT()
+struct ENHANCEDINVENTORYSYSTEMMASS_API FEISMassInventoryFragment : public FMassFragment
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	TArray<uint16> ClassIndices;
+
+	UPROPERTY()
+	TArray<int32> ItemIds;
+
+	UPROPERTY()
+	TArray<int32> Amounts;
+
+	int32 Num() const { return ClassIndices.Num(); }
+
+	void AddRow(uint16 ClassIndex, int32 ItemId, int32 Amount)
+	{
+		ClassIndices.Add(ClassIndex);
+		ItemIds.Add(ItemId);
+		Amounts.Add(Amount);
+	}
+
+	void RemoveRow(int32 Row)
+	{
+		ClassIndices.RemoveAtSwap(Row);
+		ItemIds.RemoveAtSwap(Row);
+		Amounts.RemoveAtSwap(Row);
+	}
+
+	void Reset()
+	{
+		ClassIndices.Reset();
+		ItemIds.Reset();
+		Amounts.Reset();
+	}
+};
+
+/** Shared by every entity of a template. Acceptance rules come from the container class defaults. */
+USTRUCT()
+struct ENHANCEDINVENTORYSYSTEMMASS_API FEISMassInventoryConfigFragment : public FMassConstSharedFragment
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(EditAnywhere, Category = "Mass Inventory")
+	TSubclassOf<UEISItemContainer> ContainerClass;
+
+	UPROPERTY(EditAnywhere, Category = "Mass Inventory")
+	TArray<TSubclassOf<UEISItemInstance>> StartingData;
+};
@@ -0,0 +1,24 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityQuery.h"
+#include "MassObserverProcessor.h"
+#include "EISMassInventoryProcessors.generated.h"
+
+/** Fills the starting data of the template into every new Mass inventory. */
+UCLASS()
+class ENHANCEDINVENTORYSYSTEMMASS_API UEISMassInventoryInitializer : public UMassObserverProcessor
+{
+	GENERATED_BODY()
+
+public:
+	UEISMassInventoryInitializer();
+
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+	FMassEntityQuery EntityQuery;
+};
@@ -0,0 +1,63 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EISMassInventorySubsystem.generated.h"
+
+class UEISItemContainer;
+class UEISItemDefinition;
+class UEISItemInstance;
+struct FEISMassInventoryConfigFragment;
+struct FEISMassInventoryFragment;
+
+/**
+ * Owns the item class palette shared by all Mass inventories and performs the container operations on their packed
+ * rows. Converts a Mass inventory to a real container when an entity gets promoted to an actor, and back on demotion.
+ */
+UCLASS(DisplayName = "Mass Inventory Subsystem")
+class ENHANCEDINVENTORYSYSTEMMASS_API UEISMassInventorySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	uint16 FindOrAddItemClass(TSubclassOf<UEISItemInstance> ItemClass);
+
+	TSubclassOf<UEISItemInstance> GetItemClass(uint16 ClassIndex) const
+	{
+		return ItemClasses.IsValidIndex(ClassIndex) ? ItemClasses[ClassIndex] : nullptr;
+	}
+
+	/** Largest amount of the class the Mass inventory still takes under the category and budgets of its container
+	 * class. */
+	int GetMaxAddableAmount(const FEISMassInventoryFragment& Inventory, const FEISMassInventoryConfigFragment& Config,
+	                        TSubclassOf<UEISItemInstance> ItemClass);
+
+	/** Tops up rows of the same class first, then adds rows up to the stack limit. Returns the amount that did not
+	 * fit. */
+	int InsertItemAmount(FEISMassInventoryFragment& Inventory, const FEISMassInventoryConfigFragment& Config,
+	                     TSubclassOf<UEISItemInstance> ItemClass, int Amount);
+
+	/** Takes the amount of the definition, newest rows first. Returns the amount taken. */
+	int ConsumeItemAmount(FEISMassInventoryFragment& Inventory, const UEISItemDefinition* Definition, int Amount);
+
+	int GetItemCount(const FEISMassInventoryFragment& Inventory, const UEISItemDefinition* Definition) const;
+
+	/** Creates the items of the Mass inventory in the container, keeping their item ids. Rows the container refuses
+	 * stay in the Mass inventory with the amount that did not fit; the others are removed. */
+	void WriteToContainer(FEISMassInventoryFragment& Inventory, UEISItemContainer* Container);
+
+	/** Replaces the Mass inventory rows with the container items and commodity stacks. */
+	void ReadFromContainer(const UEISItemContainer* Container, FEISMassInventoryFragment& Inventory);
+
+private:
+	UPROPERTY()
+	TArray<TSubclassOf<UEISItemInstance>> ItemClasses;
+
+	TArray<const UEISItemDefinition*> ClassDefinitions;
+
+	TArray<int32> ClassStackLimits;
+
+	TMap<const UClass*, uint16> ClassToIndex;
+};
@@ -0,0 +1,20 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EISMassInventoryFragments.h"
+#include "MassEntityTraitBase.h"
+#include "EISMassInventoryTrait.generated.h"
+
+UCLASS(DisplayName = "Inventory", meta = (ShowOnlyInnerProperties))
+class ENHANCEDINVENTORYSYSTEMMASS_API UEISMassInventoryTrait : public UMassEntityTraitBase
+{
+	GENERATED_BODY()
+
+protected:
+	virtual void BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const override;
+
+	UPROPERTY(EditAnywhere, Category = "Mass Inventory")
+	FEISMassInventoryConfigFragment Config;
+};